@@ -0,0 +1,212 @@
+#include "catalog.h" // Catalog parsing and compilation.
+#include "catalogindex.h" // Search index built for every tab.
+#include "catalogloader.h" // Tells when the window filled its tab.
+#include "catalogmodel.h" // Model behind every catalog tab.
+#include "profile.h" // Selection aggregation of doApply().
+#include "selectionmodel.h" // Distinct packages of the checked entries.
+#include "snigdhaosblackbox.h" // The window, for the state transitions.
+#include "syntheticcatalog.h" // Writes the catalogs.
+
+#include <QApplication> // The window needs a widget application.
+#include <QDir> // Directories of the catalogs and the fixtures of the window.
+#include <QEventLoop> // Waits for the catalog of the window.
+#include <QHash> // Caches the compiled catalogs between benchmarks.
+#include <QStandardPaths> // Keeps the caches of the benchmarks away from the user's.
+#include <QTemporaryDir> // Holds the synthetic catalogs.
+
+#include <benchmark/benchmark.h> // Google Benchmark, which also writes the results as JSON.
+#include <malloc.h> // Measures the heap used by a tab.
+#include <memory> // Owns the window between timed sections.
+
+// Run with --benchmark_out=<file> --benchmark_out_format=json to record the results, as the
+// benchmark-results target does. Every benchmark runs on catalogs of 1k, 10k and 100k entries.
+
+namespace {
+
+QTemporaryDir *fixtures = nullptr; // Directory of the synthetic catalogs, created in main().
+
+// Returns the path of the catalog with the given number of entries and format, writing it on first use.
+QString catalogFile(int entries, int version = 1) {
+    QString path = fixtures->filePath(QString("synthetic-%1-v%2.txt").arg(entries).arg(version));
+    if (!QFile::exists(path)) {
+        writeSyntheticCatalog(path, entries, version);
+    }
+    return path;
+}
+
+// Returns the catalog with the given number of entries, compiled in memory once.
+Catalog compiledCatalog(int entries) {
+    static QHash<int, Catalog> catalogs;
+    if (!catalogs.contains(entries)) {
+        QSharedPointer<const CatalogImage> image = CatalogImage::fromBuffer(CatalogCache::compile({ catalogFile(entries) }));
+        catalogs.insert(entries, Catalog(image, 0));
+    }
+    return catalogs.value(entries);
+}
+
+// Bytes currently allocated on the heap.
+qint64 heapBytes() {
+    struct mallinfo2 info = mallinfo2();
+    return qint64(info.uordblks + info.hblkhd);
+}
+
+// Whether a catalog tab of the window has a model with rows.
+bool populated(const SnigdhaOSBlackbox &window) {
+    for (auto model : window.findChildren<CatalogModel*>()) {
+        if (model->rowCount() > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Reports the number of catalog entries handled per second.
+void countEntries(benchmark::State &state) {
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+// Reading a text catalog, as on the first launch or after a catalog changed.
+static void catalogParse(benchmark::State &state) {
+    QString file = catalogFile(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(CatalogCache::parse(file));
+    }
+    countEntries(state);
+}
+BENCHMARK(catalogParse)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Reading the same entries in the keyword format of version 2.
+static void catalogParseV2(benchmark::State &state) {
+    QString file = catalogFile(state.range(0), 2);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(CatalogCache::parse(file));
+    }
+    countEntries(state);
+}
+BENCHMARK(catalogParseV2)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Compiling a parsed catalog into the cached image.
+static void catalogCompile(benchmark::State &state) {
+    QVector<ParsedCatalog> parsed = { CatalogCache::parse(catalogFile(state.range(0))) };
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(CatalogCache::build(parsed));
+    }
+    countEntries(state);
+}
+BENCHMARK(catalogCompile)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Mapping a fresh cache, as on every warm start.
+static void catalogWarmStart(benchmark::State &state) {
+    QString source = catalogFile(state.range(0));
+    CatalogCache cache(fixtures->filePath(QString("catalogs-%1.bin").arg(state.range(0))));
+    cache.store(CatalogCache::compile({ source }));
+    for (auto _ : state) {
+        QSharedPointer<const CatalogImage> image = cache.map();
+        benchmark::DoNotOptimize(CatalogCache::isFresh(*image, source));
+    }
+    countEntries(state);
+}
+BENCHMARK(catalogWarmStart)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// Filling a catalog tab, as populateSelectWidget() and catalogLoaded() do: the search index and the model.
+// "heap_bytes" is the memory the tab keeps while it exists.
+static void tabPopulation(benchmark::State &state) {
+    Catalog catalog = compiledCatalog(state.range(0));
+    qint64 heap = 0;
+    for (auto _ : state) {
+        qint64 before = heapBytes();
+        auto index = QSharedPointer<const CatalogIndex>::create(catalog);
+        CatalogModel model;
+        model.setCatalog(catalog);
+        heap += heapBytes() - before;
+        benchmark::DoNotOptimize(index->size());
+    }
+    state.counters["heap_bytes"] = benchmark::Counter(double(heap) / state.iterations());
+    countEntries(state);
+}
+BENCHMARK(tabPopulation)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Collecting the selection, as doApply() does, with every entry checked: the selection model already holds
+// the distinct packages, so only the selected packages are visited.
+static void selectionAggregation(benchmark::State &state) {
+    Catalog catalog = compiledCatalog(state.range(0));
+    SelectionModel selection;
+    for (int entry = 0; entry < catalog.size(); entry++) {
+        selection.add(catalog.packages(entry));
+    }
+    for (auto _ : state) {
+        Profile profile;
+        profile.addPackages(selection.packages());
+        profile.resolve(SyncDatabase());
+        benchmark::DoNotOptimize(profile.packages());
+    }
+    countEntries(state);
+}
+BENCHMARK(selectionAggregation)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// Opening the window on the welcome screen (argument 0) and right on the select widget after an update
+// (argument 1, the "POST_UPDATE" relaunch), which starts loading the catalogs. The latter runs until the tab
+// of the 10k-entry catalog has its rows, so the difference is the latency of the transition to a filled SELECT.
+static void stateTransition(benchmark::State &state) {
+    QString initial = state.range(0) ? "POST_UPDATE" : "WELCOME";
+    for (auto _ : state) {
+        auto window = std::make_unique<SnigdhaOSBlackbox>(nullptr, initial);
+        QCoreApplication::processEvents();
+
+        // The loader reports the catalog after the window built its tab; it also finishes if the catalog failed.
+        if (state.range(0) && !populated(*window)) {
+            auto loader = window->findChild<CatalogLoader*>();
+            QEventLoop loop;
+            QObject::connect(loader, &CatalogLoader::catalogLoaded, &loop, &QEventLoop::quit);
+            QObject::connect(loader, &CatalogLoader::finished, &loop, &QEventLoop::quit);
+            loop.exec();
+            if (!populated(*window)) {
+                state.SkipWithError("The synthetic catalog did not load.");
+                break;
+            }
+        }
+
+        // Closing the window waits for the catalog loader, which is not part of the transition.
+        state.PauseTiming();
+        window.reset();
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(stateTransition)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char *argv[]) {
+    // Without a display, use the offscreen platform, so the benchmarks also run on build machines.
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication application(argc, argv);
+
+    // Keep the compiled catalogs and database caches of the window out of the user's cache directory.
+    QStandardPaths::setTestModeEnabled(true);
+
+    QTemporaryDir directory;
+    fixtures = &directory;
+
+    // The window reads its catalogs from their own directory, holding one 10k-entry catalog.
+    QDir(directory.path()).mkpath("window");
+    writeSyntheticCatalog(directory.filePath("window/synthetic.txt"), 10000);
+    qputenv("SNIGDHAOS_BLACKBOX_CATALOGS", QFile::encodeName(directory.filePath("window")));
+
+    // It also probes an empty system tree and reads empty sync and local databases instead of this machine's,
+    // so the numbers do not depend on the host.
+    QDir(directory.path()).mkpath("sysroot");
+    QDir(directory.path()).mkpath("pacman/sync");
+    QDir(directory.path()).mkpath("pacman/local");
+    qputenv("SNIGDHAOS_BLACKBOX_SYSROOT", QFile::encodeName(directory.filePath("sysroot")));
+    qputenv("SNIGDHAOS_BLACKBOX_DBPATH", QFile::encodeName(directory.filePath("pacman")));
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include "syntheticcatalog.h" // Writes the catalogs.
+
+#include <QCoreApplication> // Parses the arguments.
+#include <QDir> // Creates the output directory.
+#include <QStringList> // Arguments.
+
+#include <cstdio> // Prints the usage and the written files.
+
+// Writes synthetic catalogs for trying the application with large catalogs:
+//   snigdhaos-blackbox-catalog-generator <directory> [<entries>...]
+// writes "<directory>/synthetic-<entries>.txt" for every size, by default 1000, 10000 and 100000 entries.
+// Point SNIGDHAOS_BLACKBOX_CATALOGS at the directory to show them in the select widget.
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+    QStringList arguments = application.arguments().mid(1);
+    if (arguments.isEmpty() || arguments.first().startsWith('-')) {
+        fprintf(stderr, "Usage: %s <directory> [<entries>...]\n", argv[0]);
+        return 1;
+    }
+
+    QDir directory(arguments.takeFirst());
+    if (!directory.mkpath(".")) {
+        fprintf(stderr, "Cannot create %s\n", qPrintable(directory.path()));
+        return 1;
+    }
+    if (arguments.isEmpty()) {
+        arguments = QStringList { "1000", "10000", "100000" };
+    }
+
+    for (const QString &argument : arguments) {
+        int entries = argument.toInt();
+        QString path = directory.filePath(QString("synthetic-%1.txt").arg(entries));
+        if (entries <= 0 || !writeSyntheticCatalog(path, entries)) {
+            fprintf(stderr, "Cannot write %d entries to %s\n", entries, qPrintable(path));
+            return 1;
+        }
+        printf("%s\n", qPrintable(path));
+    }
+    return 0;
+}
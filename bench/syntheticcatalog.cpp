@@ -0,0 +1,56 @@
+#include "syntheticcatalog.h" // Includes the declaration of writeSyntheticCatalog.
+
+#include <QSaveFile> // Writes the catalog atomically.
+
+#include <random> // Deterministic pseudo-random content.
+
+bool writeSyntheticCatalog(const QString &path, int entries, int version) {
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    // A fixed seed keeps every catalog of the same size identical.
+    std::mt19937 random(20240101u + entries);
+    std::uniform_int_distribution<int> percent(0, 99);
+    std::uniform_int_distribution<int> words(4, 16);
+
+    // Appends one entry in the format of the catalog.
+    QByteArray text = version == 2 ? "catalog 2\ngroup Synthetic\n" : "";
+    auto addEntry = [&text, version](const QByteArray &id, bool checked, const QByteArray &packages, const QByteArray &display) {
+        if (version == 2) {
+            text += "entry " + id + "\ndisplay " + display + "\npackages " + packages + '\n';
+            text += checked ? "default true\n" : "";
+        }
+        else {
+            text += (checked ? "true\n" : "false\n") + packages + '\n' + display + '\n';
+        }
+    };
+
+    // The first entry is the group containing everything, like "blackarch-webapp" in webapp.txt.
+    addEntry("synthetic-group", false, "synthetic-group", "Synthetic (ALL)");
+    for (int i = 1; i < entries; i++) {
+        // One in ten entries is checked by default.
+        bool checked = percent(random) < 10;
+
+        // Most entries install one package of their own; one in five also pulls in packages shared with others.
+        QByteArray id = "synthetic-tool-" + QByteArray::number(i);
+        QByteArray packages = id;
+        if (percent(random) < 20) {
+            packages += " synthetic-lib-" + QByteArray::number(i % 97);
+            packages += " synthetic-lib-" + QByteArray::number(i % 89);
+        }
+
+        // Display text of a realistic length, with the package name first like the real catalogs.
+        QByteArray display = id + " (Synthetic tool";
+        for (int word = words(random); word > 0; word--) {
+            display += " word" + QByteArray::number(percent(random));
+        }
+        display += ".)";
+
+        addEntry(id, checked, packages, display);
+    }
+
+    file.write(text);
+    return file.commit();
+}
@@ -0,0 +1,15 @@
+#ifndef SYNTHETICCATALOG_H // Start of include guard to prevent multiple inclusions of this header file.
+#define SYNTHETICCATALOG_H // Define the include guard macro.
+
+#include <QString> // Path of the catalog.
+
+// Writes a catalog of the given number of entries in the format of the catalogs in /usr/lib/snigdhaos-blackbox:
+// three lines per entry, "true" or "false" for whether it is checked by default, the package names separated
+// by spaces, and the display text. The content only depends on the number of entries, so runs are comparable.
+//
+// Like the real catalogs, most entries name one package, some name several, packages are shared between
+// entries, and the first entry is the group of the whole catalog. Returns false if the file cannot be written.
+// Version 2 writes the same entries in the keyword format, with ids and a group.
+bool writeSyntheticCatalog(const QString &path, int entries, int version = 1);
+
+#endif // SYNTHETICCATALOG_H // End of the include guard.
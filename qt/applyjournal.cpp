@@ -0,0 +1,81 @@
+#include "applyjournal.h" // Includes the header file for the ApplyJournal class.
+
+#include <QCryptographicHash> // Checksums of the steps.
+#include <QDir> // Creates the directory of the journal.
+#include <QFile> // Reads and appends to the journal.
+#include <QFileInfo> // Locates the directory of the journal.
+#include <QJsonDocument> // Encodes the records.
+#include <QJsonObject> // Fields of a record.
+
+ApplyJournal::ApplyJournal(const QString &file)
+    : file(file) // Path of the journal.
+{
+    QFile input(file);
+    if (!input.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    // A record cut short by a crash does not parse and is ignored, so that part simply runs again.
+    for (const QByteArray &line : input.readAll().split('\n')) {
+        QJsonObject record = QJsonDocument::fromJson(line).object();
+        if (record.contains("stage") && record.contains("checksum")) {
+            completed.insert(record.value("stage").toString() + ' ' + record.value("checksum").toString());
+        }
+    }
+}
+
+void ApplyJournal::create(const QString &file, const QList<QByteArray> &selection) {
+    // Every part is prefixed with its size, so moving bytes from one part to the next changes the key.
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    for (const QByteArray &part : selection) {
+        hash.addData(QByteArray::number(part.size()) + '\n' + part);
+    }
+    const QString key = QString::fromLatin1(hash.result().toHex());
+
+    // A journal of the same selection is a genuine retry and resumes where the last attempt stopped.
+    QFile input(file);
+    if (input.open(QIODevice::ReadOnly)) {
+        if (QJsonDocument::fromJson(input.readLine()).object().value("key").toString() == key) {
+            return;
+        }
+        input.close();
+    }
+
+    // Anything else, including a journal of an earlier version without a key, starts over.
+    QDir().mkpath(QFileInfo(file).absolutePath());
+    QFile output(file);
+    if (output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        output.write(QJsonDocument(QJsonObject { { "key", key } }).toJson(QJsonDocument::Compact) + '\n');
+    }
+}
+
+void ApplyJournal::remove(const QString &file) {
+    QFile::remove(file);
+}
+
+QByteArray ApplyJournal::checksum(const QString &stage, const CommandGraph::Step &step) {
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(stage.toUtf8() + '\n' + step.id.toUtf8() + '\n' + step.command.toUtf8());
+    return hash.result().toHex();
+}
+
+bool ApplyJournal::isCompleted(const QString &stage, const CommandGraph::Step &step) const {
+    return completed.contains(stage + ' ' + QString::fromLatin1(checksum(stage, step)));
+}
+
+bool ApplyJournal::record(const QString &stage, const CommandGraph::Step &step) {
+    QByteArray sum = checksum(stage, step);
+    completed.insert(stage + ' ' + QString::fromLatin1(sum));
+
+    // One write per record, flushed right away, so a failure later on cannot lose it.
+    QFile output(file);
+    if (!output.open(QIODevice::Append)) {
+        return false;
+    }
+    QJsonObject record = {
+        { "stage", stage },
+        { "step", step.id },
+        { "checksum", QString::fromLatin1(sum) },
+    };
+    return output.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + '\n') > 0;
+}
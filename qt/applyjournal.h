@@ -0,0 +1,49 @@
+#ifndef APPLYJOURNAL_H // Start of include guard to prevent multiple inclusions of this header file.
+#define APPLYJOURNAL_H // Define the include guard macro.
+
+#include "commandgraph.h" // Steps recorded in the journal.
+
+#include <QList> // Parts of the selection a journal belongs to.
+#include <QSet> // Completed records.
+#include <QString> // Path of the journal.
+
+// Remembers which parts of an apply already succeeded, so a retry only runs what failed or never ran.
+//
+// The journal is a file of JSON lines. The first one holds the key of the selection it belongs to, and
+// the others are appended one per completed part, as soon as that part is done:
+//   {"key":"<sha256>"}                                               the selection, written by create()
+//   {"checksum":"<sha256>","stage":"setup","step":"podman.socket"}   a step, written by --run-steps
+//   {"stage":"download","checksum":"<sha256>"}                       a stage, written by apply.sh
+// The checksum covers what was run: the stage, id and command of a step, or the package list of a stage,
+// so a step whose command changed runs again. Installed packages need no records, since the pacman local
+// database already lists them and the window leaves them out of the next apply. The journal is removed
+// once an apply succeeds, and started over when a different selection is applied.
+class ApplyJournal
+{
+public:
+    // Reads the records of a journal file. A missing file is an empty journal.
+    explicit ApplyJournal(const QString &file);
+
+    // Creates the journal file for a selection, so the records --run-steps appends as root go to a file
+    // owned by the user. The key covers the prepare steps, the selected packages and the setup steps as
+    // they are passed in; the records of an earlier attempt are only kept if they were made for the same key.
+    static void create(const QString &file, const QList<QByteArray> &selection);
+
+    // Removes the journal file, after an apply succeeded.
+    static void remove(const QString &file);
+
+    // Checksum identifying a step of a stage.
+    static QByteArray checksum(const QString &stage, const CommandGraph::Step &step);
+
+    // Whether the step already succeeded in an earlier attempt.
+    bool isCompleted(const QString &stage, const CommandGraph::Step &step) const;
+
+    // Appends a record for a step that succeeded. Returns false if it could not be written.
+    bool record(const QString &stage, const CommandGraph::Step &step);
+
+private:
+    QString file;            // Path of the journal.
+    QSet<QString> completed; // "<stage> <checksum>" of every record.
+};
+
+#endif // APPLYJOURNAL_H // End of the include guard.
@@ -0,0 +1,180 @@
+#include "bundleexporter.h" // Includes the header file for the BundleExporter class.
+#include "dependencyresolver.h" // Computes the closure of the profile.
+#include "packageprefetcher.h" // Downloads the missing package files.
+
+#include <QCommandLineParser> // Parses the arguments of --export-bundle.
+#include <QDir> // Lists and removes the package files of the bundle.
+#include <QEventLoop> // Waits for the downloads.
+#include <QFile> // Copies the package files from the pacman cache.
+#include <QSet> // File names of the closure.
+#include <QStandardPaths> // Locates the per-user cache directory.
+
+#include <cstdio> // Prints status lines.
+
+namespace {
+
+const char *SYNC_DIRECTORY = "/var/lib/pacman/sync";   // Sync databases of the system.
+const char *SYSTEM_CACHE = "/var/cache/pacman/pkg";    // Package files pacman already downloaded.
+
+} // namespace
+
+BundleExporter::BundleExporter(const Profile &profile, const QString &directory, QObject *parent)
+    : QObject(parent) // Initializes the base object with the given parent.
+    , profile(profile) // The selection to bundle.
+    , directory(QDir(directory).absolutePath()) // Directory of the bundle.
+    , prefetcher(new PackagePrefetcher(directory, this)) // Downloads straight into the bundle.
+{
+    connect(prefetcher, &PackagePrefetcher::progressChanged, this, &BundleExporter::downloadsChanged);
+}
+
+void BundleExporter::start() {
+    say("Reading the sync databases...");
+    sync = SyncDatabase::load(SYNC_DIRECTORY, QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/sync");
+    if (sync.isEmpty()) {
+        say("Cannot read the sync databases.");
+        done = true;
+        emit finished(1);
+        return;
+    }
+
+    OfflineBundle existing = OfflineBundle::open(directory);
+    if (existing.isValid()) {
+        say(existing.isOlderThan(SYNC_DIRECTORY) ? "The bundle is older than the sync databases: fetching the packages that changed."
+                                                 : "Updating the bundle.");
+    }
+
+    // The closure for a machine that has nothing installed yet; the target drops what it already has.
+    Profile resolved = profile;
+    resolved.resolve(sync);
+    DependencyResolver resolver(sync, LocalDatabase());
+    for (const QString &package : resolved.packages()) {
+        resolver.add(package);
+    }
+    packages = resolver.packages();
+
+    // Packages from a repository that a prepare step adds, e.g. BlackArch's, are only known where it was added.
+    QStringList unknown = sync.missing(resolved.preparedPackages());
+    if (!unknown.isEmpty()) {
+        say("Not bundled, their repository is added by the preparation steps: " + unknown.join(' '));
+    }
+
+    // Remove the files the closure no longer needs, e.g. the versions the sync databases replaced.
+    QSet<QString> wanted;
+    for (const SyncDatabase::Package &package : packages) {
+        wanted.insert(QString::fromUtf8(package.repository->filename(package.index)));
+    }
+    QDir dir(directory);
+    int removed = 0;
+    for (const QString &name : dir.entryList({ "*.pkg.tar*" }, QDir::Files)) {
+        if (!wanted.contains(name) && dir.remove(name)) {
+            removed++;
+        }
+    }
+
+    // Copy what pacman already downloaded instead of downloading it again.
+    int kept = 0;
+    int copied = 0;
+    for (const SyncDatabase::Package &package : packages) {
+        QString filename = QString::fromUtf8(package.repository->filename(package.index));
+        qint64 size = qint64(package.repository->downloadSize(package.index));
+        QByteArray sha256 = package.repository->sha256(package.index);
+        if (PackagePrefetcher::isComplete(dir.filePath(filename), size, sha256)) {
+            kept++;
+        }
+        else if (PackagePrefetcher::isComplete(QDir(SYSTEM_CACHE).filePath(filename), size, sha256)) {
+            QFile::remove(dir.filePath(filename));
+            if (QFile::copy(QDir(SYSTEM_CACHE).filePath(filename), dir.filePath(filename))) {
+                copied++;
+            }
+        }
+    }
+    say(QString("%1 packages: %2 already in the bundle, %3 copied from the package cache, %4 outdated files removed.")
+            .arg(packages.size()).arg(kept).arg(copied).arg(removed));
+
+    // Download the rest. downloadsChanged() continues once nothing is left.
+    prefetcher->setPackages(packages);
+}
+
+void BundleExporter::downloadsChanged() {
+    if (done) {
+        return;
+    }
+    if (!prefetcher->isIdle()) {
+        if (prefetcher->downloadedCount() != reported) {
+            reported = prefetcher->downloadedCount();
+            say(QString("Downloaded %1 of %2 packages...").arg(reported).arg(prefetcher->packageCount()));
+        }
+        return;
+    }
+    done = true;
+
+    // The bundle is used without the internet, so every file has to be there and match the checksum of its database.
+    QStringList missing;
+    for (const SyncDatabase::Package &package : packages) {
+        QString filename = QString::fromUtf8(package.repository->filename(package.index));
+        if (!PackagePrefetcher::isComplete(QDir(directory).filePath(filename), qint64(package.repository->downloadSize(package.index)),
+                                           package.repository->sha256(package.index))) {
+            missing += filename;
+        }
+    }
+    if (!missing.isEmpty()) {
+        say("Cannot download " + missing.join(' '));
+        emit finished(1);
+        return;
+    }
+
+    // Write the database last, so an interrupted export never leaves a database listing missing files.
+    QString error;
+    OfflineBundle bundle = OfflineBundle::create(directory, SYNC_DIRECTORY);
+    if (!bundle.writeDatabase(packages, SYNC_DIRECTORY, &error)) {
+        say("Cannot write the database of the bundle: " + error);
+        emit finished(1);
+        return;
+    }
+    if (!profile.save(bundle.profileFile()) || !bundle.save()) {
+        say("Cannot write the profile or the manifest of the bundle.");
+        emit finished(1);
+        return;
+    }
+
+    say(QString("The bundle in %1 holds %2 packages. Apply it with: snigdhaos-blackbox --bundle %1").arg(directory).arg(packages.size()));
+    emit finished(0);
+}
+
+void BundleExporter::say(const QString &text) {
+    fputs(("==> " + text + "\n").toLocal8Bit().constData(), stdout);
+    fflush(stdout);
+}
+
+int BundleExporter::run(const QStringList &arguments) {
+    QCommandLineParser parser;
+    QCommandLineOption exportOption("export-bundle", "Writes or updates the offline bundle of a profile.", "directory");
+    QCommandLineOption profileOption("profile", "The profile to bundle, exported from the select widget.", "file");
+    parser.addOptions({ exportOption, profileOption });
+    parser.process(arguments);
+
+    if (!parser.isSet(profileOption)) {
+        say("--export-bundle needs the --profile to bundle.");
+        return 1;
+    }
+    QString error;
+    Profile profile = Profile::load(parser.value(profileOption), &error);
+    if (!error.isEmpty()) {
+        say(QString("Cannot read the profile %1: %2").arg(parser.value(profileOption), error));
+        return 1;
+    }
+
+    // Run until the bundle is written. Failing to read the databases finishes right away.
+    BundleExporter exporter(profile, parser.value(exportOption));
+    QEventLoop loop;
+    int status = -1;
+    connect(&exporter, &BundleExporter::finished, &loop, [&loop, &status](int result) {
+        status = result;
+        loop.quit();
+    });
+    exporter.start();
+    if (status < 0) {
+        loop.exec();
+    }
+    return status;
+}
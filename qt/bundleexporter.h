@@ -0,0 +1,59 @@
+#ifndef BUNDLEEXPORTER_H // Start of include guard to prevent multiple inclusions of this header file.
+#define BUNDLEEXPORTER_H // Define the include guard macro.
+
+#include "offlinebundle.h" // The bundle being written.
+#include "profile.h" // The selection to bundle.
+#include "syncdatabase.h" // Where the packages come from.
+
+#include <QObject> // Base class providing signals and slots.
+
+class PackagePrefetcher; // Forward declaration of the downloader filling the bundle.
+
+// Writes the offline bundle of a profile (see OfflineBundle), without a window:
+//   snigdhaos-blackbox --export-bundle <directory> --profile <file>
+//
+// The profile is resolved for a machine that has nothing installed, and the package files of the whole
+// closure are gathered in the directory: files already in the bundle are kept, files in the pacman cache
+// are copied, and only the rest is downloaded, by the same downloader that prefetches for the window.
+// Every file has to match the checksum of the sync database, otherwise it is fetched again.
+// Running it again on an existing bundle after the sync databases were refreshed only fetches the
+// packages that changed, and removes the files the closure no longer needs.
+class BundleExporter : public QObject
+{
+    Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
+
+public:
+    // Constructor for the BundleExporter class.
+    // Parameters:
+    // - profile: The selection to bundle.
+    // - directory: Directory of the bundle, created if needed.
+    // - parent: Pointer to the parent object that owns the exporter.
+    BundleExporter(const Profile &profile, const QString &directory, QObject *parent = nullptr);
+
+    // Resolves the profile and starts gathering the packages. Emits finished() when done.
+    void start();
+
+    // Runs "--export-bundle <directory> --profile <file>" and returns the exit status of the process.
+    static int run(const QStringList &arguments);
+
+signals:
+    // Emitted once the bundle was written or a step failed, with the exit status of the process.
+    void finished(int status);
+
+private:
+    // Reports the downloads, and writes the database and the manifest once they are done.
+    void downloadsChanged();
+
+    // Prints a status line.
+    static void say(const QString &text);
+
+    Profile profile;                           // The selection to bundle, as given.
+    QString directory;                         // Directory of the bundle.
+    SyncDatabase sync;                         // Sync databases the packages come from.
+    QVector<SyncDatabase::Package> packages;   // Closure of the profile.
+    PackagePrefetcher *prefetcher;             // Downloads what is neither in the bundle nor in the pacman cache.
+    int reported = -1;                         // Downloaded count printed last.
+    bool done = false;                         // Whether finished() was emitted.
+};
+
+#endif // BUNDLEEXPORTER_H // End of the include guard.
@@ -0,0 +1,801 @@
+#include "catalog.h" // Includes the header file for the catalog image, view and cache classes.
+
+#include <QDateTime> // Used to compare file modification times.
+#include <QDir> // Used to create the cache directory.
+#include <QFileInfo> // Allows access to file metadata, such as modification times and sizes.
+#include <QHash> // Interns package names while compiling.
+#include <QSaveFile> // Replaces the cache file atomically, so a running instance never maps a partial file.
+
+#include <algorithm> // Compares misspelled default states.
+#include <cctype> // Compares misspelled default states regardless of case.
+#include <cstring> // Finds the line breaks.
+#include <optional> // Default states that could not be read.
+#include <string> // Lowercases misspelled default states.
+
+namespace {
+
+// FNV-1a hash of the content of a text catalog, used when the modification time alone is inconclusive.
+quint64 hashContent(std::string_view content) {
+    quint64 hash = 14695981039346656037ULL;
+    for (char c : content) {
+        hash ^= static_cast<uchar>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Views the bytes of a QByteArray.
+std::string_view bytesOf(const QByteArray &bytes) {
+    return std::string_view(bytes.constData(), size_t(bytes.size()));
+}
+
+// Whether a character is whitespace around keywords, values and words.
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+// Strips the whitespace around a line, including the '\r' of Windows line endings.
+std::string_view trimmed(std::string_view text) {
+    while (!text.empty() && isSpace(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && isSpace(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// Appends the words of a line, separated by any amount of whitespace.
+void appendWords(QVector<std::string_view> &words, std::string_view text) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        if (isSpace(text[pos])) {
+            pos++;
+            continue;
+        }
+        size_t end = pos;
+        while (end < text.size() && !isSpace(text[end])) {
+            end++;
+        }
+        words.append(text.substr(pos, end - pos));
+        pos = end;
+    }
+}
+
+// Quotes a piece of the text for a diagnostic.
+QString quoted(std::string_view text) {
+    return '"' + QString::fromUtf8(text.data(), int(text.size())) + '"';
+}
+
+// Walks the lines of a text in place, counting them for the diagnostics.
+class LineReader
+{
+public:
+    explicit LineReader(std::string_view text)
+        : text(text) // Text to walk.
+    {
+    }
+
+    // Reads the next line without its line break, or returns false at the end of the text.
+    bool next(std::string_view &line) {
+        if (pos >= text.size()) {
+            return false;
+        }
+        const char *start = text.data() + pos;
+        const void *end = memchr(start, '\n', text.size() - pos);
+        size_t length = end ? size_t(static_cast<const char *>(end) - start) : text.size() - pos;
+        line = std::string_view(start, length);
+
+        // Tolerate files saved with Windows line endings.
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        previous = pos;
+        pos += length + 1;
+        number++;
+        return true;
+    }
+
+    // Steps back to the line read last, so the next call reads it again. Only goes back one line.
+    void unread() {
+        pos = previous;
+        number--;
+    }
+
+    // Number of the line read last, starting at 1.
+    int lineNumber() const {
+        return number;
+    }
+
+private:
+    std::string_view text; // Text to walk.
+    size_t pos = 0;        // Start of the next line.
+    size_t previous = 0;   // Start of the line read last.
+    int number = 0;        // Number of the line read last.
+};
+
+// Records a problem with a line of the catalog.
+void report(ParsedCatalog &catalog, int line, const QString &message, bool error) {
+    catalog.diagnostics.append({ line, message, error });
+}
+
+// Matches "true" or "false", and near misses with the same letters such as "fasle" or "True", which set `guessed`.
+// Returns nothing for any other word.
+std::optional<bool> matchDefault(std::string_view word, bool &guessed) {
+    guessed = false;
+    if (word == "true" || word == "false") {
+        return word == "true";
+    }
+    std::string lower(word);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](char c) { return char(std::tolower(uchar(c))); });
+    auto sameLetters = [&lower](std::string_view expected) {
+        return lower.size() == expected.size() && std::is_permutation(lower.begin(), lower.end(), expected.begin());
+    };
+    for (bool value : { true, false }) {
+        if (sameLetters(value ? "true" : "false")) {
+            guessed = true;
+            return value;
+        }
+    }
+    return std::nullopt;
+}
+
+// Reads "true" or "false". Near misses are read as what they were meant to be, with a warning.
+std::optional<bool> readDefault(ParsedCatalog &catalog, int line, std::string_view word) {
+    bool guessed = false;
+    std::optional<bool> value = matchDefault(word, guessed);
+    if (value && guessed) {
+        report(catalog, line, QString("%1 read as \"%2\"").arg(quoted(word), *value ? "true" : "false"), false);
+    }
+    return value;
+}
+
+// Whether a line reads as a default state, i.e. starts an entry of a legacy catalog.
+bool isDefault(std::string_view line) {
+    bool guessed = false;
+    return matchDefault(trimmed(line), guessed).has_value();
+}
+
+// Parses legacy catalogs: triplets of the default state, the package names and the display text.
+// A line that should start an entry but is not a default state means lines are missing or extra above it,
+// so the entries are realigned at the next "true" or "false" line instead of shifting every entry after it.
+// A default state where the package names or the display text should be means those lines are missing:
+// the partial entry is dropped and the next one starts at that line.
+void parseTriplets(LineReader &lines, ParsedCatalog &catalog) {
+    std::string_view line;
+    bool realigning = false;
+    while (lines.next(line)) {
+        // Blank lines between entries, e.g. at the end of the file, are tolerated.
+        std::string_view def = trimmed(line);
+        if (def.empty()) {
+            continue;
+        }
+
+        int first = lines.lineNumber();
+        std::optional<bool> checked = readDefault(catalog, first, def);
+        if (!checked) {
+            if (!realigning) {
+                report(catalog, first, QString("expected \"true\" or \"false\" but found %1, skipping to the next entry").arg(quoted(def)), true);
+                realigning = true;
+            }
+            continue;
+        }
+        realigning = false;
+
+        std::string_view packages;
+        std::string_view display;
+        if (!lines.next(packages)) {
+            report(catalog, first, "entry without package names or display text at the end of the file", true);
+            break;
+        }
+        if (isDefault(packages)) {
+            report(catalog, lines.lineNumber(), QString("found %1 where the package names of the entry of line %2 should be; "
+                                                            "dropping that entry, which is missing lines").arg(quoted(trimmed(packages))).arg(first), true);
+            lines.unread();
+            continue;
+        }
+        if (!lines.next(display)) {
+            report(catalog, first, "entry without display text at the end of the file", true);
+            break;
+        }
+        if (isDefault(display)) {
+            report(catalog, lines.lineNumber(), QString("found %1 where the display text of the entry of line %2 should be; "
+                                                            "dropping that entry, which is missing a line").arg(quoted(trimmed(display))).arg(first), true);
+            lines.unread();
+            continue;
+        }
+
+        ParsedCatalog::Entry entry;
+        entry.defaultChecked = *checked;
+        entry.display = trimmed(display);
+        appendWords(entry.packages, packages);
+        if (entry.packages.isEmpty()) {
+            report(catalog, first + 1, "entry without package names", false);
+        }
+        if (entry.display.empty()) {
+            report(catalog, first + 2, "entry without display text", false);
+        }
+        catalog.entries.append(entry);
+    }
+}
+
+// Parses catalogs of version 2: one "<keyword> <value>" per line, see ParsedCatalog.
+void parseKeywords(LineReader &lines, ParsedCatalog &catalog) {
+    std::string_view group;     // Group of the following entries.
+    int current = -1;           // Index of the entry being read, or -1 outside of entries.
+    int entryLine = 0;          // Line of the "entry" keyword of the current entry.
+    bool dropped = false;       // Whether the properties that follow belong to a rejected entry.
+    QHash<QByteArray, int> ids; // Lines of the entries, by id.
+
+    // Checks the entry that was read last.
+    auto finish = [&]() {
+        if (current < 0) {
+            return;
+        }
+        ParsedCatalog::Entry &entry = catalog.entries[current];
+        if (entry.display.empty()) {
+            report(catalog, entryLine, QString("entry %1 without display text, showing its id").arg(quoted(entry.id)), false);
+            entry.display = entry.id;
+        }
+        if (entry.packages.isEmpty() && entry.prepare.isEmpty() && entry.setup.isEmpty()) {
+            report(catalog, entryLine, QString("entry %1 without packages or commands").arg(quoted(entry.id)), false);
+        }
+        current = -1;
+    };
+
+    std::string_view line;
+    while (lines.next(line)) {
+        line = trimmed(line);
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        int number = lines.lineNumber();
+
+        // Split the keyword from its value.
+        size_t space = 0;
+        while (space < line.size() && !isSpace(line[space])) {
+            space++;
+        }
+        std::string_view keyword = line.substr(0, space);
+        std::string_view value = trimmed(line.substr(space));
+
+        if (keyword == "group") {
+            finish();
+            dropped = false;
+            group = value;
+            continue;
+        }
+        if (keyword == "entry") {
+            finish();
+            QByteArray key = QByteArray::fromRawData(value.data(), int(value.size()));
+            dropped = true;
+            if (value.empty() || std::any_of(value.begin(), value.end(), isSpace)) {
+                report(catalog, number, QString("entry ids are one word, found %1").arg(quoted(value)), true);
+            }
+            else if (ids.contains(key)) {
+                report(catalog, number, QString("entry %1 was already defined on line %2").arg(quoted(value)).arg(ids.value(key)), true);
+            }
+            else {
+                ids.insert(key, number);
+                ParsedCatalog::Entry entry;
+                entry.id = value;
+                entry.group = group;
+                catalog.entries.append(entry);
+                current = catalog.entries.size() - 1;
+                entryLine = number;
+                dropped = false;
+            }
+            continue;
+        }
+
+        bool property = keyword == "display" || keyword == "packages" || keyword == "default" || keyword == "tags"
+                        || keyword == "after" || keyword == "prepare" || keyword == "setup";
+        if (!property) {
+            report(catalog, number, QString("unknown keyword %1").arg(quoted(keyword)), true);
+            continue;
+        }
+        if (current < 0) {
+            // The properties of a rejected entry were already reported with it.
+            if (!dropped) {
+                report(catalog, number, QString("%1 outside of an entry").arg(quoted(keyword)), true);
+            }
+            continue;
+        }
+
+        ParsedCatalog::Entry &entry = catalog.entries[current];
+        if (value.empty() && keyword != "packages" && keyword != "tags" && keyword != "after") {
+            report(catalog, number, QString("%1 without a value").arg(quoted(keyword)), true);
+        }
+        else if (keyword == "display") {
+            if (!entry.display.empty()) {
+                report(catalog, number, "display text given twice, using the last one", false);
+            }
+            entry.display = value;
+        }
+        else if (keyword == "packages") {
+            appendWords(entry.packages, value);
+        }
+        else if (keyword == "default") {
+            std::optional<bool> checked = readDefault(catalog, number, value);
+            if (checked) {
+                entry.defaultChecked = *checked;
+            }
+            else {
+                report(catalog, number, QString("expected \"true\" or \"false\" but found %1").arg(quoted(value)), true);
+            }
+        }
+        else if (keyword == "tags") {
+            appendWords(entry.tags, value);
+        }
+        else if (keyword == "after") {
+            appendWords(entry.after, value);
+        }
+        else if (keyword == "prepare") {
+            entry.prepare.append(value);
+        }
+        else {
+            entry.setup.append(value);
+        }
+    }
+    finish();
+}
+
+// Appends the raw bytes of a vector of records to the image.
+template<typename T>
+void appendRecords(QByteArray &image, const QVector<T> &records) {
+    image.append(reinterpret_cast<const char *>(records.constData()), records.size() * int(sizeof(T)));
+}
+
+}
+
+QSharedPointer<CatalogImage> CatalogImage::fromBuffer(const QByteArray &buffer) {
+    QSharedPointer<CatalogImage> image(new CatalogImage);
+    image->buffer = buffer;
+    image->data = reinterpret_cast<const uchar *>(image->buffer.constData());
+    image->size = image->buffer.size();
+
+    // Reject anything that is not a complete image of the current version.
+    return image->validate() ? image : QSharedPointer<CatalogImage>();
+}
+
+QSharedPointer<CatalogImage> CatalogImage::fromFile(const QString &filename) {
+    QSharedPointer<CatalogImage> image(new CatalogImage);
+    image->file.setFileName(filename);
+
+    // Map the whole file read-only; the entries are used in place without copying.
+    if (!image->file.open(QIODevice::ReadOnly)) {
+        return QSharedPointer<CatalogImage>();
+    }
+    image->size = image->file.size();
+    image->data = image->file.map(0, image->size);
+
+    // Reject missing mappings and stale or truncated files.
+    return image->data && image->validate() ? image : QSharedPointer<CatalogImage>();
+}
+
+CatalogImage::~CatalogImage() {
+    // Release the mapping before the file is closed.
+    if (file.isOpen() && data) {
+        file.unmap(const_cast<uchar *>(data));
+    }
+}
+
+bool CatalogImage::validate() const {
+    // The header has to be present before any of its fields can be read.
+    if (size < qint64(sizeof(Header))) {
+        return false;
+    }
+
+    const Header &h = header();
+    if (h.magic != MAGIC || h.version != VERSION) {
+        return false;
+    }
+
+    // The sections have to add up to exactly the size of the image.
+    qint64 expected = qint64(sizeof(Header))
+                      + qint64(h.sourceCount) * qint64(sizeof(SourceRecord))
+                      + qint64(h.packageCount) * qint64(sizeof(StringRef))
+                      + qint64(h.entryCount) * qint64(sizeof(EntryRecord))
+                      + qint64(h.listCount) * qint64(sizeof(StringRef))
+                      + qint64(h.idCount) * qint64(sizeof(quint32))
+                      + qint64(h.stringsSize);
+    if (expected != size) {
+        return false;
+    }
+
+    // Every reference has to stay inside its section, so a corrupted cache is recompiled instead of read out of bounds.
+    // This runs once when the image is mapped; the accessors trust the image afterwards.
+    auto fits = [&h](const StringRef &ref) {
+        return quint64(ref.offset) + ref.length <= h.stringsSize;
+    };
+
+    // Every catalog has to reference entries that exist.
+    for (quint32 i = 0; i < h.sourceCount; i++) {
+        const SourceRecord &record = source(int(i));
+        if (!fits(record.path) || quint64(record.firstEntry) + record.entryCount > h.entryCount) {
+            return false;
+        }
+    }
+
+    const StringRef *names = reinterpret_cast<const StringRef *>(data + sizeof(Header) + h.sourceCount * sizeof(SourceRecord));
+    for (quint32 i = 0; i < h.packageCount; i++) {
+        if (!fits(names[i])) {
+            return false;
+        }
+    }
+
+    // Every entry has to reference strings, package IDs and list strings that exist.
+    for (quint32 i = 0; i < h.entryCount; i++) {
+        const EntryRecord &record = entry(int(i));
+        quint64 listEnd = quint64(record.firstList) + record.tagCount + record.prepareCount + record.setupCount + record.afterCount;
+        if (!fits(record.id) || !fits(record.display) || !fits(record.group)
+            || quint64(record.firstPackage) + record.packageCount > h.idCount || listEnd > h.listCount) {
+            return false;
+        }
+    }
+
+    const StringRef *refs = lists();
+    for (quint32 i = 0; i < h.listCount; i++) {
+        if (!fits(refs[i])) {
+            return false;
+        }
+    }
+
+    // Every package ID has to name an interned package.
+    const quint32 *ids = packageIds();
+    for (quint32 i = 0; i < h.idCount; i++) {
+        if (ids[i] >= h.packageCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const CatalogImage::Header &CatalogImage::header() const {
+    return *reinterpret_cast<const Header *>(data);
+}
+
+const CatalogImage::SourceRecord &CatalogImage::source(int index) const {
+    const uchar *sources = data + sizeof(Header);
+    return reinterpret_cast<const SourceRecord *>(sources)[index];
+}
+
+const CatalogImage::EntryRecord &CatalogImage::entry(int index) const {
+    const Header &h = header();
+    const uchar *entries = data + sizeof(Header)
+                           + h.sourceCount * sizeof(SourceRecord)
+                           + h.packageCount * sizeof(StringRef);
+    return reinterpret_cast<const EntryRecord *>(entries)[index];
+}
+
+const CatalogImage::StringRef *CatalogImage::lists() const {
+    const Header &h = header();
+    const uchar *lists = data + sizeof(Header)
+                         + h.sourceCount * sizeof(SourceRecord)
+                         + h.packageCount * sizeof(StringRef)
+                         + h.entryCount * sizeof(EntryRecord);
+    return reinterpret_cast<const StringRef *>(lists);
+}
+
+const quint32 *CatalogImage::packageIds() const {
+    return reinterpret_cast<const quint32 *>(lists() + header().listCount);
+}
+
+QByteArray CatalogImage::string(const StringRef &ref) const {
+    const char *strings = reinterpret_cast<const char *>(packageIds() + header().idCount);
+
+    // Refers to the mapped bytes directly, without copying them.
+    return QByteArray::fromRawData(strings + ref.offset, int(ref.length));
+}
+
+QByteArray CatalogImage::packageName(quint32 id) const {
+    const uchar *names = data + sizeof(Header) + header().sourceCount * sizeof(SourceRecord);
+    return string(reinterpret_cast<const StringRef *>(names)[id]);
+}
+
+int CatalogImage::findSource(const QString &path) const {
+    const QByteArray key = path.toUtf8();
+    for (quint32 i = 0; i < header().sourceCount; i++) {
+        if (string(source(int(i)).path) == key) {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+Catalog::Catalog(QSharedPointer<const CatalogImage> image, int source)
+    : image(image) // Keeps the image alive for as long as the catalog is used.
+    , source(source) // Index of the catalog inside the image.
+{
+}
+
+bool Catalog::isNull() const {
+    return !image || source < 0;
+}
+
+int Catalog::size() const {
+    return isNull() ? 0 : int(image->source(source).entryCount);
+}
+
+QString Catalog::display(int entry) const {
+    return QString::fromUtf8(image->string(record(entry).display));
+}
+
+bool Catalog::defaultChecked(int entry) const {
+    return record(entry).flags & CatalogImage::DefaultChecked;
+}
+
+QStringList Catalog::packages(int entry) const {
+    QStringList names;
+    for (quint32 id : packageIds(entry)) {
+        names += packageName(id);
+    }
+    return names;
+}
+
+QVector<quint32> Catalog::packageIds(int entry) const {
+    const auto &r = record(entry);
+    const quint32 *ids = image->packageIds() + r.firstPackage;
+    return QVector<quint32>(ids, ids + r.packageCount);
+}
+
+QString Catalog::id(int entry) const {
+    return QString::fromUtf8(image->string(record(entry).id));
+}
+
+QString Catalog::group(int entry) const {
+    return QString::fromUtf8(image->string(record(entry).group));
+}
+
+QStringList Catalog::tags(int entry) const {
+    const auto &r = record(entry);
+    return list(r.firstList, r.tagCount);
+}
+
+QStringList Catalog::prepareCommands(int entry) const {
+    const auto &r = record(entry);
+    return list(r.firstList + r.tagCount, r.prepareCount);
+}
+
+QStringList Catalog::setupCommands(int entry) const {
+    const auto &r = record(entry);
+    return list(r.firstList + r.tagCount + r.prepareCount, r.setupCount);
+}
+
+QStringList Catalog::after(int entry) const {
+    const auto &r = record(entry);
+    return list(r.firstList + r.tagCount + r.prepareCount + r.setupCount, r.afterCount);
+}
+
+bool Catalog::hasCommands(int entry) const {
+    const auto &r = record(entry);
+    return r.prepareCount > 0 || r.setupCount > 0;
+}
+
+bool Catalog::hasPrepareCommands(int entry) const {
+    return record(entry).prepareCount > 0;
+}
+
+QString Catalog::packageName(quint32 id) const {
+    return QString::fromUtf8(image->packageName(id));
+}
+
+const CatalogImage::EntryRecord &Catalog::record(int entry) const {
+    return image->entry(int(image->source(source).firstEntry) + entry);
+}
+
+QStringList Catalog::list(quint32 first, quint32 count) const {
+    QStringList values;
+    const CatalogImage::StringRef *refs = image->lists() + first;
+    for (quint32 i = 0; i < count; i++) {
+        values += QString::fromUtf8(image->string(refs[i]));
+    }
+    return values;
+}
+
+QSharedPointer<const CatalogText> CatalogText::open(const QString &path) {
+    QSharedPointer<CatalogText> text(new CatalogText);
+    text->file.setFileName(path);
+    if (!text->file.open(QIODevice::ReadOnly)) {
+        return QSharedPointer<const CatalogText>();
+    }
+
+    // Map the whole file read-only. Empty files cannot be mapped, and neither can some special files.
+    qint64 size = text->file.size();
+    const uchar *data = size > 0 ? text->file.map(0, size) : nullptr;
+    if (data) {
+        text->view = std::string_view(reinterpret_cast<const char *>(data), size_t(size));
+    }
+    else {
+        text->buffer = text->file.readAll();
+        text->view = bytesOf(text->buffer);
+    }
+    return text;
+}
+
+std::string_view CatalogText::bytes() const {
+    return view;
+}
+
+CatalogCache::CatalogCache(const QString &cachePath)
+    : cachePath(cachePath) // Location of the compiled cache file.
+{
+}
+
+QSharedPointer<const CatalogImage> CatalogCache::map() const {
+    return CatalogImage::fromFile(cachePath);
+}
+
+void CatalogCache::store(const QByteArray &image) const {
+    // Failing to write the cache only costs another parse on the next launch.
+    QDir().mkpath(QFileInfo(cachePath).absolutePath());
+    QSaveFile file(cachePath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(image);
+        file.commit();
+    }
+}
+
+bool CatalogCache::isFresh(const CatalogImage &image, const QString &source) {
+    // Catalogs missing from the image are stale.
+    int index = image.findSource(source);
+    if (index < 0) {
+        return false;
+    }
+    const auto &record = image.source(index);
+
+    // An unchanged modification time and size is enough to trust the image.
+    QFileInfo info(source);
+    if (record.mtime == info.lastModified().toMSecsSinceEpoch() && record.size == info.size()) {
+        return true;
+    }
+
+    // Otherwise compare the content, so a touched but unchanged file does not force a rebuild.
+    auto text = CatalogText::open(source);
+    return text && hashContent(text->bytes()) == record.hash;
+}
+
+ParsedCatalog CatalogCache::parse(const QString &source) {
+    ParsedCatalog catalog;
+
+    // Leave the path empty for catalogs that cannot be read.
+    catalog.text = CatalogText::open(source);
+    if (!catalog.text) {
+        return catalog;
+    }
+    const std::string_view text = catalog.text->bytes();
+
+    catalog.path = source;
+    catalog.mtime = QFileInfo(source).lastModified().toMSecsSinceEpoch();
+    catalog.size = qint64(text.size());
+    catalog.hash = hashContent(text);
+
+    // Catalogs of a newer format start with their version; everything else is a legacy catalog.
+    LineReader lines(text);
+    std::string_view first;
+    LineReader header = lines;
+    if (header.next(first) && trimmed(first).substr(0, 8) == "catalog ") {
+        std::string_view version = trimmed(trimmed(first).substr(8));
+        if (version != "2") {
+            report(catalog, 1, QString("unsupported catalog version %1").arg(quoted(version)), true);
+            return catalog;
+        }
+        catalog.version = 2;
+        parseKeywords(header, catalog);
+    }
+    else {
+        catalog.version = 1;
+        parseTriplets(lines, catalog);
+    }
+    return catalog;
+}
+
+QByteArray CatalogCache::build(const QVector<ParsedCatalog> &catalogs) {
+    QVector<CatalogImage::SourceRecord> records;      // One record per text catalog.
+    QVector<CatalogImage::StringRef> packageNames;    // Interned package names, indexed by ID.
+    QVector<CatalogImage::EntryRecord> entries;       // Entries of all catalogs.
+    QVector<CatalogImage::StringRef> lists;           // Tags, commands and dependencies of all entries.
+    QVector<quint32> ids;                             // Package ID lists of all entries.
+    QByteArray strings;                               // String table.
+    QHash<QByteArray, quint32> packageIndex;          // Maps package names to their IDs.
+    QHash<QByteArray, CatalogImage::StringRef> groups; // Group titles, stored once for all their entries.
+
+    // Appends a string to the string table and returns its reference.
+    auto addString = [&strings](std::string_view value) {
+        CatalogImage::StringRef ref = { quint32(strings.size()), quint32(value.size()) };
+        strings.append(value.data(), int(value.size()));
+        return ref;
+    };
+
+    // Appends strings to the list section and returns how many there were.
+    auto addList = [&lists, &addString](const QVector<std::string_view> &values) {
+        for (std::string_view value : values) {
+            lists.append(addString(value));
+        }
+        return quint32(values.size());
+    };
+
+    // The keys point into the parsed texts, which outlive the hashes.
+    auto key = [](std::string_view value) {
+        return QByteArray::fromRawData(value.data(), int(value.size()));
+    };
+
+    for (const ParsedCatalog &catalog : catalogs) {
+        // Skip catalogs that could not be read.
+        if (catalog.path.isEmpty()) {
+            continue;
+        }
+
+        CatalogImage::SourceRecord record = {};
+        record.mtime = catalog.mtime;
+        record.size = catalog.size;
+        record.hash = catalog.hash;
+        record.path = addString(bytesOf(catalog.path.toUtf8()));
+        record.firstEntry = quint32(entries.size());
+
+        for (const ParsedCatalog::Entry &parsed : catalog.entries) {
+            CatalogImage::EntryRecord entry = {};
+            entry.id = addString(parsed.id);
+            entry.display = addString(parsed.display);
+            entry.firstPackage = quint32(ids.size());
+            entry.flags = parsed.defaultChecked ? CatalogImage::DefaultChecked : 0;
+
+            auto group = groups.constFind(key(parsed.group));
+            if (group == groups.constEnd()) {
+                group = groups.insert(key(parsed.group), addString(parsed.group));
+            }
+            entry.group = group.value();
+
+            // Intern every package name, so each name is stored once for all catalogs.
+            for (std::string_view name : parsed.packages) {
+                auto it = packageIndex.constFind(key(name));
+                if (it == packageIndex.constEnd()) {
+                    it = packageIndex.insert(key(name), quint32(packageNames.size()));
+                    packageNames.append(addString(name));
+                }
+                ids.append(it.value());
+            }
+            entry.packageCount = quint32(ids.size()) - entry.firstPackage;
+
+            // The lists of an entry are stored back to back, in the order of EntryRecord.
+            entry.firstList = quint32(lists.size());
+            entry.tagCount = addList(parsed.tags);
+            entry.prepareCount = addList(parsed.prepare);
+            entry.setupCount = addList(parsed.setup);
+            entry.afterCount = addList(parsed.after);
+
+            entries.append(entry);
+        }
+
+        record.entryCount = quint32(entries.size()) - record.firstEntry;
+        records.append(record);
+    }
+
+    CatalogImage::Header header = {};
+    header.magic = CatalogImage::MAGIC;
+    header.version = CatalogImage::VERSION;
+    header.sourceCount = quint32(records.size());
+    header.packageCount = quint32(packageNames.size());
+    header.entryCount = quint32(entries.size());
+    header.idCount = quint32(ids.size());
+    header.stringsSize = quint32(strings.size());
+    header.listCount = quint32(lists.size());
+
+    // Lay out the sections in the order documented in catalog.h.
+    QByteArray image(reinterpret_cast<const char *>(&header), int(sizeof(header)));
+    appendRecords(image, records);
+    appendRecords(image, packageNames);
+    appendRecords(image, entries);
+    appendRecords(image, lists);
+    appendRecords(image, ids);
+    image += strings;
+    return image;
+}
+
+QByteArray CatalogCache::compile(const QStringList &sources) {
+    QVector<ParsedCatalog> catalogs;
+    for (const QString &source : sources) {
+        catalogs.append(parse(source));
+    }
+    return build(catalogs);
+}
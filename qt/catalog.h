@@ -0,0 +1,251 @@
+#ifndef CATALOG_H // Start of include guard to prevent multiple inclusions of this header file.
+#define CATALOG_H // Define the include guard macro.
+
+#include <QByteArray> // Holds a catalog image that was built in memory.
+#include <QFile> // Keeps the memory-mapped cache file open.
+#include <QSharedPointer> // Shares one catalog image between all catalogs stored in it.
+#include <QStringList> // Used to return package names.
+#include <QVector> // Used to return package IDs.
+
+#include <string_view> // Parsed catalogs point into the text instead of copying it.
+
+// A compiled catalog image, either memory-mapped from the cache file or built in memory from the text catalogs.
+//
+// Layout (native byte order, the cache is never shared between machines):
+//   Header
+//   SourceRecord[sourceCount]      one per text catalog, with its staleness key and entry range
+//   StringRef[packageCount]        interned package names, shared by every catalog in the image
+//   EntryRecord[entryCount]        fixed-width entries of all catalogs
+//   StringRef[listCount]           tags, commands and dependencies referenced by the entries
+//   quint32[idCount]               package ID lists referenced by the entries
+//   char[stringsSize]              UTF-8 string table
+class CatalogImage
+{
+public:
+    // Reference to a UTF-8 string inside the string table.
+    struct StringRef {
+        quint32 offset; // Byte offset into the string table.
+        quint32 length; // Length in bytes.
+    };
+
+    // Fixed-size header at the start of the image.
+    struct Header {
+        quint32 magic;        // Always CatalogImage::MAGIC.
+        quint32 version;      // Always CatalogImage::VERSION.
+        quint32 sourceCount;  // Number of SourceRecords.
+        quint32 packageCount; // Number of interned package names.
+        quint32 entryCount;   // Number of EntryRecords.
+        quint32 idCount;      // Number of package IDs.
+        quint32 stringsSize;  // Size of the string table in bytes.
+        quint32 listCount;    // Number of StringRefs in the list section.
+    };
+
+    // One text catalog compiled into the image.
+    struct SourceRecord {
+        qint64 mtime;       // Modification time of the text file in milliseconds since the epoch.
+        qint64 size;        // Size of the text file in bytes.
+        quint64 hash;       // Content hash of the text file, checked when the mtime or size differs.
+        StringRef path;     // Absolute path of the text file.
+        quint32 firstEntry; // Index of the first EntryRecord of this catalog.
+        quint32 entryCount; // Number of entries of this catalog.
+    };
+
+    // One catalog entry.
+    struct EntryRecord {
+        StringRef id;         // Id of the entry, empty for legacy entries.
+        StringRef display;    // Display text.
+        StringRef group;      // Title of the group the entry belongs to, may be empty.
+        quint32 firstPackage; // Index of the first package ID of this entry.
+        quint32 packageCount; // Number of package IDs of this entry.
+        quint32 firstList;    // Index of the first list string of this entry: the tags, prepare commands,
+                              // setup commands and "after" ids, in that order.
+        quint32 tagCount;     // Number of tags.
+        quint32 prepareCount; // Number of prepare commands.
+        quint32 setupCount;   // Number of setup commands.
+        quint32 afterCount;   // Number of entries this one waits for.
+        quint32 flags;        // Combination of EntryFlag values.
+    };
+
+    // Bits stored in EntryRecord::flags.
+    enum EntryFlag : quint32 {
+        DefaultChecked = 1 // The entry is checked by default.
+    };
+
+    static constexpr quint32 MAGIC = 0x43424f53; // "SOBC"
+    static constexpr quint32 VERSION = 2;
+
+    // Wraps an image; returns null if the data is not a valid image of the current version.
+    static QSharedPointer<CatalogImage> fromBuffer(const QByteArray &buffer);
+    static QSharedPointer<CatalogImage> fromFile(const QString &filename);
+
+    ~CatalogImage();
+
+    // Accessors for the sections of the image.
+    const Header &header() const;
+    const SourceRecord &source(int index) const;
+    const EntryRecord &entry(int index) const;
+    const StringRef *lists() const;
+    const quint32 *packageIds() const;
+    QByteArray string(const StringRef &ref) const;
+    QByteArray packageName(quint32 id) const;
+
+    // Returns the index of the source compiled from the given path, or -1.
+    int findSource(const QString &path) const;
+
+private:
+    CatalogImage() = default;
+
+    // Checks the header and section sizes against the size of the data, and every reference against its section.
+    bool validate() const;
+
+    const uchar *data = nullptr; // Start of the image.
+    qint64 size = 0;             // Size of the image in bytes.
+    QByteArray buffer;           // Owns the data when the image was built in memory.
+    QFile file;                  // Owns the mapping when the image was loaded from the cache.
+};
+
+// Read-only view of one catalog inside a CatalogImage. Cheap to copy.
+class Catalog
+{
+public:
+    Catalog() = default;
+    Catalog(QSharedPointer<const CatalogImage> image, int source);
+
+    // True if the catalog does not refer to any image.
+    bool isNull() const;
+
+    // Number of entries in the catalog.
+    int size() const;
+
+    // Per-entry accessors; strings are only decoded when requested.
+    QString display(int entry) const;
+    bool defaultChecked(int entry) const;
+    QStringList packages(int entry) const;
+    QVector<quint32> packageIds(int entry) const;
+
+    // Metadata of catalogs in the v2 format; empty for legacy entries.
+    QString id(int entry) const;
+    QString group(int entry) const;
+    QStringList tags(int entry) const;
+    QStringList prepareCommands(int entry) const;
+    QStringList setupCommands(int entry) const;
+    QStringList after(int entry) const;
+
+    // Whether the entry has prepare or setup commands.
+    bool hasCommands(int entry) const;
+
+    // Whether the entry has prepare commands, which may add the repository of its packages.
+    bool hasPrepareCommands(int entry) const;
+
+    // Name of an interned package ID, shared by every catalog of the same image.
+    QString packageName(quint32 id) const;
+
+private:
+    // Returns the record of an entry.
+    const CatalogImage::EntryRecord &record(int entry) const;
+
+    // Decodes count strings of the list section, starting at first.
+    QStringList list(quint32 first, quint32 count) const;
+
+    QSharedPointer<const CatalogImage> image; // Image holding the data of this catalog.
+    int source = -1;                          // Index of the catalog's SourceRecord.
+};
+
+// The bytes of a text catalog, memory-mapped so parsing and hashing never copy them.
+// Files that cannot be mapped, e.g. empty ones, are read into memory instead.
+class CatalogText
+{
+public:
+    // Returns null if the file cannot be read.
+    static QSharedPointer<const CatalogText> open(const QString &path);
+
+    // Content of the file.
+    std::string_view bytes() const;
+
+private:
+    CatalogText() = default;
+
+    QFile file;             // Owns the mapping.
+    QByteArray buffer;      // Owns the content when the file could not be mapped.
+    std::string_view view;  // Content of the file.
+};
+
+// A text catalog parsed in memory, before it is compiled into a CatalogImage.
+//
+// Two formats are read. Legacy catalogs are triplets of lines: "true" or "false", the package names and
+// the display text. Catalogs starting with the line "catalog 2" hold one "<keyword> <value>" per line:
+//   catalog 2
+//   # Comments and blank lines are ignored.
+//   group Desktop                 title of the group of the following entries
+//   entry KDE                     starts an entry; the id names its commands and is unique in the catalog
+//   display Additional KDE applications
+//   packages ark kate             package names; may be repeated
+//   default false                 "true" checks the entry by default
+//   tags kde plasma               words the search also matches
+//   prepare <command>             command run before installing; one per line, run in order
+//   setup <command>               command run after installing; one per line, run in order
+//   after Performance             ids of the entries whose commands have to run first
+struct ParsedCatalog
+{
+    // A problem found while parsing, e.g. "webapp.txt:7: ...".
+    struct Diagnostic {
+        int line;        // Line number, starting at 1.
+        QString message; // What is wrong.
+        bool error;      // Whether the line was skipped; warnings keep the entry.
+    };
+
+    // One catalog entry. The strings point into the text of the catalog.
+    struct Entry {
+        std::string_view id;                // Id, empty for legacy entries.
+        std::string_view display;           // Display text.
+        std::string_view group;             // Title of the group, may be empty.
+        QVector<std::string_view> packages; // Package names.
+        QVector<std::string_view> tags;     // Search words.
+        QVector<std::string_view> prepare;  // Commands run before installing.
+        QVector<std::string_view> setup;    // Commands run after installing.
+        QVector<std::string_view> after;    // Ids of the entries to wait for.
+        bool defaultChecked = false;        // Checked by default.
+    };
+
+    QString path;                       // Absolute path of the text file, empty if it could not be read.
+    qint64 mtime = 0;                   // Modification time in milliseconds since the epoch.
+    qint64 size = 0;                    // Size in bytes.
+    quint64 hash = 0;                   // Content hash.
+    int version = 0;                    // Format of the file: 1 for legacy triplets, 2 for keywords.
+    QVector<Entry> entries;             // Entries in file order.
+    QVector<Diagnostic> diagnostics;    // Problems found, in the order they were found.
+    QSharedPointer<const CatalogText> text; // Keeps the bytes the entries point into alive.
+};
+
+// Compiles the text catalogs into a single CatalogImage and keeps it in an on-disk cache.
+// Mapping a fresh cache only needs the file mapping and a stat of each source, so it does not depend on the catalog size.
+class CatalogCache
+{
+public:
+    // Parameters:
+    // - cachePath: Location of the compiled cache file.
+    explicit CatalogCache(const QString &cachePath);
+
+    // Maps the cache file, returning null if it is missing or invalid.
+    QSharedPointer<const CatalogImage> map() const;
+
+    // Atomically replaces the cache file with the given image.
+    void store(const QByteArray &image) const;
+
+    // Checks whether the catalog compiled from the given text file is still up to date in the image.
+    static bool isFresh(const CatalogImage &image, const QString &source);
+
+    // Parses one text catalog in a single pass over its mapped bytes, collecting diagnostics for invalid lines.
+    static ParsedCatalog parse(const QString &source);
+
+    // Compiles parsed catalogs into one image, interning package names across all of them.
+    static QByteArray build(const QVector<ParsedCatalog> &catalogs);
+
+    // Parses the given text catalogs and returns the compiled image.
+    static QByteArray compile(const QStringList &sources);
+
+private:
+    QString cachePath; // Location of the compiled cache file.
+};
+
+#endif // CATALOG_H // End of the include guard.
@@ -0,0 +1,84 @@
+#include "catalogindex.h" // Includes the header file for the CatalogIndex class.
+
+#include <algorithm> // Used to order and intersect the posting lists.
+#include <numeric> // Used to list every entry for an empty query.
+
+CatalogIndex::CatalogIndex(const Catalog &catalog) {
+    haystacks.reserve(catalog.size());
+
+    for (int entry = 0; entry < catalog.size(); entry++) {
+        // Search the display text, the package names, the group and the tags together.
+        QStringList words = QStringList { catalog.display(entry) } + catalog.packages(entry) + catalog.tags(entry);
+        if (!catalog.group(entry).isEmpty()) {
+            words += catalog.group(entry);
+        }
+        QByteArray text = words.join(' ').toLower().toUtf8();
+
+        // Record every 1-, 2- and 3-byte n-gram of the text. Entries are visited in order,
+        // so checking the last element is enough to keep each posting list sorted and unique.
+        for (int length = 1; length <= 3; length++) {
+            for (int i = 0; i + length <= text.size(); i++) {
+                QVector<int> &list = postings[gram(text.constData() + i, length)];
+                if (list.isEmpty() || list.last() != entry) {
+                    list.append(entry);
+                }
+            }
+        }
+
+        haystacks.append(text);
+    }
+}
+
+QVector<int> CatalogIndex::search(const QString &query) const {
+    const QByteArray needle = query.trimmed().toLower().toUtf8();
+
+    // An empty query matches everything.
+    if (needle.isEmpty()) {
+        QVector<int> all(haystacks.size());
+        std::iota(all.begin(), all.end(), 0);
+        return all;
+    }
+
+    // Queries of up to three bytes are an n-gram themselves, so their posting list is the exact answer.
+    if (needle.size() <= 3) {
+        return postings.value(gram(needle.constData(), needle.size()));
+    }
+
+    // Longer queries: collect the posting lists of all their trigrams, shortest first.
+    QVector<const QVector<int> *> lists;
+    for (int i = 0; i + 3 <= needle.size(); i++) {
+        auto it = postings.constFind(gram(needle.constData() + i, 3));
+        if (it == postings.constEnd()) {
+            return QVector<int>(); // A trigram no entry contains rules out every entry.
+        }
+        lists.append(&it.value());
+    }
+    std::sort(lists.begin(), lists.end(), [](const QVector<int> *a, const QVector<int> *b) {
+        return a->size() < b->size();
+    });
+
+    // Walk the shortest list, keep the entries present in all other lists,
+    // then confirm the trigrams actually appear as one contiguous substring.
+    QVector<int> matches;
+    for (int entry : *lists.first()) {
+        bool candidate = std::all_of(lists.begin() + 1, lists.end(), [entry](const QVector<int> *list) {
+            return std::binary_search(list->begin(), list->end(), entry);
+        });
+        if (candidate && haystacks.at(entry).contains(needle)) {
+            matches.append(entry);
+        }
+    }
+    return matches;
+}
+
+int CatalogIndex::size() const {
+    return haystacks.size();
+}
+
+quint32 CatalogIndex::gram(const char *bytes, int length) {
+    quint32 key = quint32(length) << 24;
+    for (int i = 0; i < length; i++) {
+        key |= quint32(static_cast<uchar>(bytes[i])) << (16 - 8 * i);
+    }
+    return key;
+}
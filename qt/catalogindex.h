@@ -0,0 +1,34 @@
+#ifndef CATALOGINDEX_H // Start of include guard to prevent multiple inclusions of this header file.
+#define CATALOGINDEX_H // Define the include guard macro.
+
+#include "catalog.h" // Catalog whose entries are indexed.
+
+#include <QHash> // Maps n-grams to the entries containing them.
+#include <QVector> // Sorted posting lists.
+
+// Search index over the display text, package names, group and tags of one catalog.
+// Every 1-, 2- and 3-byte substring (n-gram) of the lowercase text points to the sorted list of entries containing it,
+// so a query only touches the entries that share its n-grams instead of scanning the whole catalog.
+// The index is immutable once built and can be shared between threads.
+class CatalogIndex
+{
+public:
+    // Builds the index for all entries of the catalog.
+    explicit CatalogIndex(const Catalog &catalog);
+
+    // Returns the sorted indexes of the entries containing the query, ignoring case.
+    // An empty query matches every entry.
+    QVector<int> search(const QString &query) const;
+
+    // Number of indexed entries.
+    int size() const;
+
+private:
+    // Packs an n-gram of up to three bytes together with its length into a single key.
+    static quint32 gram(const char *bytes, int length);
+
+    QHash<quint32, QVector<int>> postings; // Entries containing each n-gram, in ascending order.
+    QVector<QByteArray> haystacks;          // Lowercase UTF-8 text of every entry, used to confirm longer queries.
+};
+
+#endif // CATALOGINDEX_H // End of the include guard.
@@ -0,0 +1,102 @@
+#include "catalogloader.h" // Includes the header file for the CatalogLoader class.
+
+#include <QDebug> // Reports the invalid lines of the catalogs.
+#include <QDir> // Used to discover the catalogs of a directory.
+#include <QtConcurrent/QtConcurrentRun> // Runs the loading and parsing jobs on the global thread pool.
+
+CatalogLoader::CatalogLoader(const QString &cachePath, QObject *parent)
+    : QObject(parent) // Initializes the base QObject with the given parent.
+    , cache(cachePath) // Compiled catalog cache.
+{
+}
+
+CatalogLoader::~CatalogLoader() {
+    // The worker refers to this object, so it has to finish first.
+    job.waitForFinished();
+}
+
+void CatalogLoader::start(const QString &directory) {
+    // Catalogs are only loaded once per process.
+    if (started) {
+        return;
+    }
+    started = true;
+
+    job = QtConcurrent::run([this, directory]() { run(directory); });
+}
+
+template<typename Function>
+void CatalogLoader::deliver(Function function) {
+    QMetaObject::invokeMethod(this, function, Qt::QueuedConnection);
+}
+
+void CatalogLoader::publish(const QString &source, const Catalog &catalog) {
+    QSharedPointer<const CatalogIndex> index(new CatalogIndex(catalog));
+    deliver([this, source, catalog, index]() { emit catalogLoaded(source, catalog, index); });
+}
+
+void CatalogLoader::run(const QString &directory) {
+    // Discover every catalog of the directory.
+    QDir dir(directory);
+    QStringList sources;
+    for (const QString &name : dir.entryList({ "*.txt" }, QDir::Files, QDir::Name)) {
+        sources += dir.absoluteFilePath(name);
+    }
+    deliver([this, sources]() { emit catalogsFound(sources); });
+
+    // Hand out every catalog that is still up to date in the compiled cache right away,
+    // indexing them in parallel.
+    auto image = cache.map();
+    QStringList stale;
+    QVector<QFuture<void>> publishing;
+    for (const QString &source : sources) {
+        if (image && CatalogCache::isFresh(*image, source)) {
+            Catalog catalog(image, image->findSource(source));
+            publishing.append(QtConcurrent::run([this, source, catalog]() { publish(source, catalog); }));
+        }
+        else {
+            stale += source;
+        }
+    }
+
+    // Parse every catalog in parallel if the cache has to be rebuilt.
+    // Stale catalogs are handed out as soon as their own parse finishes.
+    QVector<QFuture<ParsedCatalog>> parsing;
+    if (!stale.isEmpty() || !image || image->header().sourceCount != quint32(sources.size())) {
+        for (const QString &source : sources) {
+            bool pending = stale.contains(source);
+            parsing.append(QtConcurrent::run([this, source, pending]() {
+                ParsedCatalog parsed = CatalogCache::parse(source);
+
+                // Point at the lines that were skipped or guessed, in the "file:line:" form editors understand.
+                // Catalogs are only parsed when they changed, so the problems show up once per edit.
+                for (const ParsedCatalog::Diagnostic &diagnostic : parsed.diagnostics) {
+                    qWarning().noquote() << QString("%1:%2: %3: %4").arg(source).arg(diagnostic.line)
+                                            .arg(diagnostic.error ? "error" : "warning", diagnostic.message);
+                }
+                if (pending) {
+                    Catalog catalog;
+                    if (!parsed.path.isEmpty()) {
+                        catalog = Catalog(CatalogImage::fromBuffer(CatalogCache::build({ parsed })), 0);
+                    }
+                    publish(source, catalog);
+                }
+                return parsed;
+            }));
+        }
+    }
+
+    // Compile all catalogs into a single image, sharing one package-name table, for the next launch.
+    if (!parsing.isEmpty()) {
+        QVector<ParsedCatalog> parsed;
+        for (auto &future : parsing) {
+            parsed.append(future.result());
+        }
+        cache.store(CatalogCache::build(parsed));
+    }
+
+    for (auto &future : publishing) {
+        future.waitForFinished();
+    }
+    deliver([this]() { emit finished(); });
+}
@@ -0,0 +1,56 @@
+#ifndef CATALOGLOADER_H // Start of include guard to prevent multiple inclusions of this header file.
+#define CATALOGLOADER_H // Define the include guard macro.
+
+#include "catalog.h" // Compiled catalogs handed to the UI.
+#include "catalogindex.h" // Search indexes built alongside the catalogs.
+
+#include <QFuture> // Tracks the background loading job.
+#include <QObject> // Base class providing signals and slots.
+
+// Discovers and loads the catalogs of a directory on the global thread pool.
+// Catalogs are reported one by one as soon as they are available, so the UI never waits for the slowest one.
+// All signals are emitted on the thread that owns the loader.
+class CatalogLoader : public QObject
+{
+    Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
+
+public:
+    // Constructor for the CatalogLoader class.
+    // Parameters:
+    // - cachePath: Location of the compiled catalog cache.
+    // - parent: Pointer to the parent object that owns the loader.
+    explicit CatalogLoader(const QString &cachePath, QObject *parent = nullptr);
+
+    // Waits for a running load, so no worker outlives the loader.
+    ~CatalogLoader();
+
+    // Starts loading every "*.txt" catalog of the given directory. Does nothing if a load was already started.
+    void start(const QString &directory);
+
+signals:
+    // Emitted once the catalogs of the directory are known, before any of them is loaded.
+    void catalogsFound(const QStringList &sources);
+
+    // Emitted for each catalog as soon as it and its search index are ready.
+    void catalogLoaded(const QString &source, const Catalog &catalog, const QSharedPointer<const CatalogIndex> &index);
+
+    // Emitted after every catalog was reported and the cache is up to date.
+    void finished();
+
+private:
+    // Runs on a worker thread.
+    void run(const QString &directory);
+
+    // Indexes a catalog and hands both to the owning thread. Runs on a worker thread.
+    void publish(const QString &source, const Catalog &catalog);
+
+    // Queues a call to the thread that owns the loader.
+    template<typename Function>
+    void deliver(Function function);
+
+    CatalogCache cache;   // Compiled catalog cache.
+    QFuture<void> job;    // Background loading job.
+    bool started = false; // Whether start() was already called.
+};
+
+#endif // CATALOGLOADER_H // End of the include guard.
@@ -0,0 +1,291 @@
+#include "catalogmodel.h" // Includes the header file for the CatalogModel class.
+
+#include <QHash> // Caches the installed state of the packages shared by several entries.
+
+CatalogModel::CatalogModel(QObject *parent)
+    : QAbstractListModel(parent) // Initializes the base list model with the given parent.
+{
+}
+
+void CatalogModel::setCatalog(const Catalog &catalog) {
+    beginResetModel();
+    this->catalog = catalog;
+    hidden = QBitArray(catalog.size());
+    matches.clear();
+    searching = false;
+    visible.clear();
+    filtered = false;
+
+    // Start every entry from the default state declared in the catalog.
+    checked = QBitArray(catalog.size());
+    for (int i = 0; i < catalog.size(); i++) {
+        checked.setBit(i, catalog.defaultChecked(i));
+    }
+    installed = QBitArray(catalog.size());
+    updateInstalled();
+
+    endResetModel();
+}
+
+void CatalogModel::setSyncDatabase(const QSharedPointer<const SyncDatabase> &database) {
+    syncDatabase = database;
+    updateInstalled(); // Whole groups can only be recognized with the sync databases.
+
+    // Availability affects the flags and tooltips of every row.
+    if (rowCount() > 0) {
+        emit dataChanged(index(0), index(rowCount() - 1));
+    }
+}
+
+void CatalogModel::setLocalDatabase(const QSharedPointer<const LocalDatabase> &database) {
+    localDatabase = database;
+    updateInstalled();
+
+    // The installed state affects the text, check state and flags of every row.
+    if (rowCount() > 0) {
+        emit dataChanged(index(0), index(rowCount() - 1));
+    }
+}
+
+void CatalogModel::updateInstalled() {
+    // Nothing is known to be installed before the database was read, or if it could not be read.
+    if (!localDatabase || localDatabase->isEmpty()) {
+        installed.fill(false);
+        return;
+    }
+
+    // Entries share packages, so every package is looked up once, by its id in the catalog image.
+    QHash<quint32, bool> packages;
+    SyncDatabase sync = syncDatabase ? *syncDatabase : SyncDatabase();
+    for (int i = 0; i < catalog.size(); i++) {
+        const QVector<quint32> ids = catalog.packageIds(i);
+        bool all = !ids.isEmpty();
+        for (quint32 id : ids) {
+            auto it = packages.constFind(id);
+            if (it == packages.constEnd()) {
+                it = packages.insert(id, localDatabase->isFullyInstalled(catalog.packageName(id).toUtf8(), sync));
+            }
+            if (!it.value()) {
+                all = false;
+                break;
+            }
+        }
+        installed.setBit(i, all);
+
+        // An installed entry needs nothing new, so it leaves the selection.
+        if (all && checked.testBit(i)) {
+            checked.clearBit(i);
+            emit entryToggled(i, false);
+        }
+    }
+}
+
+bool CatalogModel::isInstalled(int entry) const {
+    return installed.testBit(entry);
+}
+
+QStringList CatalogModel::missingPackages(int entry) const {
+    // Nothing is known to be missing before the databases were read, or if none could be read.
+    if (!syncDatabase || syncDatabase->isEmpty()) {
+        return QStringList();
+    }
+
+    // The prepare commands of an entry may add the repository of its packages, e.g. BlackArch's strap.sh,
+    // so they are checked once those ran (see apply.sh).
+    if (catalog.hasPrepareCommands(entry)) {
+        return QStringList();
+    }
+    return syncDatabase->missing(catalog.packages(entry));
+}
+
+void CatalogModel::setHardware(const HardwareProbe &probe, const HardwareRules &rules) {
+    // Without rules every entry is offered with its catalog default.
+    if (rules.isEmpty()) {
+        return;
+    }
+
+    beginResetModel();
+    for (int i = 0; i < catalog.size(); i++) {
+        const QStringList packages = catalog.packages(i);
+        bool shown = rules.isShown(packages, probe);
+        hidden.setBit(i, !shown);
+
+        // Hidden entries leave the selection; entries checked by the rules join it unless they are installed.
+        bool state = shown && !installed.testBit(i) && (checked.testBit(i) || rules.isChecked(packages, probe));
+        if (state != checked.testBit(i)) {
+            checked.setBit(i, state);
+            emit entryToggled(i, state);
+        }
+    }
+    updateRows();
+    endResetModel();
+}
+
+bool CatalogModel::isHidden(int entry) const {
+    return hidden.testBit(entry);
+}
+
+void CatalogModel::setFilter(const QVector<int> &entries) {
+    beginResetModel();
+    matches = entries;
+    searching = true;
+    updateRows();
+    endResetModel();
+}
+
+void CatalogModel::clearFilter() {
+    beginResetModel();
+    matches.clear();
+    searching = false;
+    updateRows();
+    endResetModel();
+}
+
+void CatalogModel::updateRows() {
+    visible.clear();
+    filtered = searching || hidden.count(true) > 0;
+    if (!filtered) {
+        return;
+    }
+
+    // Hidden entries are left out of the search matches, or of the whole catalog without a search.
+    if (searching) {
+        for (int entry : matches) {
+            if (!hidden.testBit(entry)) {
+                visible += entry;
+            }
+        }
+    }
+    else {
+        for (int entry = 0; entry < catalog.size(); entry++) {
+            if (!hidden.testBit(entry)) {
+                visible += entry;
+            }
+        }
+    }
+}
+
+int CatalogModel::entryAt(int row) const {
+    return filtered ? visible.at(row) : row;
+}
+
+int CatalogModel::rowCount(const QModelIndex &parent) const {
+    // A list model has no children below its top-level rows.
+    if (parent.isValid()) {
+        return 0;
+    }
+    return filtered ? visible.size() : catalog.size();
+}
+
+QVariant CatalogModel::data(const QModelIndex &index, int role) const {
+    // Ignore indexes that do not point to an existing row.
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return QVariant();
+    }
+    int entry = entryAt(index.row());
+
+    switch (role) {
+    case Qt::DisplayRole:
+        // Decoded only for the rows the view asks for.
+        return installed.testBit(entry) ? catalog.display(entry) + " (installed)" : catalog.display(entry);
+    case Qt::CheckStateRole:
+        // Check indicator drawn by the delegate; installed entries are shown as done.
+        return checked.testBit(entry) || installed.testBit(entry) ? Qt::Checked : Qt::Unchecked;
+    case Qt::ToolTipRole: {
+        // Explain why an entry is disabled.
+        if (installed.testBit(entry)) {
+            return "Already installed";
+        }
+        QStringList missing = missingPackages(entry);
+        if (!missing.isEmpty()) {
+            return "Not available in the enabled repositories: " + missing.join(' ');
+        }
+
+        // Otherwise describe what the catalog says about the entry, if anything.
+        QStringList details;
+        if (!catalog.group(entry).isEmpty()) {
+            details += "Group: " + catalog.group(entry);
+        }
+        if (catalog.hasCommands(entry)) {
+            details += "Also runs commands before or after installing";
+        }
+        return details.isEmpty() ? QVariant() : QVariant(details.join('\n'));
+    }
+    case PackagesRole:
+        return catalog.packages(entry);
+    default:
+        return QVariant();
+    }
+}
+
+bool CatalogModel::setData(const QModelIndex &index, const QVariant &value, int role) {
+    // Only the check state of an existing entry is editable.
+    if (!index.isValid() || index.row() >= rowCount() || role != Qt::CheckStateRole) {
+        return false;
+    }
+
+    int entry = entryAt(index.row());
+    bool state = value.toInt() == Qt::Checked;
+    if (installed.testBit(entry)) {
+        return false;
+    }
+    if (checked.testBit(entry) == state) {
+        return true;
+    }
+
+    checked.setBit(entry, state);
+    emit dataChanged(index, index, { Qt::CheckStateRole });
+    emit entryToggled(entry, state);
+    return true;
+}
+
+Qt::ItemFlags CatalogModel::flags(const QModelIndex &index) const {
+    // Every row is a selectable, checkable item.
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+
+    // Entries that are already installed, or with packages that cannot be installed, are shown disabled.
+    int entry = entryAt(index.row());
+    Qt::ItemFlags flags = Qt::ItemIsSelectable | Qt::ItemIsUserCheckable;
+    if (!installed.testBit(entry) && missingPackages(entry).isEmpty()) {
+        flags |= Qt::ItemIsEnabled;
+    }
+    return flags;
+}
+
+QVector<int> CatalogModel::checkedEntries() const {
+    QVector<int> entries;
+    for (int i = 0; i < catalog.size(); i++) {
+        if (checked.testBit(i)) {
+            entries += i;
+        }
+    }
+    return entries;
+}
+
+void CatalogModel::setCheckedEntries(const QVector<int> &entries) {
+    checked.fill(false);
+    for (int entry : entries) {
+        if (entry >= 0 && entry < catalog.size() && !installed.testBit(entry) && !hidden.testBit(entry)) {
+            checked.setBit(entry);
+        }
+    }
+
+    if (rowCount() > 0) {
+        emit dataChanged(index(0), index(rowCount() - 1), { Qt::CheckStateRole });
+    }
+}
+
+QStringList CatalogModel::checkedPackages() const {
+    QStringList packages;
+
+    // Collect the packages of every checked entry.
+    for (int i = 0; i < catalog.size(); i++) {
+        if (checked.testBit(i)) {
+            packages += catalog.packages(i);
+        }
+    }
+
+    return packages;
+}
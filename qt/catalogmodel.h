@@ -0,0 +1,108 @@
+#ifndef CATALOGMODEL_H // Start of include guard to prevent multiple inclusions of this header file.
+#define CATALOGMODEL_H // Define the include guard macro.
+
+#include "catalog.h" // Compiled catalog data displayed by the model.
+#include "hardwareprobe.h" // Hardware the entries are offered for.
+#include "hardwarerules.h" // Which entries the hardware shows and checks.
+#include "localdatabase.h" // Installed packages used to mark entries that are already installed.
+#include "syncdatabase.h" // Package availability used to mark entries that cannot be installed.
+
+#include <QAbstractListModel> // Base class for list models consumed by item views such as QListView.
+#include <QBitArray> // Compact storage for the check state of every entry.
+#include <QStringList> // Used to return the package names of the selected entries.
+
+// List model backing one catalog tab (e.g. "webapp.txt") of the select widget.
+// Every entry is shown as a checkable row, so the view only materializes the rows that are visible
+// instead of the old approach of creating one QCheckBox per catalog line.
+class CatalogModel : public QAbstractListModel
+{
+    Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
+
+public:
+    // Custom roles exposed in addition to the standard display/check state roles.
+    enum Role {
+        PackagesRole = Qt::UserRole + 1 // Package names of the entry, as a QStringList.
+    };
+
+    // Constructor for the CatalogModel class.
+    // Parameters:
+    // - parent: Pointer to the parent object that owns the model.
+    explicit CatalogModel(QObject *parent = nullptr);
+
+    // Displays the given catalog, resetting every entry to its catalog default.
+    void setCatalog(const Catalog &catalog);
+
+    // QAbstractListModel interface.
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    // Marks entries whose packages are missing from the sync databases as unavailable.
+    void setSyncDatabase(const QSharedPointer<const SyncDatabase> &database);
+
+    // Marks entries whose packages are all installed. They are shown checked but cannot be changed, and
+    // entries that were checked only by their catalog default are unchecked, so they are not installed again.
+    void setLocalDatabase(const QSharedPointer<const LocalDatabase> &database);
+
+    // Whether every package of an entry is installed.
+    bool isInstalled(int entry) const;
+
+    // Hides the entries the rules do not offer on this hardware, unchecking them, and checks the entries
+    // the rules check by default. Hidden entries never show up, also not in search results.
+    void setHardware(const HardwareProbe &probe, const HardwareRules &rules);
+
+    // Whether the hardware rules hide an entry.
+    bool isHidden(int entry) const;
+
+    // Shows only the given entries, which have to be sorted. The check state of filtered out entries is kept.
+    void setFilter(const QVector<int> &entries);
+
+    // Shows every entry again.
+    void clearFilter();
+
+    // Returns the indexes of the checked entries, in catalog order.
+    QVector<int> checkedEntries() const;
+
+    // Checks exactly the given entries, e.g. the ones a relaunched window had checked. Installed and hidden entries stay unchecked.
+    // Unlike a toggle by the user, this does not emit entryToggled().
+    void setCheckedEntries(const QVector<int> &entries);
+
+    // Returns the package names of every checked entry, in catalog order, including filtered out ones.
+    // Installed entries are not checked.
+    QStringList checkedPackages() const;
+
+signals:
+    // Emitted when the user checks or unchecks an entry, or an entry is unchecked because it is installed.
+    void entryToggled(int entry, bool checked);
+
+private:
+    Catalog catalog;   // Entries of the catalog, read in place from the compiled image.
+    QBitArray checked; // Current check state of every entry.
+    QBitArray installed; // Entries whose packages are all installed.
+
+    QSharedPointer<const SyncDatabase> syncDatabase; // Installable packages, null until the databases were read.
+    QSharedPointer<const LocalDatabase> localDatabase; // Installed packages, null until the database was read.
+
+    QBitArray hidden; // Entries the hardware rules do not offer.
+
+    QVector<int> matches;   // Entries matching the search, while searching.
+    bool searching = false; // Whether a search filter is set.
+
+    QVector<int> visible;  // Entries shown while some are filtered out or hidden, in row order.
+    bool filtered = false; // Whether only the entries in `visible` are shown.
+
+    // Maps a row of the model to the index of the catalog entry it shows.
+    int entryAt(int row) const;
+
+    // Recomputes the rows from the search matches and the hidden entries.
+    void updateRows();
+
+    // Recomputes which entries are installed from both databases and unchecks the newly installed ones.
+    void updateInstalled();
+
+    // Returns the packages of an entry that cannot be installed. Entries with prepare commands have none.
+    QStringList missingPackages(int entry) const;
+};
+
+#endif // CATALOGMODEL_H // End of the include guard.
@@ -0,0 +1,331 @@
+#include "commandgraph.h" // Includes the header file for the CommandGraph class.
+#include "applyjournal.h" // Skips and records the steps of a retried apply.
+
+#include <QCommandLineParser> // Parses the arguments of --run-steps.
+#include <QDateTime> // Timestamps of the progress messages.
+#include <QEventLoop> // Waits for the graph when run from the command line.
+#include <QFile> // Reads the graph and writes to the progress pipe.
+#include <QHash> // Maps ids and groups to steps.
+#include <QJsonDocument> // Parses and writes the graph.
+#include <QJsonObject> // Serialized steps and progress messages.
+#include <QProcess> // Runs the commands.
+#include <QThread> // Default number of workers.
+
+#include <algorithm> // Checks the dependencies of a step.
+#include <cstdio> // Prints the output of the steps.
+#include <fcntl.h> // Opens the progress pipe without blocking.
+
+CommandGraph::CommandGraph(const QVector<Step> &steps, int workers, QObject *parent)
+    : QObject(parent) // Initializes the base object with the given parent.
+    , workers(qMax(1, workers)) // Maximum number of concurrent steps.
+{
+    // Index the steps by id and by group, so "after" can name either.
+    QHash<QString, QVector<int>> names;
+    for (int i = 0; i < steps.size(); i++) {
+        names[steps[i].id].append(i);
+        if (!steps[i].group.isEmpty() && steps[i].group != steps[i].id) {
+            names[steps[i].group].append(i);
+        }
+    }
+
+    nodes.resize(steps.size());
+    for (int i = 0; i < steps.size(); i++) {
+        nodes[i].step = steps[i];
+        for (const QString &name : steps[i].after) {
+            for (int dependency : names.value(name)) {
+                if (dependency != i && !nodes[i].dependencies.contains(dependency)) {
+                    nodes[i].dependencies.append(dependency);
+                }
+            }
+        }
+    }
+}
+
+CommandGraph::~CommandGraph() {
+    for (Node &node : nodes) {
+        if (node.process) {
+            node.process->disconnect(this);
+            node.process->kill();
+            node.process->waitForFinished(1000);
+        }
+    }
+}
+
+void CommandGraph::reportProgress(const QString &pipe, const QString &stage, qint64 since) {
+    // Open without blocking: if nobody listens anymore, there is nothing to report to.
+    int fd = open(QFile::encodeName(pipe).constData(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    progress = new QFile(this);
+    if (!progress->open(fd, QIODevice::WriteOnly, QFileDevice::AutoCloseHandle)) {
+        delete progress;
+        progress = nullptr;
+        return;
+    }
+    progressStage = stage;
+    progressSince = since;
+}
+
+void CommandGraph::recordTo(ApplyJournal *journal, const QString &stage) {
+    this->journal = journal;
+    journalStage = stage;
+}
+
+void CommandGraph::start() {
+    schedule();
+}
+
+bool CommandGraph::succeeded() const {
+    for (const Node &node : nodes) {
+        if (node.status != Status::SUCCEEDED) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CommandGraph::Status CommandGraph::status(int step) const {
+    return nodes[step].status;
+}
+
+QByteArray CommandGraph::output(int step) const {
+    return nodes[step].output;
+}
+
+void CommandGraph::schedule() {
+    if (done) {
+        return;
+    }
+
+    // Cancel everything downstream of a failure. Repeat until nothing changes, so whole chains are cancelled.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < nodes.size(); i++) {
+            if (nodes[i].status != Status::PENDING) {
+                continue;
+            }
+            for (int dependency : nodes[i].dependencies) {
+                Status status = nodes[dependency].status;
+                if (status == Status::FAILED || status == Status::CANCELLED) {
+                    nodes[i].status = Status::CANCELLED;
+                    print(i);
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Start the steps whose dependencies all succeeded, in the order they were given, while workers are free.
+    for (int i = 0; i < nodes.size() && running < workers; i++) {
+        Node &node = nodes[i];
+        if (node.status != Status::PENDING) {
+            continue;
+        }
+        bool ready = std::all_of(node.dependencies.begin(), node.dependencies.end(), [this](int dependency) {
+            return nodes[dependency].status == Status::SUCCEEDED;
+        });
+        if (!ready) {
+            continue;
+        }
+
+        node.status = Status::RUNNING;
+        node.process = new QProcess(this);
+        node.process->setProcessChannelMode(QProcess::MergedChannels);
+        connect(node.process, &QProcess::readyRead, this, [this, i]() {
+            nodes[i].output += nodes[i].process->readAll();
+        });
+        connect(node.process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this, i](int exitcode, QProcess::ExitStatus status) {
+            stepFinished(i, status == QProcess::NormalExit && exitcode == 0);
+        });
+        connect(node.process, &QProcess::errorOccurred, this, [this, i](QProcess::ProcessError error) {
+            // A command that never started does not emit finished().
+            if (error == QProcess::FailedToStart) {
+                nodes[i].output += nodes[i].process->errorString().toUtf8() + '\n';
+                stepFinished(i, false);
+            }
+        });
+        running++;
+        node.timer.start();
+        node.process->start("bash", { "-c", node.step.command });
+    }
+
+    // Nothing running and nothing startable: the rest waits on a cycle or on nothing that can succeed.
+    if (running == 0) {
+        for (int i = 0; i < nodes.size(); i++) {
+            if (nodes[i].status == Status::PENDING) {
+                nodes[i].status = Status::CANCELLED;
+                print(i);
+            }
+        }
+        done = true;
+        emit finished();
+    }
+}
+
+void CommandGraph::stepFinished(int step, bool success) {
+    Node &node = nodes[step];
+    if (node.status != Status::RUNNING) {
+        return;
+    }
+    node.output += node.process->readAll();
+    node.process->deleteLater();
+    node.process = nullptr;
+    node.duration = node.timer.elapsed();
+    node.status = success ? Status::SUCCEEDED : Status::FAILED;
+    running--;
+    if (success && journal) {
+        journal->record(journalStage, node.step);
+    }
+
+    print(step);
+    report(step);
+    schedule();
+}
+
+void CommandGraph::print(int step) const {
+    const Node &node = nodes[step];
+    QByteArray text;
+    switch (node.status) {
+    case Status::SUCCEEDED:
+        text = QString("==> %1: done (%2 s)\n").arg(node.step.id).arg(node.duration / 1000.0, 0, 'f', 1).toUtf8();
+        break;
+    case Status::FAILED:
+        text = QString("==> %1: failed (%2 s)\n").arg(node.step.id).arg(node.duration / 1000.0, 0, 'f', 1).toUtf8();
+        break;
+    case Status::CANCELLED:
+        text = QString("==> %1: skipped, a step it depends on did not succeed\n").arg(node.step.id).toUtf8();
+        break;
+    default:
+        return;
+    }
+
+    // Indent the output under its status line, so the blocks of parallel steps stay apart.
+    for (const QByteArray &line : node.output.split('\n')) {
+        if (!line.isEmpty()) {
+            text += "    " + line + '\n';
+        }
+    }
+    fwrite(text.constData(), 1, text.size(), stdout);
+    fflush(stdout);
+}
+
+void CommandGraph::report(int step) const {
+    if (!progress) {
+        return;
+    }
+    const Node &node = nodes[step];
+    QJsonObject message = {
+        { "stage", progressStage },
+        { "event", "package" },
+        { "package", node.step.id },
+        { "bytes", 0 },
+        { "rate", 0 },
+        { "elapsed", QDateTime::currentMSecsSinceEpoch() - progressSince },
+        { "status", node.status == Status::SUCCEEDED ? 0 : 1 },
+    };
+    progress->write(QJsonDocument(message).toJson(QJsonDocument::Compact) + '\n');
+    progress->flush();
+}
+
+QVector<CommandGraph::Step> CommandGraph::read(const QString &file) {
+    QFile input(file);
+    if (!input.open(QIODevice::ReadOnly)) {
+        return QVector<Step>();
+    }
+    QByteArray data = input.readAll();
+
+    QJsonDocument document = QJsonDocument::fromJson(data);
+    if (!document.isArray()) {
+        // A plain script: run it as it is, as apply.sh always did.
+        if (data.trimmed().isEmpty()) {
+            return QVector<Step>();
+        }
+        return { { "script", QString(), QString::fromUtf8(data), QStringList() } };
+    }
+
+    return fromJson(document.array());
+}
+
+QByteArray CommandGraph::write(const QVector<Step> &steps) {
+    return QJsonDocument(toJson(steps)).toJson();
+}
+
+QJsonArray CommandGraph::toJson(const QVector<Step> &steps) {
+    QJsonArray array;
+    for (const Step &step : steps) {
+        array.append(QJsonObject {
+            { "id", step.id },
+            { "group", step.group },
+            { "command", step.command },
+            { "after", QJsonArray::fromStringList(step.after) },
+        });
+    }
+    return array;
+}
+
+QVector<CommandGraph::Step> CommandGraph::fromJson(const QJsonArray &array) {
+    QVector<Step> steps;
+    for (const QJsonValue &value : array) {
+        QJsonObject object = value.toObject();
+        Step step;
+        step.id = object.value("id").toString();
+        step.group = object.value("group").toString();
+        step.command = object.value("command").toString();
+        for (const QJsonValue &name : object.value("after").toArray()) {
+            step.after += name.toString();
+        }
+        if (step.id.isEmpty()) {
+            step.id = QString::number(steps.size() + 1);
+        }
+        steps.append(step);
+    }
+    return steps;
+}
+
+int CommandGraph::run(const QStringList &arguments) {
+    QCommandLineParser parser;
+    QCommandLineOption steps("run-steps", "Runs the steps of a graph file.", "file");
+    QCommandLineOption jobs("jobs", "How many steps may run at the same time.", "n", QString::number(QThread::idealThreadCount()));
+    QCommandLineOption stage("stage", "Stage reported to the progress pipe.", "name", "setup");
+    QCommandLineOption pipe("progress", "Progress pipe of apply.sh.", "path");
+    QCommandLineOption since("since", "Start of apply.sh in milliseconds since the epoch.", "ms", "0");
+    QCommandLineOption journalFile("journal", "Journal of the apply, to skip and record the steps that succeeded.", "file");
+    parser.addOptions({ steps, jobs, stage, pipe, since, journalFile });
+    parser.process(arguments);
+
+    // On a retry, leave out the steps that already succeeded. Steps waiting for them no longer find
+    // them in the graph, which counts as done.
+    QVector<Step> pending = read(parser.value(steps));
+    ApplyJournal journal(parser.value(journalFile));
+    if (parser.isSet(journalFile)) {
+        pending.erase(std::remove_if(pending.begin(), pending.end(), [&journal, &parser, &stage](const Step &step) {
+            if (!journal.isCompleted(parser.value(stage), step)) {
+                return false;
+            }
+            printf("==> %s: done in an earlier attempt\n", qPrintable(step.id));
+            return true;
+        }), pending.end());
+        fflush(stdout);
+    }
+
+    CommandGraph graph(pending, parser.value(jobs).toInt());
+    if (parser.isSet(journalFile)) {
+        graph.recordTo(&journal, parser.value(stage));
+    }
+    if (parser.isSet(pipe)) {
+        qint64 start = parser.value(since).toLongLong();
+        graph.reportProgress(parser.value(pipe), parser.value(stage), start > 0 ? start : QDateTime::currentMSecsSinceEpoch());
+    }
+
+    // Run until no step can run anymore. An empty graph finishes right away.
+    QEventLoop loop;
+    connect(&graph, &CommandGraph::finished, &loop, &QEventLoop::quit);
+    graph.start();
+    if (!graph.done) {
+        loop.exec();
+    }
+    return graph.succeeded() ? 0 : 1;
+}
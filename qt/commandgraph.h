@@ -0,0 +1,131 @@
+#ifndef COMMANDGRAPH_H // Start of include guard to prevent multiple inclusions of this header file.
+#define COMMANDGRAPH_H // Define the include guard macro.
+
+#include <QElapsedTimer> // Measures how long every step takes.
+#include <QJsonArray> // Serialized steps.
+#include <QObject> // Base class providing signals and slots.
+#include <QStringList> // Dependencies of a step.
+#include <QVector> // Holds the steps.
+
+class ApplyJournal; // Forward declaration of the journal the succeeded steps are recorded in.
+class QFile; // Forward declaration of the progress pipe.
+class QProcess; // Forward declaration of a running step.
+
+// Runs the prepare or setup commands of an apply as a graph of steps instead of one serial script.
+//
+// Every step is one shell command. A step waits for the steps it names in "after", either by their id or
+// by the entry ("group") they belong to; names of entries that were not selected are ignored. Steps whose
+// dependencies succeeded run concurrently, up to a number of workers. The output of every step is captured
+// on its own and printed as one block once the step is done, so parallel steps do not interleave. A step
+// that fails cancels every step depending on it, while the independent steps still run.
+//
+// The graph is written by Snigdha OS Blackbox as a JSON array, e.g.
+//   [{"id":"Blackarch#1","group":"Blackarch","command":"sed ...","after":[]}]
+// and run as root by apply.sh through "snigdhaos-blackbox --run-steps <file>". A file that is not such an
+// array is run as a single step, so apply.sh still accepts plain scripts.
+class CommandGraph : public QObject
+{
+    Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
+
+public:
+    // One command of the graph.
+    struct Step {
+        QString id;        // Unique name of the step, shown in the output.
+        QString group;     // Entry the step belongs to, so other entries can depend on all of its steps.
+        QString command;   // Shell command, run with bash.
+        QStringList after; // Ids or groups that have to succeed first.
+    };
+
+    // State of a step.
+    enum class Status {
+        PENDING,   // Waiting for its dependencies or for a worker.
+        RUNNING,   // The command is running.
+        SUCCEEDED, // The command exited with status 0.
+        FAILED,    // The command failed or could not be started.
+        CANCELLED  // A dependency failed, so the command never ran.
+    };
+
+    // Constructor for the CommandGraph class.
+    // Parameters:
+    // - steps: The steps to run.
+    // - workers: How many steps may run at the same time.
+    // - parent: Pointer to the parent object that owns the graph.
+    CommandGraph(const QVector<Step> &steps, int workers, QObject *parent = nullptr);
+
+    // Kills the running steps.
+    ~CommandGraph();
+
+    // Reports every finished step to the progress pipe of apply.sh (see progress.sh).
+    // Parameters:
+    // - pipe: Path of the pipe, nothing is reported if it cannot be opened.
+    // - stage: Stage the steps belong to, e.g. "setup".
+    // - since: Start of the script in milliseconds since the epoch, so "elapsed" matches its messages.
+    void reportProgress(const QString &pipe, const QString &stage, qint64 since);
+
+    // Records every step that succeeds in an apply journal, under the given stage.
+    void recordTo(ApplyJournal *journal, const QString &stage);
+
+    // Starts the steps without dependencies. Emits finished() once no step can run anymore.
+    void start();
+
+    // Whether every step succeeded. Valid after finished().
+    bool succeeded() const;
+
+    // Status and captured output of a step.
+    Status status(int step) const;
+    QByteArray output(int step) const;
+
+    // Reads a graph written by write(), or wraps any other file in a single step.
+    static QVector<Step> read(const QString &file);
+
+    // Serializes a graph for read().
+    static QByteArray write(const QVector<Step> &steps);
+
+    // Converts steps to and from their JSON form, which is also used inside selection profiles.
+    static QJsonArray toJson(const QVector<Step> &steps);
+    static QVector<Step> fromJson(const QJsonArray &array);
+
+    // Runs "--run-steps <file> [--jobs <n>] [--stage <name>] [--progress <pipe>] [--since <ms>] [--journal <file>]"
+    // and returns the exit status of the process. Steps the journal lists as done are skipped.
+    static int run(const QStringList &arguments);
+
+signals:
+    // Emitted once every step succeeded, failed or was cancelled.
+    void finished();
+
+private:
+    // Cancels the steps depending on failed ones and starts the steps that became ready.
+    void schedule();
+
+    // Records the result of a step and prints its output.
+    void stepFinished(int step, bool success);
+
+    // Prints the status line and output of a finished step.
+    void print(int step) const;
+
+    // Writes a progress message for a finished step.
+    void report(int step) const;
+
+    // Per-step bookkeeping.
+    struct Node {
+        Step step;                       // The step itself.
+        QVector<int> dependencies;       // Indexes of the steps it waits for.
+        Status status = Status::PENDING; // Current state.
+        QProcess *process = nullptr;     // Running command.
+        QByteArray output;               // Everything the command printed.
+        QElapsedTimer timer;             // Started with the command.
+        qint64 duration = 0;             // Time the command took, in milliseconds.
+    };
+
+    QVector<Node> nodes;           // The steps and their state.
+    int workers;                   // Maximum number of concurrent steps.
+    int running = 0;               // Number of running steps.
+    bool done = false;             // Whether finished() was emitted.
+    QFile *progress = nullptr;     // Progress pipe, if reporting.
+    QString progressStage;         // Stage of the progress messages.
+    qint64 progressSince = 0;      // Start of the script in milliseconds since the epoch.
+    ApplyJournal *journal = nullptr; // Journal of the apply, if recording.
+    QString journalStage;          // Stage the steps are recorded under.
+};
+
+#endif // COMMANDGRAPH_H // End of the include guard.
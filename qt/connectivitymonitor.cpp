@@ -0,0 +1,136 @@
+#include "connectivitymonitor.h" // Includes the header file for the ConnectivityMonitor class.
+#include "pacmanconfig.h" // Servers of the repositories.
+
+#include <QRandomGenerator> // Adds jitter to the backoff.
+#include <QTimer> // Round timeout and backoff.
+#include <QUrl> // Used to check the scheme of the mirrors.
+#include <QtNetwork/QNetworkAccessManager> // Sends the probes.
+#include <QtNetwork/QNetworkReply> // Running probes.
+#if QT_VERSION >= QT_VERSION_CHECK(6, 1, 0)
+#include <QtNetwork/QNetworkInformation> // Reachability events of the operating system.
+#endif
+
+ConnectivityMonitor::ConnectivityMonitor(const QStringList &endpoints, QObject *parent)
+    : QObject(parent) // Initializes the base object with the given parent.
+    , endpoints(endpoints) // URLs to probe.
+    , network(new QNetworkAccessManager(this)) // Sends the probes.
+    , timeout(new QTimer(this)) // Gives up on a round.
+    , backoff(new QTimer(this)) // Waits before the next round.
+{
+    timeout->setSingleShot(true);
+    timeout->setInterval(PROBE_TIMEOUT);
+    connect(timeout, &QTimer::timeout, this, [this]() {
+        abortProbes();
+        retry();
+    });
+
+    backoff->setSingleShot(true);
+    connect(backoff, &QTimer::timeout, this, &ConnectivityMonitor::probe);
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 1, 0)
+    // Probe right away when the system reports that it went online, instead of waiting out the backoff.
+    if (QNetworkInformation::load(QNetworkInformation::Feature::Reachability)) {
+        connect(QNetworkInformation::instance(), &QNetworkInformation::reachabilityChanged, this, [this](QNetworkInformation::Reachability reachability) {
+            if (active && probes.isEmpty() && reachability == QNetworkInformation::Reachability::Online) {
+                backoff->stop();
+                attempt = 0;
+                probe();
+            }
+        });
+    }
+#endif
+}
+
+QStringList ConnectivityMonitor::defaultEndpoints() {
+    QStringList endpoints = { CHECK_URL };
+    endpoints += qEnvironmentVariable("SNIGDHAOS_BLACKBOX_CHECK_URLS").split(' ', Qt::SkipEmptyParts);
+    endpoints += mirrorEndpoints();
+    endpoints.removeDuplicates();
+    return endpoints;
+}
+
+QStringList ConnectivityMonitor::mirrorEndpoints() {
+    QStringList result;
+    PacmanConfig config = PacmanConfig::load();
+    for (const QString &repository : config.repositories()) {
+        QStringList servers = config.servers(repository);
+        if (!servers.isEmpty() && QUrl(servers.first()).scheme().startsWith("http")) {
+            result += servers.first() + "/" + repository + ".db";
+        }
+    }
+    return result;
+}
+
+void ConnectivityMonitor::start() {
+    if (active) {
+        return;
+    }
+    active = true;
+    attempt = 0;
+    probe();
+}
+
+void ConnectivityMonitor::stop() {
+    active = false;
+    timeout->stop();
+    backoff->stop();
+    abortProbes();
+}
+
+void ConnectivityMonitor::probe() {
+    if (!active) {
+        return;
+    }
+
+    // Race all endpoints; HEAD requests keep the answers small.
+    for (const QString &endpoint : endpoints) {
+        QNetworkRequest request{ QUrl(endpoint) };
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+        QNetworkReply *reply = network->head(request);
+        probes.append(reply);
+        connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+            probeFinished(reply);
+        });
+    }
+    timeout->start();
+}
+
+void ConnectivityMonitor::probeFinished(QNetworkReply *reply) {
+    probes.removeOne(reply);
+    reply->deleteLater();
+
+    // Any HTTP answer proves the network works, even an error status of one particular server.
+    if (reply->error() == QNetworkReply::NoError || reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
+        stop();
+        emit online();
+        return;
+    }
+
+    // Wait for the rest of the round, unless this was the last probe.
+    if (probes.isEmpty()) {
+        timeout->stop();
+        retry();
+    }
+}
+
+void ConnectivityMonitor::abortProbes() {
+    // Aborting emits finished() right away, which must not count as a failed probe.
+    for (QNetworkReply *reply : probes) {
+        reply->disconnect(this);
+        reply->abort();
+        reply->deleteLater();
+    }
+    probes.clear();
+}
+
+void ConnectivityMonitor::retry() {
+    if (!active) {
+        return;
+    }
+
+    // Double the delay with every failed round, up to the limit, and pick a random point in its upper half
+    // so that many machines coming back at once do not probe in lockstep.
+    int delay = qMin(MAX_DELAY, INITIAL_DELAY << qMin(attempt, 6));
+    attempt++;
+    backoff->start(delay / 2 + int(QRandomGenerator::global()->bounded(delay / 2 + 1)));
+}
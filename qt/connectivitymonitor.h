@@ -0,0 +1,74 @@
+#ifndef CONNECTIVITYMONITOR_H // Start of include guard to prevent multiple inclusions of this header file.
+#define CONNECTIVITYMONITOR_H // Define the include guard macro.
+
+#include <QList> // Holds the probes of a round.
+#include <QObject> // Base class providing signals and slots.
+#include <QStringList> // Endpoints to probe.
+
+class QNetworkAccessManager; // Forward declaration of the manager sending the probes.
+class QNetworkReply; // Forward declaration of a running probe.
+class QTimer; // Forward declaration of the round timeout and backoff timers.
+
+// Waits until the internet is reachable.
+//
+// Every round sends a HEAD request to all endpoints at once and succeeds with the first server that
+// answers, so one slow or unreachable host does not hold the others up. Failed rounds are retried with
+// exponential backoff and jitter instead of immediately. Where Qt provides network reachability
+// information (Qt 6.1 and later), becoming online starts the next round right away.
+class ConnectivityMonitor : public QObject
+{
+    Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
+
+public:
+    // Constructor for the ConnectivityMonitor class.
+    // Parameters:
+    // - endpoints: URLs to probe, e.g. a well known site and the configured mirrors.
+    // - parent: Pointer to the parent object that owns the monitor.
+    explicit ConnectivityMonitor(const QStringList &endpoints, QObject *parent = nullptr);
+
+    // Endpoints probed by default: CHECK_URL, any extra URLs from SNIGDHAOS_BLACKBOX_CHECK_URLS
+    // (separated by spaces), and the configured mirrors.
+    static QStringList defaultEndpoints();
+
+    // Returns the database URL of the first server of every repository in pacman.conf, which shows
+    // that the mirrors themselves are reachable. Local (file://) servers are left out.
+    static QStringList mirrorEndpoints();
+
+    // Starts probing until an endpoint answers. Does nothing if probing is already in progress.
+    void start();
+
+    // Stops probing.
+    void stop();
+
+signals:
+    // Emitted once an endpoint answered, after which the monitor stops.
+    void online();
+
+private:
+    // Sends one round of probes.
+    void probe();
+
+    // Handles the end of one probe.
+    void probeFinished(QNetworkReply *reply);
+
+    // Aborts the probes of the current round.
+    void abortProbes();
+
+    // Schedules the next round.
+    void retry();
+
+    QStringList endpoints;          // URLs to probe.
+    QNetworkAccessManager *network; // Sends the probes; reused for every round.
+    QTimer *timeout;                // Gives up on a round.
+    QTimer *backoff;                // Waits before the next round.
+    QList<QNetworkReply *> probes;  // Probes of the current round that did not finish yet.
+    int attempt = 0;                // Number of failed rounds in a row.
+    bool active = false;            // Whether the monitor is waiting for connectivity.
+
+    static constexpr const char *CHECK_URL = "https://snigdha-os.github.io/"; // Well known site used to verify connectivity.
+    static constexpr int PROBE_TIMEOUT = 5000;  // Time a round may take, in milliseconds.
+    static constexpr int INITIAL_DELAY = 500;   // Delay after the first failed round, in milliseconds.
+    static constexpr int MAX_DELAY = 30000;     // Upper bound of the delay between rounds, in milliseconds.
+};
+
+#endif // CONNECTIVITYMONITOR_H // End of the include guard.
@@ -0,0 +1,124 @@
+#include "dependencyresolver.h" // Includes the header file for the DependencyResolver class.
+
+#include <QSet> // Tracks the packages visited while computing a closure.
+
+DependencyResolver::DependencyResolver(const SyncDatabase &sync, const LocalDatabase &local)
+    : sync(sync) // Snapshot of the installable packages.
+    , local(local) // Snapshot of the installed packages.
+{
+}
+
+void DependencyResolver::add(const QString &name) {
+    const QByteArray key = name.toUtf8();
+
+    // Only the first selection of a name changes what gets installed.
+    if (selected[key]++ == 0) {
+        update(key, 1);
+    }
+}
+
+void DependencyResolver::remove(const QString &name) {
+    const QByteArray key = name.toUtf8();
+    auto it = selected.find(key);
+    if (it == selected.end()) {
+        return;
+    }
+
+    // Only removing the last selection of a name changes what gets installed.
+    if (--it.value() == 0) {
+        selected.erase(it);
+        update(key, -1);
+    }
+}
+
+void DependencyResolver::update(const QByteArray &name, int delta) {
+    for (const SyncDatabase::Package &package : closure(name)) {
+        const QByteArray packageName = package.repository->name(package.index);
+        Reference &reference = references[packageName];
+        reference.package = package;
+
+        // A package counts towards the totals while at least one selection pulls it in.
+        if (delta > 0 && reference.count++ == 0) {
+            download += package.repository->downloadSize(package.index);
+            installed += package.repository->installedSize(package.index);
+        }
+        else if (delta < 0 && --reference.count == 0) {
+            download -= package.repository->downloadSize(package.index);
+            installed -= package.repository->installedSize(package.index);
+            references.remove(packageName);
+        }
+    }
+}
+
+const QVector<SyncDatabase::Package> &DependencyResolver::closure(const QByteArray &name) {
+    auto it = closures.constFind(name);
+    if (it != closures.constEnd()) {
+        return it.value();
+    }
+
+    // Start from the package itself, or from every member if the name is a group.
+    QVector<SyncDatabase::Package> pending;
+    SyncDatabase::Package package = sync.find(name);
+    if (package.isValid()) {
+        pending.append(package);
+    }
+    else {
+        pending = sync.groupMembers(name);
+    }
+
+    // Walk the dependencies depth-first. Installed packages are skipped with their dependencies,
+    // since pacman only installs what is missing (--needed).
+    QVector<SyncDatabase::Package> result;
+    QSet<QByteArray> visited;
+    while (!pending.isEmpty()) {
+        SyncDatabase::Package current = pending.takeLast();
+        const QByteArray currentName = current.repository->name(current.index);
+        if (visited.contains(currentName) || local.isInstalled(currentName)) {
+            continue;
+        }
+        visited.insert(currentName);
+        result.append(current);
+
+        for (const QByteArray &dependency : current.repository->depends(current.index)) {
+            if (local.satisfies(dependency)) {
+                continue;
+            }
+            SyncDatabase::Package next = resolve(dependency);
+            if (next.isValid()) {
+                pending.append(next);
+            }
+        }
+    }
+
+    return closures.insert(name, result).value();
+}
+
+SyncDatabase::Package DependencyResolver::resolve(const QByteArray &dependency) {
+    SyncDatabase::Package package = sync.find(dependency);
+    if (package.isValid()) {
+        return package;
+    }
+
+    // Virtual dependencies such as "sh" are resolved through the names the packages provide.
+    return sync.provider(dependency);
+}
+
+int DependencyResolver::packageCount() const {
+    return references.size();
+}
+
+quint64 DependencyResolver::downloadSize() const {
+    return download;
+}
+
+quint64 DependencyResolver::installedSize() const {
+    return installed;
+}
+
+QVector<SyncDatabase::Package> DependencyResolver::packages() const {
+    QVector<SyncDatabase::Package> result;
+    for (const Reference &reference : references) {
+        result.append(reference.package);
+    }
+    return result;
+}
@@ -0,0 +1,69 @@
+#ifndef DEPENDENCYRESOLVER_H // Start of include guard to prevent multiple inclusions of this header file.
+#define DEPENDENCYRESOLVER_H // Define the include guard macro.
+
+#include "localdatabase.h" // Installed packages, which are left out of the estimate.
+#include "syncdatabase.h" // Metadata of the installable packages.
+
+#include <QHash> // Memoized closures and reference counts.
+#include <QString> // Used to pass the selected names.
+#include <QVector> // Holds the packages of a closure.
+
+// Keeps a live estimate of what installing the current selection costs: the packages that have to be
+// installed (the selected ones plus their transitive dependencies, minus what is already installed),
+// and their total download and installed sizes.
+//
+// The closure of every selected name is computed once and memoized, and every package counts how many
+// selected names pull it in. Checking or unchecking a name therefore only walks that name's own closure,
+// no matter how large the rest of the selection is.
+class DependencyResolver
+{
+public:
+    // Creates a resolver over a snapshot of the databases, with an empty selection.
+    DependencyResolver(const SyncDatabase &sync, const LocalDatabase &local);
+
+    // Adds a selected package or group. A name may be added several times, e.g. by two catalog entries.
+    void add(const QString &name);
+
+    // Removes one selection of a package or group that was added before.
+    void remove(const QString &name);
+
+    // Number of packages that would be installed.
+    int packageCount() const;
+
+    // Total size of the packages to download, in bytes.
+    quint64 downloadSize() const;
+
+    // Total size of the packages once installed, in bytes.
+    quint64 installedSize() const;
+
+    // The packages that would be installed, in no particular order.
+    QVector<SyncDatabase::Package> packages() const;
+
+private:
+    // A package pulled in by the selection.
+    struct Reference {
+        SyncDatabase::Package package; // The package.
+        int count = 0;                 // How many selected names pull it in.
+    };
+
+    // Returns the packages a selected name pulls in, computing it on first use.
+    const QVector<SyncDatabase::Package> &closure(const QByteArray &name);
+
+    // Returns the sync package satisfying a dependency: the package of that name, or else one providing it.
+    SyncDatabase::Package resolve(const QByteArray &dependency);
+
+    // Adds (+1) or removes (-1) the closure of a name from the totals.
+    void update(const QByteArray &name, int delta);
+
+    SyncDatabase sync;   // Installable packages.
+    LocalDatabase local; // Installed packages.
+
+    QHash<QByteArray, QVector<SyncDatabase::Package>> closures; // Memoized closure of every name selected so far.
+    QHash<QByteArray, int> selected;                            // How many times every name is selected.
+    QHash<QByteArray, Reference> references;                    // Packages pulled in by the selection, by name.
+
+    quint64 download = 0;  // Sum of the download sizes of the referenced packages.
+    quint64 installed = 0; // Sum of the installed sizes of the referenced packages.
+};
+
+#endif // DEPENDENCYRESOLVER_H // End of the include guard.
@@ -0,0 +1,200 @@
+#include "hardwareprobe.h" // Includes the header file for the HardwareProbe class.
+
+#include <QDir> // Lists the PCI devices.
+#include <QFile> // Reads sysfs, procfs and the cache.
+#include <QFileInfo> // Locates the directory of the cache.
+#include <QJsonArray> // Lists of the cache.
+#include <QJsonDocument> // Encodes the cache.
+#include <QJsonObject> // Fields of the cache.
+#include <QSaveFile> // Replaces the cache atomically.
+
+namespace {
+
+// Reads a small file such as a sysfs attribute, without the trailing newline.
+QByteArray readValue(const QString &path) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll().trimmed();
+}
+
+// Parses a hexadecimal sysfs value such as "0x10de".
+quint32 readHex(const QString &path) {
+    return readValue(path).toUInt(nullptr, 16);
+}
+
+} // namespace
+
+HardwareProbe HardwareProbe::scan(const QString &root) {
+    HardwareProbe probe;
+    QDir base(root);
+    probe.root = root;
+    probe.bootId = QString::fromLatin1(readValue(base.filePath("proc/sys/kernel/random/boot_id")));
+
+    // Chassis type from the DMI table, e.g. 3 for a desktop or 10 for a notebook.
+    probe.chassis = readValue(base.filePath("sys/class/dmi/id/chassis_type")).toInt();
+
+    // Every PCI device, by vendor, device and class.
+    QDir pci(base.filePath("sys/bus/pci/devices"));
+    for (const QString &name : pci.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::System, QDir::Name)) {
+        PciDevice device;
+        device.vendor = quint16(readHex(pci.filePath(name + "/vendor")));
+        device.device = quint16(readHex(pci.filePath(name + "/device")));
+        device.deviceClass = readHex(pci.filePath(name + "/class"));
+        probe.devices.append(device);
+    }
+
+    // The flags of the first CPU; the others have the same.
+    QFile cpuinfo(base.filePath("proc/cpuinfo"));
+    if (cpuinfo.open(QIODevice::ReadOnly)) {
+        while (!cpuinfo.atEnd()) {
+            QByteArray line = cpuinfo.readLine();
+            if (line.startsWith("flags")) {
+                for (const QByteArray &flag : line.mid(line.indexOf(':') + 1).simplified().split(' ')) {
+                    probe.cpuFlags.insert(QString::fromLatin1(flag));
+                }
+                break;
+            }
+        }
+    }
+
+    // Total memory, which /proc/meminfo gives in KiB.
+    QFile meminfo(base.filePath("proc/meminfo"));
+    if (meminfo.open(QIODevice::ReadOnly)) {
+        while (!meminfo.atEnd()) {
+            QByteArray line = meminfo.readLine();
+            if (line.startsWith("MemTotal:")) {
+                probe.memoryBytes = line.mid(9).simplified().split(' ').value(0).toLongLong() * 1024;
+                break;
+            }
+        }
+    }
+    return probe;
+}
+
+HardwareProbe HardwareProbe::load(const QString &root, const QString &cacheFile) {
+    QByteArray bootId = readValue(QDir(root).filePath("proc/sys/kernel/random/boot_id"));
+
+    // Reuse the result of the same boot of the same tree.
+    QFile cache(cacheFile);
+    if (!cacheFile.isEmpty() && !bootId.isEmpty() && cache.open(QIODevice::ReadOnly)) {
+        QJsonObject object = QJsonDocument::fromJson(cache.readAll()).object();
+        if (object.value("version").toInt() == VERSION && object.value("root").toString() == root
+            && object.value("bootId").toString() == QString::fromLatin1(bootId)) {
+            HardwareProbe probe;
+            probe.root = root;
+            probe.bootId = QString::fromLatin1(bootId);
+            probe.chassis = object.value("chassis").toInt();
+            for (const QJsonValue &value : object.value("pci").toArray()) {
+                QJsonArray fields = value.toArray();
+                probe.devices.append({ quint16(fields.at(0).toInt()), quint16(fields.at(1).toInt()), quint32(fields.at(2).toDouble()) });
+            }
+            for (const QJsonValue &flag : object.value("cpuFlags").toArray()) {
+                probe.cpuFlags.insert(flag.toString());
+            }
+            probe.memoryBytes = qint64(object.value("memory").toDouble());
+            return probe;
+        }
+    }
+    cache.close();
+
+    HardwareProbe probe = scan(root);
+    if (!cacheFile.isEmpty() && !probe.bootId.isEmpty()) {
+        QJsonArray pci;
+        for (const PciDevice &device : probe.devices) {
+            pci.append(QJsonArray { device.vendor, device.device, qint64(device.deviceClass) });
+        }
+        QJsonObject object = {
+            { "version", VERSION },
+            { "root", root },
+            { "bootId", probe.bootId },
+            { "chassis", probe.chassis },
+            { "pci", pci },
+            { "cpuFlags", QJsonArray::fromStringList(probe.cpuFlags.values()) },
+            { "memory", probe.memoryBytes },
+        };
+        QDir().mkpath(QFileInfo(cacheFile).absolutePath());
+        QSaveFile output(cacheFile);
+        if (output.open(QIODevice::WriteOnly)) {
+            output.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+            output.commit();
+        }
+    }
+    return probe;
+}
+
+int HardwareProbe::chassisType() const {
+    return chassis;
+}
+
+bool HardwareProbe::isDesktop() const {
+    // Desktop, low profile desktop, tower, portable-all-in-one... as listed by the SMBIOS specification.
+    static const QSet<int> desktops = { 3, 4, 6, 7, 23, 24 };
+    return desktops.contains(chassis);
+}
+
+bool HardwareProbe::isLaptop() const {
+    // Portable, laptop, notebook, sub notebook, convertible and detachable.
+    static const QSet<int> laptops = { 8, 9, 10, 14, 31, 32 };
+    return laptops.contains(chassis);
+}
+
+QVector<HardwareProbe::PciDevice> HardwareProbe::pciDevices() const {
+    return devices;
+}
+
+bool HardwareProbe::hasGpu(quint16 vendor) const {
+    // Class 0x03 is "display controller": VGA, XGA, 3D and others.
+    for (const PciDevice &device : devices) {
+        if (device.vendor == vendor && (device.deviceClass >> 16) == 0x03) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HardwareProbe::hasCpuFlag(const QString &flag) const {
+    return cpuFlags.contains(flag);
+}
+
+qint64 HardwareProbe::memory() const {
+    return memoryBytes;
+}
+
+bool HardwareProbe::matches(const QString &condition) const {
+    for (const QString &term : condition.split('+', Qt::SkipEmptyParts)) {
+        bool negated = term.startsWith('!');
+        if (matchesTerm(negated ? term.mid(1) : term) == negated) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool HardwareProbe::matchesTerm(const QString &term) const {
+    if (term == "desktop") {
+        return isDesktop();
+    }
+    if (term == "laptop") {
+        return isLaptop();
+    }
+    if (term == "gpu:nvidia") {
+        return hasGpu(VENDOR_NVIDIA);
+    }
+    if (term == "gpu:amd") {
+        return hasGpu(VENDOR_AMD);
+    }
+    if (term == "gpu:intel") {
+        return hasGpu(VENDOR_INTEL);
+    }
+    if (term.startsWith("cpu:")) {
+        return hasCpuFlag(term.mid(4));
+    }
+    if (term.startsWith("memory>=") && term.endsWith('G')) {
+        bool valid = false;
+        qint64 gibibytes = term.mid(8, term.size() - 9).toLongLong(&valid);
+        return valid && memoryBytes >= gibibytes * 1024 * 1024 * 1024;
+    }
+    return false;
+}
@@ -0,0 +1,76 @@
+#ifndef HARDWAREPROBE_H // Start of include guard to prevent multiple inclusions of this header file.
+#define HARDWAREPROBE_H // Define the include guard macro.
+
+#include <QSet> // CPU flags.
+#include <QString> // Paths and conditions.
+#include <QVector> // PCI devices.
+
+// What the machine is made of, as far as the offered software depends on it: the chassis type from DMI,
+// the PCI devices (for the graphics cards), the CPU flags and the memory size.
+//
+// Everything is read from sysfs and procfs below a root directory, "/" unless SNIGDHAOS_BLACKBOX_SYSROOT
+// points to a copy, e.g. a fake tree for trying the rules. The hardware cannot change without a reboot,
+// so the result is cached together with the boot id and reused until the next boot.
+class HardwareProbe
+{
+public:
+    static constexpr int VERSION = 1; // Version of the cache.
+
+    // PCI vendor ids of the graphics card makers.
+    static constexpr quint16 VENDOR_AMD = 0x1002;
+    static constexpr quint16 VENDOR_INTEL = 0x8086;
+    static constexpr quint16 VENDOR_NVIDIA = 0x10de;
+
+    // One device on the PCI bus.
+    struct PciDevice {
+        quint16 vendor = 0;       // Vendor id, e.g. VENDOR_NVIDIA.
+        quint16 device = 0;       // Device id.
+        quint32 deviceClass = 0;  // Class code, e.g. 0x030000 for a VGA controller.
+    };
+
+    // Probes the machine below root, or takes the result from the cache file if it was written during
+    // the same boot. An empty cache file disables the cache.
+    static HardwareProbe load(const QString &root, const QString &cacheFile = QString());
+
+    // Reads everything from sysfs and procfs below root, without the cache.
+    static HardwareProbe scan(const QString &root);
+
+    // Chassis type of the DMI table, 0 if unknown.
+    int chassisType() const;
+
+    // Whether the chassis is a desktop or a laptop, respectively. Unknown chassis are neither.
+    bool isDesktop() const;
+    bool isLaptop() const;
+
+    // The PCI devices, and whether one of them is a display controller of the given vendor.
+    QVector<PciDevice> pciDevices() const;
+    bool hasGpu(quint16 vendor) const;
+
+    // Whether the CPU has a flag of /proc/cpuinfo, e.g. "avx2".
+    bool hasCpuFlag(const QString &flag) const;
+
+    // Total memory in bytes, 0 if unknown.
+    qint64 memory() const;
+
+    // Whether the machine meets a condition of the hardware rules: terms joined by '+', all of which have
+    // to hold, each optionally negated by a leading '!'. The terms are:
+    //   desktop, laptop                 the chassis type
+    //   gpu:nvidia, gpu:amd, gpu:intel  a display controller of that vendor
+    //   cpu:<flag>                      a CPU flag, e.g. cpu:avx2
+    //   memory>=<n>G                    at least n GiB of memory
+    // Unknown terms never hold.
+    bool matches(const QString &condition) const;
+
+private:
+    // Whether a single term holds.
+    bool matchesTerm(const QString &term) const;
+
+    QString root;                // Directory the values were read below.
+    QString bootId;              // Boot the values were read in.
+    int chassis = 0;             // DMI chassis type.
+    QVector<PciDevice> devices;  // PCI devices.
+    QSet<QString> cpuFlags;      // Flags of the first CPU.
+    qint64 memoryBytes = 0;      // Total memory.
+};
+
+#endif // HARDWAREPROBE_H // End of the include guard.
@@ -0,0 +1,58 @@
+#include "hardwarerules.h" // Includes the header file for the HardwareRules class.
+#include "hardwareprobe.h" // Checks the conditions.
+
+#include <QDebug> // Reports lines that are not rules.
+#include <QFile> // Reads the rules.
+
+HardwareRules HardwareRules::load(const QString &file) {
+    HardwareRules rules;
+    QFile input(file);
+    if (!input.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return rules;
+    }
+
+    int number = 0;
+    while (!input.atEnd()) {
+        number++;
+        QStringList fields = QString::fromUtf8(input.readLine()).simplified().split(' ', Qt::SkipEmptyParts);
+        if (fields.isEmpty() || fields.first().startsWith('#')) {
+            continue;
+        }
+        if (fields.size() < 3 || (fields.first() != "show" && fields.first() != "check")) {
+            qWarning() << "Ignoring line" << number << "of" << file;
+            continue;
+        }
+
+        QHash<QString, QStringList> &conditions = fields.first() == "show" ? rules.show : rules.check;
+        for (int i = 2; i < fields.size(); i++) {
+            conditions[fields.at(i)] += fields.at(1);
+        }
+    }
+    return rules;
+}
+
+bool HardwareRules::isEmpty() const {
+    return show.isEmpty() && check.isEmpty();
+}
+
+bool HardwareRules::isShown(const QStringList &packages, const HardwareProbe &probe) const {
+    for (const QString &package : packages) {
+        for (const QString &condition : show.value(package)) {
+            if (!probe.matches(condition)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool HardwareRules::isChecked(const QStringList &packages, const HardwareProbe &probe) const {
+    for (const QString &package : packages) {
+        for (const QString &condition : check.value(package)) {
+            if (probe.matches(condition)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
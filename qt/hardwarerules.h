@@ -0,0 +1,37 @@
+#ifndef HARDWARERULES_H // Start of include guard to prevent multiple inclusions of this header file.
+#define HARDWARERULES_H // Define the include guard macro.
+
+#include <QHash> // Conditions by package.
+#include <QStringList> // Packages and conditions.
+
+class HardwareProbe; // Forward declaration of the hardware the conditions are checked against.
+
+// Decides which options and catalog entries the select widget offers on this machine, and which it checks
+// by default, from the hardware.rules file next to the catalogs. Every line is
+//   show <condition> <package>...
+//   check <condition> <package>...
+// with a condition as understood by HardwareProbe::matches(). Empty lines and lines starting with '#'
+// are ignored. Packages without rules are always shown and keep their default.
+class HardwareRules
+{
+public:
+    // Reads the rules. A missing file has no rules.
+    static HardwareRules load(const QString &file);
+
+    // Whether there are no rules at all.
+    bool isEmpty() const;
+
+    // Whether an option or entry installing the given packages is offered: every "show" condition
+    // of every one of its packages has to hold.
+    bool isShown(const QStringList &packages, const HardwareProbe &probe) const;
+
+    // Whether an option or entry installing the given packages is checked by default: a "check"
+    // condition of one of its packages holds.
+    bool isChecked(const QStringList &packages, const HardwareProbe &probe) const;
+
+private:
+    QHash<QString, QStringList> show;  // "show" conditions, by package.
+    QHash<QString, QStringList> check; // "check" conditions, by package.
+};
+
+#endif // HARDWARERULES_H // End of the include guard.
@@ -0,0 +1,300 @@
+#include "headlessprovisioner.h" // Includes the header file for the HeadlessProvisioner class.
+#include "applyjournal.h" // Lets a second run resume a failed apply.
+#include "connectivitymonitor.h" // Waits for the internet.
+#include "mirrorranker.h" // Ranks the mirrors before the update.
+#include "refreshplanner.h" // Decides how much of the update is needed.
+#include "tracer.h" // Records the pipeline when SNIGDHAOS_BLACKBOX_TRACE is set.
+
+#include <QCommandLineParser> // Parses the arguments of --profile.
+#include <QCoreApplication> // Locates the executable.
+#include <QEventLoop> // Waits for the pipeline.
+#include <QFile> // Writes the files passed to apply.sh.
+#include <QFileInfo> // Checks whether the update replaced the executable.
+#include <QProcess> // Runs update.sh and apply.sh.
+#include <QStandardPaths> // Locates the per-user cache directory.
+#include <QtConcurrent/QtConcurrentRun> // Reads the databases on the thread pool.
+
+#include <cstdio> // Prints status lines and reads the confirmation.
+#include <unistd.h> // Starts the new executable after an update.
+
+HeadlessProvisioner::HeadlessProvisioner(const Profile &profile, bool assumeYes, const OfflineBundle &bundle, QObject *parent)
+    : QObject(parent) // Initializes the base object with the given parent.
+    , profile(profile) // The selection to apply.
+    , assumeYes(assumeYes) // Whether to start without asking.
+    , bundle(bundle) // Where the packages come from.
+    , executableModified(QFileInfo(QCoreApplication::applicationFilePath()).lastModified()) // Compared after the update.
+    , connectivityMonitor(new ConnectivityMonitor(ConnectivityMonitor::defaultEndpoints(), this)) // Same endpoints as the window.
+    , mirrorRanker(new MirrorRanker(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/mirrors",  // Shares the rankings of the window,
+                                    qEnvironmentVariableIsSet("SNIGDHAOS_BLACKBOX_MIRROR_TTL") ? qEnvironmentVariableIntValue("SNIGDHAOS_BLACKBOX_MIRROR_TTL") : 6 * 60 * 60,  // with the same lifetime,
+                                    this))
+    , refreshPlanner(new RefreshPlanner("/var/lib/pacman/sync", this)) // Compares the sync databases with the mirrors.
+{
+    connect(connectivityMonitor, &ConnectivityMonitor::online, this, [this]() {
+        if (currentState == State::INTERNET) {
+            updateState(State::UPDATE);
+        }
+    });
+    connect(mirrorRanker, &MirrorRanker::finished, this, [this]() {
+        if (currentState == State::UPDATE) {
+            say("Checking for updates...");
+            refreshPlanner->start();
+        }
+    });
+    connect(refreshPlanner, &RefreshPlanner::finished, this, [this]() {
+        if (currentState == State::UPDATE) {
+            runUpdate();
+        }
+    });
+}
+
+void HeadlessProvisioner::start() {
+    const QStringList packages = profile.packages();
+    say(QString("Profile: %1 packages, %2 preparation steps, %3 setup steps")
+            .arg(packages.size()).arg(profile.prepareSteps().size()).arg(profile.setupSteps().size()));
+
+    // Ask once for the whole run; the scripts themselves run without prompts.
+    if (!assumeYes) {
+        fputs(bundle.isValid() ? "Apply the profile from the bundle? [y/N] " : "Update the system and apply the profile? [y/N] ", stdout);
+        fflush(stdout);
+        char answer[16] = {};
+        if (!fgets(answer, sizeof(answer), stdin) || (answer[0] != 'y' && answer[0] != 'Y')) {
+            finish(1);
+            return;
+        }
+    }
+
+    loadDatabases();
+    updateState(State::INTERNET);
+}
+
+void HeadlessProvisioner::updateState(State state) {
+    // Each state is one span in the trace, like in the window.
+    static const char *names[] = { "INTERNET", "UPDATE", "APPLY", "DONE" };
+    Tracer::end(names[int(currentState)]);
+    if (state != State::DONE) {
+        Tracer::begin(names[int(state)], "state");
+    }
+
+    currentState = state;
+    switch (state) {
+    case State::INTERNET:
+        // A bundle has everything on disk: no internet, no update.
+        if (bundle.isValid()) {
+            say(QString("Installing from the bundle in %1, without the internet.").arg(bundle.directory()));
+            updateState(State::APPLY);
+            break;
+        }
+        say("Waiting for the internet...");
+        connectivityMonitor->start();
+        break;
+
+    case State::UPDATE:
+        // A relaunch after an update that replaced the executable continues with the apply.
+        if (qEnvironmentVariableIsSet("SNIGDHAOS_BLACKBOX_SELFUPDATE")) {
+            updateState(State::APPLY);
+            break;
+        }
+        say("Ranking mirrors...");
+        mirrorRanker->start();
+        break;
+
+    case State::APPLY:
+        doApply();
+        break;
+
+    case State::DONE:
+        break;
+    }
+}
+
+void HeadlessProvisioner::loadDatabases() {
+    // A bundle is the only repository the packages can come from.
+    QString directory = bundle.isValid() ? bundle.directory() : "/var/lib/pacman/sync";
+    QString cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + (bundle.isValid() ? "/bundle" : "/sync");
+    QStringList repositories = bundle.isValid() ? QStringList { OfflineBundle::REPOSITORY } : QStringList();
+    syncDatabase = QtConcurrent::run([directory, cacheDirectory, repositories]() {
+        return SyncDatabase::load(directory, cacheDirectory, repositories);
+    });
+    QString cacheFile = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/local.bin";
+    localDatabase = QtConcurrent::run([cacheFile]() {
+        return LocalDatabase::load("/var/lib/pacman/local", cacheFile);
+    });
+}
+
+void HeadlessProvisioner::runUpdate() {
+    RefreshPlanner::Plan plan = refreshPlanner->plan(syncDatabase.result(), localDatabase.result());
+    if (plan == RefreshPlanner::Plan::UP_TO_DATE) {
+        say("The system is up to date.");
+        updateState(State::APPLY);
+        return;
+    }
+
+    // Same operation and mirror lists as the window passes to update.sh.
+    QStringList arguments = { "/usr/lib/snigdhaos-blackbox/update.sh", plan == RefreshPlanner::Plan::UPGRADE ? "-Su" : "-Syu" };
+    const QHash<QString, QString> mirrorlists = mirrorRanker->rankedMirrorlists();
+    for (auto it = mirrorlists.constBegin(); it != mirrorlists.constEnd(); ++it) {
+        arguments << it.value() << it.key();
+    }
+
+    say("Updating the system...");
+    runScript(arguments, [this](bool success) {
+        updateFinished(success);
+    });
+}
+
+void HeadlessProvisioner::updateFinished(bool success) {
+    if (!success) {
+        say("The system update failed.");
+        finish(1);
+        return;
+    }
+
+    // Continue with the new version if the update replaced the executable, skipping the update this time.
+    QString executable = QCoreApplication::applicationFilePath();
+    if (QFileInfo(executable).lastModified() != executableModified) {
+        QList<QByteArray> arguments;
+        for (const QString &argument : QCoreApplication::arguments()) {
+            arguments += argument.toLocal8Bit();
+        }
+        QVector<char *> argv;
+        for (QByteArray &argument : arguments) {
+            argv += argument.data();
+        }
+        argv += nullptr;
+        qputenv("SNIGDHAOS_BLACKBOX_SELFUPDATE", "1");
+        Tracer::prepareExec();
+        execv(QFile::encodeName(executable).constData(), argv.data());
+    }
+
+    // The update refreshed the sync databases, so read them again before resolving the profile.
+    loadDatabases();
+    updateState(State::APPLY);
+}
+
+void HeadlessProvisioner::doApply() {
+    // Prepare the profile for this machine, like the window does with the selection.
+    const QStringList selected = profile.packages();
+    profile.resolve(syncDatabase.result(), localDatabase.result());
+    const QStringList packages = profile.packages();
+    if (packages.isEmpty() && profile.prepareSteps().isEmpty() && profile.setupSteps().isEmpty()) {
+        say("Nothing to do: the packages of the profile are installed or cannot be installed from the enabled repositories.");
+        finish(0);
+        return;
+    }
+
+    // Write the same files the window passes to apply.sh.
+    auto write = [this](const QString &name, const QByteArray &data) {
+        QFile file(files.filePath(name));
+        file.open(QIODevice::WriteOnly);
+        file.write(data);
+        return file.fileName();
+    };
+    QString prepareFile = write("prepare", profile.prepareSteps().isEmpty() ? QByteArray() : CommandGraph::write(profile.prepareSteps()));
+    QString packagesFile = write("packages", packages.join(' ').toUtf8());
+    QString setupFile = write("setup", profile.setupSteps().isEmpty() ? QByteArray() : CommandGraph::write(profile.setupSteps()));
+
+    // Like a retry in the window, running the same profile again after a failure skips what already succeeded.
+    QString journal = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/apply.journal";
+    ApplyJournal::create(journal, { CommandGraph::write(profile.prepareSteps()), selected.join(' ').toUtf8(), CommandGraph::write(profile.setupSteps()) });
+
+    // With a bundle, pacman installs its package files of the whole closure under the system's database, so nothing
+    // comes from the mirrors. runScript() passes the lists on.
+    if (bundle.isValid()) {
+        OfflineBundle::Installation installation = bundle.installation(packages, syncDatabase.result(), localDatabase.result());
+        write("bundle-files", installation.files);
+        write("bundle-dependencies", installation.dependencies);
+    }
+    QStringList arguments = { "/usr/lib/snigdhaos-blackbox/apply.sh", prepareFile, packagesFile, setupFile };
+
+    say(QString("Installing %1 packages...").arg(packages.size()));
+    runScript(arguments, [this, journal](bool success) {
+        if (success) {
+            ApplyJournal::remove(journal);
+        }
+        say(success ? "The profile was applied." : "Applying the profile failed.");
+        finish(success ? 0 : 1);
+    });
+}
+
+void HeadlessProvisioner::runScript(const QStringList &arguments, std::function<void(bool)> done) {
+    // The scripts talk to the current terminal directly, confirm by themselves,
+    // and run the steps of a profile through this executable.
+    auto process = new QProcess(this);
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert("SNIGDHAOS_BLACKBOX", QCoreApplication::applicationFilePath());
+    environment.insert("SNIGDHAOS_BLACKBOX_NONINTERACTIVE", "1");
+    environment.insert("SNIGDHAOS_BLACKBOX_JOURNAL", QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/apply.journal");
+    if (bundle.isValid()) {
+        environment.insert("SNIGDHAOS_BLACKBOX_BUNDLE_FILES", files.filePath("bundle-files"));
+        environment.insert("SNIGDHAOS_BLACKBOX_BUNDLE_DEPENDENCIES", files.filePath("bundle-dependencies"));
+    }
+    process->setProcessEnvironment(environment);
+    process->setProcessChannelMode(QProcess::ForwardedChannels);
+    process->setInputChannelMode(QProcess::ForwardedInputChannel);
+
+    QString script = QFileInfo(arguments.first()).fileName();
+    Tracer::begin(script, "script");
+    connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [process, done, script](int exitcode, QProcess::ExitStatus status) {
+        process->deleteLater();
+        Tracer::end(script);
+        done(status == QProcess::NormalExit && exitcode == 0);
+    });
+    connect(process, &QProcess::errorOccurred, this, [process, done](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            process->deleteLater();
+            done(false);
+        }
+    });
+    process->start(arguments.first(), arguments.mid(1));
+}
+
+void HeadlessProvisioner::say(const QString &text) {
+    fputs(("==> " + text + "\n").toLocal8Bit().constData(), stdout);
+    fflush(stdout);
+}
+
+void HeadlessProvisioner::finish(int status) {
+    updateState(State::DONE);
+    connectivityMonitor->stop();
+    emit finished(status);
+}
+
+int HeadlessProvisioner::run(const QStringList &arguments) {
+    QCommandLineParser parser;
+    QCommandLineOption profileOption("profile", "Applies a profile exported from the select widget.", "file");
+    QCommandLineOption bundleOption("bundle", "Installs from an offline bundle written by --export-bundle, by default its own profile.", "directory");
+    QCommandLineOption yesOption({ "y", "yes" }, "Starts without asking for confirmation.");
+    parser.addOptions({ profileOption, bundleOption, yesOption });
+    parser.process(arguments);
+
+    QString error;
+    OfflineBundle bundle;
+    if (parser.isSet(bundleOption)) {
+        bundle = OfflineBundle::open(parser.value(bundleOption), &error);
+        if (!bundle.isValid()) {
+            say(QString("Cannot read the bundle %1: %2").arg(parser.value(bundleOption), error));
+            return 1;
+        }
+    }
+
+    QString profileFile = parser.isSet(profileOption) || !bundle.isValid() ? parser.value(profileOption) : bundle.profileFile();
+    Profile profile = Profile::load(profileFile, &error);
+    if (!error.isEmpty()) {
+        say(QString("Cannot read the profile %1: %2").arg(profileFile, error));
+        return 1;
+    }
+
+    // Run until the pipeline finished. A declined confirmation finishes right away.
+    HeadlessProvisioner provisioner(profile, parser.isSet(yesOption), bundle);
+    QEventLoop loop;
+    int status = -1;
+    connect(&provisioner, &HeadlessProvisioner::finished, &loop, [&loop, &status](int result) {
+        status = result;
+        loop.quit();
+    });
+    provisioner.start();
+    if (status < 0) {
+        loop.exec();
+    }
+    return status;
+}
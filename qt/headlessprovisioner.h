@@ -0,0 +1,101 @@
+#ifndef HEADLESSPROVISIONER_H // Start of include guard to prevent multiple inclusions of this header file.
+#define HEADLESSPROVISIONER_H // Define the include guard macro.
+
+#include "localdatabase.h" // Installed package versions, for the update plan.
+#include "offlinebundle.h" // Local repository to install from instead of the mirrors.
+#include "profile.h" // The selection to apply.
+#include "syncdatabase.h" // Available packages.
+
+#include <QDateTime> // Modification time of the executable.
+#include <QFuture> // Background reads of the databases.
+#include <QObject> // Base class providing signals and slots.
+#include <QTemporaryDir> // Holds the files passed to apply.sh.
+
+#include <functional> // Continuations of the scripts.
+
+class ConnectivityMonitor; // Forward declaration of the service waiting for internet connectivity.
+class MirrorRanker; // Forward declaration of the mirror ranking done before the update.
+class RefreshPlanner; // Forward declaration of the check deciding how much of the update is needed.
+
+// Applies a profile exported from the select widget without a window, for provisioning many machines:
+//   snigdhaos-blackbox --profile <file> [--yes]
+//   snigdhaos-blackbox --bundle <directory> [--profile <file>] [--yes]
+//
+// It runs the same pipeline as the window, INTERNET, UPDATE and APPLY, with the same services, but only
+// needs Qt Core and Qt Network, so it starts without a display and without initializing Qt Widgets.
+// update.sh and apply.sh run in the current terminal and without prompts; unless --yes is given, the
+// user confirms the whole run once before it starts. If the update replaced the executable, the new
+// version is started to apply the profile, like the window relaunches itself.
+// With an offline bundle, the profile of the bundle is installed from its directory: the internet and the
+// update are skipped, and pacman reads the packages from disk.
+class HeadlessProvisioner : public QObject
+{
+    Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
+
+public:
+    // Steps of the pipeline, named like the states of the window.
+    enum class State {
+        INTERNET, // Waiting for the internet.
+        UPDATE,   // Ranking the mirrors, checking for updates and updating the system.
+        APPLY,    // Installing the profile.
+        DONE      // Finished, successfully or not.
+    };
+
+    // Constructor for the HeadlessProvisioner class.
+    // Parameters:
+    // - profile: The selection to apply.
+    // - assumeYes: Whether to start without asking for confirmation.
+    // - bundle: Offline bundle to install from, or an invalid one to use the mirrors.
+    // - parent: Pointer to the parent object that owns the provisioner.
+    HeadlessProvisioner(const Profile &profile, bool assumeYes, const OfflineBundle &bundle = OfflineBundle(), QObject *parent = nullptr);
+
+    // Asks for confirmation unless assumeYes was given, then starts the pipeline.
+    // Emits finished() when done.
+    void start();
+
+    // Runs "--profile <file> [--yes]" or "--bundle <directory> [--yes]" and returns the exit status of the process.
+    static int run(const QStringList &arguments);
+
+signals:
+    // Emitted once the profile was applied or a step failed, with the exit status of the process.
+    void finished(int status);
+
+private:
+    // Moves to the next step of the pipeline.
+    void updateState(State state);
+
+    // Reads the sync and local databases in the background.
+    void loadDatabases();
+
+    // Runs as much of the system update as needed, once the mirrors are ranked and compared.
+    void runUpdate();
+
+    // Continues after the system update, starting the new executable if the update replaced it.
+    void updateFinished(bool success);
+
+    // Installs the profile with apply.sh.
+    void doApply();
+
+    // Runs a script in the current terminal without prompts and calls done with whether it succeeded.
+    void runScript(const QStringList &arguments, std::function<void(bool)> done);
+
+    // Prints a status line.
+    static void say(const QString &text);
+
+    // Reports the result of the run.
+    void finish(int status);
+
+    Profile profile;                           // The selection to apply.
+    bool assumeYes;                            // Whether to start without asking.
+    OfflineBundle bundle;                      // Offline bundle to install from, invalid to use the mirrors.
+    State currentState = State::INTERNET;      // Current step of the pipeline.
+    QDateTime executableModified;              // Modification time of the executable at startup.
+    QFuture<SyncDatabase> syncDatabase;        // Background read of the pacman sync databases.
+    QFuture<LocalDatabase> localDatabase;      // Background read of the pacman local database.
+    ConnectivityMonitor *connectivityMonitor;  // Waits for the internet before the update.
+    MirrorRanker *mirrorRanker;                // Orders the mirrors by speed before the update.
+    RefreshPlanner *refreshPlanner;            // Skips refreshing or upgrading when nothing changed.
+    QTemporaryDir files;                       // Files passed to apply.sh.
+};
+
+#endif // HEADLESSPROVISIONER_H // End of the include guard.
@@ -0,0 +1,185 @@
+#include "localdatabase.h" // Includes the header file for the LocalDatabase class.
+
+#include <QDataStream> // Encodes the cache.
+#include <QDateTime> // Modification times of the package directories.
+#include <QDir> // Used to list the installed packages.
+#include <QFile> // Used to read the desc files and the cache.
+#include <QFileInfo> // Reads the modification times.
+#include <QSaveFile> // Replaces the cache atomically.
+#include <QtConcurrent/QtConcurrentMap> // Reads the desc files in parallel.
+
+#include <algorithm> // Drops the directories that could not be read.
+
+namespace {
+
+constexpr quint32 CACHE_MAGIC = 0x534f4c44;   // "SOLD", identifies the cache file.
+constexpr quint32 CACHE_VERSION = 1;          // Incremented whenever the layout of the cache changes.
+
+// What is read from the desc file of one installed package.
+struct Package {
+    QString directory;           // Name of the package directory, e.g. "bash-5.2.037-1".
+    qint64 modified = -1;        // Modification time of the directory in milliseconds.
+    QByteArray name;             // Package name, empty if the desc file could not be read.
+    QByteArray version;          // Installed version.
+    QList<QByteArray> provides;  // Provided names, without versions.
+};
+
+QDataStream &operator<<(QDataStream &stream, const Package &package) {
+    return stream << package.directory << package.modified << package.name << package.version << package.provides;
+}
+
+QDataStream &operator>>(QDataStream &stream, Package &package) {
+    return stream >> package.directory >> package.modified >> package.name >> package.version >> package.provides;
+}
+
+// Reads one desc file. Same format as the sync databases: "%FIELD%" headers, each followed by its values and a blank line.
+Package readDesc(const QFileInfo &directory) {
+    Package package;
+    package.directory = directory.fileName();
+    package.modified = directory.lastModified().toMSecsSinceEpoch();
+
+    QFile file(directory.filePath() + "/desc");
+    if (!file.open(QIODevice::ReadOnly)) {
+        return package;
+    }
+
+    QByteArray field;
+    for (const QByteArray &line : file.readAll().split('\n')) {
+        if (line.startsWith('%') && line.endsWith('%')) {
+            field = line;
+        }
+        else if (line.isEmpty()) {
+            field.clear();
+        }
+        else if (field == "%NAME%") {
+            package.name = line;
+        }
+        else if (field == "%VERSION%") {
+            package.version = line;
+        }
+        else if (field == "%PROVIDES%") {
+            // Strip the version, e.g. "sh=5.2" provides "sh".
+            int equals = line.indexOf('=');
+            package.provides += equals < 0 ? line : line.left(equals);
+        }
+    }
+    return package;
+}
+
+} // namespace
+
+LocalDatabase LocalDatabase::load(const QString &directory, const QString &cacheFile) {
+    LocalDatabase database;
+    QFileInfo info(directory);
+    if (!info.isDir()) {
+        return database;
+    }
+    qint64 modified = info.lastModified().toMSecsSinceEpoch();
+
+    // Read what the last run found, keyed by package directory.
+    QHash<QString, Package> cached;
+    qint64 cachedModified = -1;
+    QFile cache(cacheFile);
+    if (!cacheFile.isEmpty() && cache.open(QIODevice::ReadOnly)) {
+        QDataStream stream(&cache);
+        quint32 magic = 0, version = 0;
+        stream >> magic >> version;
+        if (magic == CACHE_MAGIC && version == CACHE_VERSION) {
+            QVector<Package> packages;
+            stream >> cachedModified >> packages;
+            if (stream.status() == QDataStream::Ok) {
+                for (const Package &package : packages) {
+                    cached.insert(package.directory, package);
+                }
+            }
+            else {
+                cachedModified = -1;
+            }
+        }
+    }
+
+    QVector<Package> packages;
+    if (modified == cachedModified) {
+        // No package was installed or removed since the cache was written.
+        packages.reserve(cached.size());
+        for (const Package &package : cached) {
+            packages += package;
+        }
+    }
+    else {
+        // Keep the packages whose directories did not change and read the others in parallel.
+        QList<QFileInfo> changed;
+        for (const QFileInfo &entry : QDir(directory).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            auto it = cached.constFind(entry.fileName());
+            if (it != cached.constEnd() && it->modified == entry.lastModified().toMSecsSinceEpoch()) {
+                packages += it.value();
+            }
+            else {
+                changed += entry;
+            }
+        }
+        packages += QtConcurrent::blockingMapped<QVector<Package>>(changed, readDesc);
+
+        // Directories without a readable desc file, e.g. one pacman is still writing, are read again next time.
+        packages.erase(std::remove_if(packages.begin(), packages.end(), [](const Package &package) {
+            return package.name.isEmpty();
+        }), packages.end());
+
+        // Write the cache for the next run.
+        if (!cacheFile.isEmpty()) {
+            QDir().mkpath(QFileInfo(cacheFile).absolutePath());
+            QSaveFile file(cacheFile);
+            if (file.open(QIODevice::WriteOnly)) {
+                QDataStream stream(&file);
+                stream << CACHE_MAGIC << CACHE_VERSION << modified << packages;
+                file.commit();
+            }
+        }
+    }
+
+    for (const Package &package : packages) {
+        database.versions.insert(package.name, package.version);
+        for (const QByteArray &provide : package.provides) {
+            database.provided.insert(provide);
+        }
+    }
+    return database;
+}
+
+bool LocalDatabase::isEmpty() const {
+    return versions.isEmpty();
+}
+
+bool LocalDatabase::isInstalled(const QByteArray &name) const {
+    return versions.contains(name);
+}
+
+bool LocalDatabase::isFullyInstalled(const QByteArray &name, const SyncDatabase &sync) const {
+    if (versions.contains(name)) {
+        return true;
+    }
+
+    // A group counts as installed once all of its members are; nothing is known about other names.
+    const QVector<SyncDatabase::Package> members = sync.groupMembers(name);
+    if (members.isEmpty()) {
+        return false;
+    }
+    for (const SyncDatabase::Package &member : members) {
+        if (!versions.contains(member.repository->name(member.index))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QList<QByteArray> LocalDatabase::packages() const {
+    return versions.keys();
+}
+
+QByteArray LocalDatabase::version(const QByteArray &name) const {
+    return versions.value(name);
+}
+
+bool LocalDatabase::satisfies(const QByteArray &dependency) const {
+    return versions.contains(dependency) || provided.contains(dependency);
+}
@@ -0,0 +1,50 @@
+#ifndef LOCALDATABASE_H // Start of include guard to prevent multiple inclusions of this header file.
+#define LOCALDATABASE_H // Define the include guard macro.
+
+#include "syncdatabase.h" // Group members, to tell whether a whole group is installed.
+
+#include <QByteArray> // Package names and versions.
+#include <QHash> // Maps installed packages to their versions.
+#include <QSet> // Names provided by the installed packages.
+#include <QString> // Used to pass the database directory.
+
+// Packages installed on this system, read from the pacman local database ("/var/lib/pacman/local"),
+// which has one "<name>-<version>/desc" file per installed package.
+//
+// Reading every desc file takes a while on a large installation, so the result can be cached. Pacman
+// creates a new directory for every installed or upgraded package and removes the old one, so the
+// modification times of the directories tell what changed: when the database directory itself is
+// unchanged the cache is used as is, otherwise only the desc files of new or modified package
+// directories are read again, in parallel.
+class LocalDatabase
+{
+public:
+    // Reads the desc file of every installed package in the given directory. If a cache file is given,
+    // unchanged packages are taken from it and it is updated afterwards.
+    static LocalDatabase load(const QString &directory, const QString &cacheFile = QString());
+
+    // True if nothing could be read, in which case every package is treated as not installed.
+    bool isEmpty() const;
+
+    // Whether a package with the given name is installed.
+    bool isInstalled(const QByteArray &name) const;
+
+    // Whether installing a name would not add anything: the package is installed or, for a group,
+    // every member of the group in the sync databases is.
+    bool isFullyInstalled(const QByteArray &name, const SyncDatabase &sync) const;
+
+    // Names of the installed packages, in no particular order.
+    QList<QByteArray> packages() const;
+
+    // Returns the installed version of a package, or an empty array.
+    QByteArray version(const QByteArray &name) const;
+
+    // Whether a dependency is satisfied, i.e. a package of that name, or one providing it, is installed.
+    bool satisfies(const QByteArray &dependency) const;
+
+private:
+    QHash<QByteArray, QByteArray> versions; // Installed package names and their versions.
+    QSet<QByteArray> provided;              // Names provided by the installed packages.
+};
+
+#endif // LOCALDATABASE_H // End of the include guard.
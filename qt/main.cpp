@@ -1,9 +1,40 @@
+#include "bundleexporter.h" // Writes offline bundles without a window.
+#include "commandgraph.h" // Runs the prepare and setup steps of an apply.
+#include "headlessprovisioner.h" // Applies a profile without a window.
+#include "tracer.h" // Records the startup when SNIGDHAOS_BLACKBOX_TRACE is set.
 #include "snigdhaosblackbox.h" // Include the header file for the SnigdhaOSBlackbox class, which defines the core functionality of the application.
 
 #include <QApplication> // Include the QApplication class, which manages application-wide resources and event handling.
+#include <QCoreApplication> // Event loop without Qt Widgets, for the modes that need no window.
 
 int main(int argc, char *argv[]) // Entry point of the application. It accepts command-line arguments.
 {
+    // apply.sh runs the selected prepare and setup steps through the application itself, as root and without a window.
+    if (argc > 1 && QString(argv[1]) == "--run-steps") {
+        QCoreApplication a(argc, argv);
+        return CommandGraph::run(a.arguments());
+    }
+
+    // Writing an offline bundle ("--export-bundle <directory> --profile <file>") needs no display either.
+    for (int i = 1; i < argc; i++) {
+        if (QString(argv[i]).startsWith("--export-bundle")) {
+            QCoreApplication a(argc, argv);
+            return BundleExporter::run(a.arguments());
+        }
+    }
+
+    // Applying a profile ("--profile <file> [--yes]") or a bundle ("--bundle <directory> [--yes]") needs no display:
+    // only start Qt Core, so it also runs on minimal images.
+    for (int i = 1; i < argc; i++) {
+        if (QString(argv[i]).startsWith("--profile") || QString(argv[i]).startsWith("--bundle")) {
+            QCoreApplication a(argc, argv);
+            return HeadlessProvisioner::run(a.arguments());
+        }
+    }
+
+    // The startup span lasts until the window is shown; after a relaunch it follows the exec in the same trace.
+    Tracer::begin("startup", "process");
+
     // Create a QApplication object to manage the application's GUI event loop and initialize resources.
     QApplication a(argc, argv);
 
@@ -14,6 +45,7 @@ int main(int argc, char *argv[]) // Entry point of the application. It accepts c
 
     // Show the main window of the SnigdhaOSBlackbox application.
     w.show();
+    Tracer::end("startup");
 
     // Enter the event loop, which waits for and processes user interaction events.
     return a.exec();
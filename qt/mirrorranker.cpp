@@ -0,0 +1,234 @@
+#include "mirrorranker.h" // Includes the header file for the MirrorRanker class.
+#include "pacmanconfig.h" // Mirror lists and the repositories including them.
+
+#include <QDateTime> // Checks the age of a cached ranking.
+#include <QDir> // Creates the cache directory.
+#include <QFile> // Reads and compares the mirror lists.
+#include <QFileInfo> // Used to name the cached rankings.
+#include <QSaveFile> // Writes the rankings atomically.
+#include <QTimer> // Global timeout.
+#include <QUrl> // Probe URLs.
+#include <QtNetwork/QNetworkAccessManager> // Runs the probes.
+#include <QtNetwork/QNetworkReply> // Running probes.
+
+#include <algorithm> // Used to order the servers.
+
+MirrorRanker::MirrorRanker(const QString &cacheDirectory, int timeToLive, QObject *parent)
+    : QObject(parent) // Initializes the base object with the given parent.
+    , cachePath(cacheDirectory) // Directory holding the ranked mirror lists.
+    , ttl(timeToLive) // How long a ranking is reused.
+    , network(new QNetworkAccessManager(this)) // Runs the probes.
+    , deadline(new QTimer(this)) // Global timeout.
+{
+    deadline->setSingleShot(true);
+    deadline->setInterval(TIMEOUT);
+    connect(deadline, &QTimer::timeout, this, &MirrorRanker::finish);
+}
+
+MirrorRanker::~MirrorRanker() {
+    for (Probe &probe : probes) {
+        if (probe.reply) {
+            probe.reply->disconnect(this);
+            probe.reply->abort();
+        }
+    }
+}
+
+void MirrorRanker::start() {
+    // Already running.
+    if (pending > 0) {
+        return;
+    }
+    probes.clear();
+    probed.clear();
+    ranked.clear();
+
+    PacmanConfig config = PacmanConfig::load();
+    for (const QString &mirrorlist : config.mirrorlists()) {
+        // Reuse a recent ranking of the same servers.
+        QString cached = cachedRanking(mirrorlist);
+        if (!cached.isEmpty()) {
+            addRanking(mirrorlist, cached);
+            continue;
+        }
+
+        // Probe the database of a repository using the list; it exists on every server of the list.
+        QString repository = config.includingRepository(mirrorlist);
+        probed += mirrorlist;
+        for (const QString &server : PacmanConfig::readMirrorlist(mirrorlist)) {
+            Probe probe;
+            probe.mirrorlist = mirrorlist;
+            probe.server = server;
+            probes.append(probe);
+        }
+        for (int i = probes.size() - 1; i >= 0 && probes[i].mirrorlist == mirrorlist; i--) {
+            QUrl url(PacmanConfig::expand(probes[i].server, repository) + "/" + repository + ".db");
+            if (!url.scheme().startsWith("http")) {
+                continue; // Local servers are not ranked.
+            }
+
+            QNetworkRequest request(url);
+            request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+            probes[i].timer.start();
+            probes[i].reply = network->get(request);
+            pending++;
+            connect(probes[i].reply, &QNetworkReply::readyRead, this, [this, i]() {
+                probeRead(i);
+            });
+            connect(probes[i].reply, &QNetworkReply::finished, this, [this, i]() {
+                probeFinished(i);
+            });
+        }
+    }
+
+    if (pending > 0) {
+        deadline->start();
+    }
+    else {
+        // Keep the signal asynchronous, like when probing.
+        QTimer::singleShot(0, this, &MirrorRanker::finish);
+    }
+}
+
+void MirrorRanker::probeRead(int index) {
+    Probe &probe = probes[index];
+    if (probe.firstByte < 0) {
+        probe.firstByte = probe.timer.elapsed();
+    }
+    probe.bytes += probe.reply->readAll().size();
+
+    // A sample is enough to estimate the throughput.
+    if (probe.bytes >= SAMPLE_SIZE) {
+        probeFinished(index);
+    }
+}
+
+void MirrorRanker::probeFinished(int index) {
+    Probe &probe = probes[index];
+    if (!probe.reply) {
+        return;
+    }
+
+    QNetworkReply *reply = probe.reply;
+    probe.reply = nullptr;
+    reply->disconnect(this);
+    probe.bytes += reply->readAll().size();
+    qint64 elapsed = probe.timer.elapsed();
+
+    // A complete small database or a full sample both count; errors leave the server unranked.
+    bool answered = probe.firstByte >= 0 && (reply->error() == QNetworkReply::NoError || probe.bytes >= SAMPLE_SIZE);
+    if (answered) {
+        // Estimate the time to fetch 1 MiB: latency plus transfer at the measured rate.
+        double throughput = double(probe.bytes) / double(qMax<qint64>(1, elapsed - probe.firstByte)); // Bytes per millisecond.
+        probe.score = double(probe.firstByte) + 1024.0 * 1024.0 / qMax(throughput, 1.0);
+    }
+    reply->abort();
+    reply->deleteLater();
+
+    if (--pending == 0) {
+        finish();
+    }
+}
+
+void MirrorRanker::finish() {
+    deadline->stop();
+
+    // Servers still running at the deadline count as not answering.
+    for (Probe &probe : probes) {
+        if (probe.reply) {
+            probe.reply->disconnect(this);
+            probe.reply->abort();
+            probe.reply->deleteLater();
+            probe.reply = nullptr;
+        }
+    }
+    pending = 0;
+
+    for (const QString &mirrorlist : probed) {
+        QVector<const Probe *> servers;
+        for (const Probe &probe : probes) {
+            if (probe.mirrorlist == mirrorlist) {
+                servers.append(&probe);
+            }
+        }
+
+        // Fastest first; servers that did not answer keep their order at the end.
+        std::stable_sort(servers.begin(), servers.end(), [](const Probe *a, const Probe *b) {
+            if (a->score < 0) {
+                return false;
+            }
+            return b->score < 0 || a->score < b->score;
+        });
+        QStringList order;
+        for (const Probe *probe : servers) {
+            order += probe->server;
+        }
+
+        QString file = writeRanking(mirrorlist, order);
+        if (!file.isEmpty()) {
+            addRanking(mirrorlist, file);
+        }
+    }
+    probed.clear();
+
+    emit finished();
+}
+
+QString MirrorRanker::cachedRanking(const QString &mirrorlist) const {
+    QString file = cachePath + "/" + QFileInfo(mirrorlist).fileName();
+    QFileInfo info(file);
+    if (!info.exists() || info.lastModified().secsTo(QDateTime::currentDateTime()) > ttl) {
+        return QString();
+    }
+
+    // The ranking only applies while the installed list has the same servers, in whatever order.
+    QStringList cached = PacmanConfig::readMirrorlist(file);
+    QStringList installed = PacmanConfig::readMirrorlist(mirrorlist);
+    std::sort(cached.begin(), cached.end());
+    std::sort(installed.begin(), installed.end());
+    return cached == installed ? file : QString();
+}
+
+QString MirrorRanker::writeRanking(const QString &mirrorlist, const QStringList &servers) const {
+    QFile input(mirrorlist);
+    if (!input.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+
+    // The ranked servers come first, followed by the rest of the list without its active servers,
+    // so comments and disabled servers are kept.
+    QByteArray output = "# Ranked by Snigdha OS Blackbox on " + QDateTime::currentDateTime().toString(Qt::ISODate).toUtf8() + "\n";
+    for (const QString &server : servers) {
+        output += "Server = " + server.toUtf8() + "\n";
+    }
+    output += "\n";
+    for (const QByteArray &line : input.readAll().split('\n')) {
+        QByteArray trimmed = line.trimmed();
+        if (trimmed.startsWith("# Ranked by Snigdha OS Blackbox")) {
+            continue;
+        }
+        if (!trimmed.startsWith('#') && trimmed.split('=').first().trimmed() == "Server") {
+            continue;
+        }
+        output += line + "\n";
+    }
+
+    QDir().mkpath(cachePath);
+    QSaveFile file(cachePath + "/" + QFileInfo(mirrorlist).fileName());
+    if (!file.open(QIODevice::WriteOnly)) {
+        return QString();
+    }
+    file.write(output.trimmed() + "\n");
+    return file.commit() ? file.fileName() : QString();
+}
+
+void MirrorRanker::addRanking(const QString &mirrorlist, const QString &file) {
+    // Nothing has to be copied if the installed list already has this order.
+    if (PacmanConfig::readMirrorlist(file) != PacmanConfig::readMirrorlist(mirrorlist)) {
+        ranked.insert(mirrorlist, file);
+    }
+}
+
+QHash<QString, QString> MirrorRanker::rankedMirrorlists() const {
+    return ranked;
+}
@@ -0,0 +1,90 @@
+#ifndef MIRRORRANKER_H // Start of include guard to prevent multiple inclusions of this header file.
+#define MIRRORRANKER_H // Define the include guard macro.
+
+#include <QElapsedTimer> // Measures the probes.
+#include <QHash> // Maps the installed mirror lists to their ranked copies.
+#include <QObject> // Base class providing signals and slots.
+#include <QStringList> // Servers of a mirror list.
+#include <QVector> // Holds the probes.
+
+class QNetworkAccessManager; // Forward declaration of the manager running the probes.
+class QNetworkReply; // Forward declaration of a running probe.
+class QTimer; // Forward declaration of the global timeout.
+
+// Orders the servers of every mirror list included by pacman.conf (e.g. "/etc/pacman.d/mirrorlist"
+// and "/etc/pacman.d/blackarch-mirrorlist") by how fast they are from here, so the update does not
+// start with a slow or dead mirror.
+//
+// All servers are probed at once by downloading the start of a repository database, measuring the
+// time to the first byte and the throughput, under one global timeout. Servers that did not answer
+// keep their relative order behind the ones that did. The ranked lists are written to the cache
+// directory and reused for a configurable time, as long as the servers in the installed list did not
+// change. Writing them to /etc needs root, so the caller copies them in place as part of the update.
+class MirrorRanker : public QObject
+{
+    Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
+
+public:
+    // Constructor for the MirrorRanker class.
+    // Parameters:
+    // - cacheDirectory: Where the ranked mirror lists are stored.
+    // - timeToLive: How long a ranking is reused, in seconds.
+    // - parent: Pointer to the parent object that owns the ranker.
+    MirrorRanker(const QString &cacheDirectory, int timeToLive, QObject *parent = nullptr);
+
+    // Aborts the running probes.
+    ~MirrorRanker();
+
+    // Starts ranking the mirror lists. Emits finished() when done, also if nothing had to be probed.
+    void start();
+
+    // Ranked copies of the mirror lists whose order differs from the installed ones, keyed by the path
+    // of the installed mirror list. Valid after finished() was emitted.
+    QHash<QString, QString> rankedMirrorlists() const;
+
+signals:
+    // Emitted once every mirror list was ranked or the global timeout expired.
+    void finished();
+
+private:
+    // One server of a mirror list being measured.
+    struct Probe {
+        QString mirrorlist;             // Mirror list the server belongs to.
+        QString server;                 // Server as written in the mirror list, e.g. "https://host/$repo/os/$arch".
+        QNetworkReply *reply = nullptr; // Running request, null once finished.
+        QElapsedTimer timer;            // Started with the request.
+        qint64 firstByte = -1;          // Milliseconds until the first byte arrived.
+        qint64 bytes = 0;               // Bytes received.
+        double score = -1;              // Estimated milliseconds to fetch 1 MiB, negative if the server did not answer.
+    };
+
+    // Handles data or the end of a probe.
+    void probeRead(int index);
+    void probeFinished(int index);
+
+    // Ranks and writes the mirror lists once all probes are done.
+    void finish();
+
+    // Returns the cached ranking of a mirror list, if it is recent enough and lists the same servers.
+    QString cachedRanking(const QString &mirrorlist) const;
+
+    // Writes the servers of a mirror list in the given order to the cache, keeping its comments.
+    QString writeRanking(const QString &mirrorlist, const QStringList &servers) const;
+
+    // Records a ranked copy if it differs from the installed mirror list.
+    void addRanking(const QString &mirrorlist, const QString &file);
+
+    QString cachePath;              // Directory holding the ranked mirror lists.
+    int ttl;                        // How long a ranking is reused, in seconds.
+    QNetworkAccessManager *network; // Runs the probes.
+    QTimer *deadline;               // Global timeout.
+    QVector<Probe> probes;          // Servers being measured.
+    QStringList probed;             // Mirror lists being measured.
+    int pending = 0;                // Probes that did not finish yet.
+    QHash<QString, QString> ranked; // Ranked copies, by installed mirror list.
+
+    static constexpr int TIMEOUT = 6000;               // Time all probes together may take, in milliseconds.
+    static constexpr qint64 SAMPLE_SIZE = 256 * 1024;  // Bytes downloaded per server.
+};
+
+#endif // MIRRORRANKER_H // End of the include guard.
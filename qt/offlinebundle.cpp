@@ -0,0 +1,215 @@
+#include "offlinebundle.h" // Includes the header file for the OfflineBundle class.
+#include "dependencyresolver.h" // Closure of the packages to install.
+#include "pacmanconfig.h" // Repositories whose databases the bundle is taken from.
+
+#include <QDateTime> // Times of the manifest.
+#include <QDir> // Lists the sync databases.
+#include <QFileInfo> // Modification times of the sync databases.
+#include <QJsonDocument> // Encodes the manifest.
+#include <QJsonObject> // Fields of the manifest.
+#include <QSaveFile> // Replaces the manifest atomically.
+#include <QSet> // Entries to copy from every sync database.
+
+#include <archive.h> // libarchive, reads the sync databases and writes the bundle database.
+#include <archive_entry.h> // Entries of the databases.
+
+OfflineBundle OfflineBundle::open(const QString &directory, QString *error) {
+    OfflineBundle bundle;
+    QFile file(QDir(directory).filePath("bundle.json"));
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = file.errorString();
+        }
+        return bundle;
+    }
+
+    QJsonParseError parseError;
+    QJsonObject object = QJsonDocument::fromJson(file.readAll(), &parseError).object();
+    if (parseError.error != QJsonParseError::NoError || object.value("version").toInt() != VERSION) {
+        if (error) {
+            *error = parseError.error != QJsonParseError::NoError ? parseError.errorString() : QString("unsupported version");
+        }
+        return bundle;
+    }
+
+    bundle.path = QDir(directory).absolutePath();
+    bundle.created = qint64(object.value("created").toDouble());
+    QJsonObject databases = object.value("databases").toObject();
+    for (auto it = databases.constBegin(); it != databases.constEnd(); ++it) {
+        bundle.databases.insert(it.key(), qint64(it.value().toDouble()));
+    }
+    return bundle;
+}
+
+OfflineBundle OfflineBundle::create(const QString &directory, const QString &syncDirectory) {
+    OfflineBundle bundle;
+    QDir().mkpath(directory);
+    bundle.path = QDir(directory).absolutePath();
+    bundle.created = QDateTime::currentMSecsSinceEpoch();
+    bundle.databases = databaseTimes(syncDirectory);
+    return bundle;
+}
+
+QHash<QString, qint64> OfflineBundle::databaseTimes(const QString &syncDirectory) {
+    // Only the repositories of pacman.conf count, like in SyncDatabase::load().
+    QHash<QString, qint64> times;
+    QDir dir(syncDirectory);
+    for (const QString &repository : PacmanConfig::load().repositories()) {
+        QFileInfo info(dir.filePath(repository + ".db"));
+        if (info.exists()) {
+            times.insert(repository, info.lastModified().toMSecsSinceEpoch());
+        }
+    }
+    return times;
+}
+
+bool OfflineBundle::writeDatabase(const QVector<SyncDatabase::Package> &packages, const QString &syncDirectory, QString *error) const {
+    // The entries of a sync database are directories named "<name>-<version>", holding "desc" and, in older
+    // databases, "depends". Collect the directories to copy from every repository.
+    QHash<QString, QSet<QByteArray>> wanted;
+    for (const SyncDatabase::Package &package : packages) {
+        wanted[package.repository->repository()].insert(package.repository->name(package.index) + '-' + package.repository->version(package.index));
+    }
+
+    QString target = databaseFile() + ".part";
+    struct archive *output = archive_write_new();
+    archive_write_add_filter_gzip(output);
+    archive_write_set_format_pax_restricted(output);
+    if (archive_write_open_filename(output, QFile::encodeName(target).constData()) != ARCHIVE_OK) {
+        if (error) {
+            *error = QString::fromLocal8Bit(archive_error_string(output));
+        }
+        archive_write_free(output);
+        return false;
+    }
+
+    bool success = true;
+    int copied = 0;
+    for (auto it = wanted.constBegin(); it != wanted.constEnd() && success; ++it) {
+        QString source = QDir(syncDirectory).filePath(it.key() + ".db");
+        struct archive *input = archive_read_new();
+        archive_read_support_filter_all(input);
+        archive_read_support_format_all(input);
+        if (archive_read_open_filename(input, QFile::encodeName(source).constData(), 64 * 1024) != ARCHIVE_OK) {
+            if (error) {
+                *error = QString("%1: %2").arg(source, QString::fromLocal8Bit(archive_error_string(input)));
+            }
+            archive_read_free(input);
+            success = false;
+            break;
+        }
+
+        // Copy the wanted entries unchanged, skipping the data of the others.
+        struct archive_entry *entry;
+        while (archive_read_next_header(input, &entry) == ARCHIVE_OK) {
+            QByteArray name = archive_entry_pathname(entry);
+            if (!it.value().contains(name.left(name.indexOf('/')))) {
+                continue;
+            }
+            archive_write_header(output, entry);
+            const void *block;
+            size_t size;
+            la_int64_t offset;
+            while (archive_read_data_block(input, &block, &size, &offset) == ARCHIVE_OK) {
+                archive_write_data(output, block, size);
+            }
+            if (archive_entry_filetype(entry) == AE_IFREG) {
+                copied++;
+            }
+        }
+        archive_read_free(input);
+    }
+
+    if (archive_write_close(output) != ARCHIVE_OK && success) {
+        if (error) {
+            *error = QString::fromLocal8Bit(archive_error_string(output));
+        }
+        success = false;
+    }
+    archive_write_free(output);
+
+    if (success && copied == 0 && !packages.isEmpty()) {
+        if (error) {
+            *error = "the sync databases do not list the packages";
+        }
+        success = false;
+    }
+    if (!success) {
+        QFile::remove(target);
+        return false;
+    }
+
+    // Publish the database under its final name, so pacman never reads a partial one.
+    QFile::remove(databaseFile());
+    return QFile::rename(target, databaseFile());
+}
+
+bool OfflineBundle::save() const {
+    QJsonObject databases;
+    for (auto it = this->databases.constBegin(); it != this->databases.constEnd(); ++it) {
+        databases.insert(it.key(), it.value());
+    }
+    QJsonObject object = {
+        { "version", VERSION },
+        { "created", created },
+        { "databases", databases },
+    };
+    QSaveFile output(QDir(path).filePath("bundle.json"));
+    if (!output.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    output.write(QJsonDocument(object).toJson());
+    return output.commit();
+}
+
+OfflineBundle::Installation OfflineBundle::installation(const QStringList &packages, const SyncDatabase &sync, const LocalDatabase &local) const {
+    // The closure leaves out what is installed already, so pacman gets every file it needs and nothing from the mirrors.
+    DependencyResolver resolver(sync, local);
+    QSet<QByteArray> explicitly;
+    for (const QString &package : packages) {
+        resolver.add(package);
+        explicitly.insert(package.toUtf8());
+        for (const SyncDatabase::Package &member : sync.groupMembers(package.toUtf8())) {
+            explicitly.insert(member.repository->name(member.index));
+        }
+    }
+
+    // `pacman -U` installs every file as explicitly installed, so the dependencies are marked afterwards,
+    // as `pacman -S` would have recorded them.
+    Installation installation;
+    for (const SyncDatabase::Package &package : resolver.packages()) {
+        QByteArray name = package.repository->name(package.index);
+        QString file = QDir(path).filePath(QString::fromUtf8(package.repository->filename(package.index)));
+        installation.files += package.repository->sha256(package.index) + "  " + QFile::encodeName(file) + '\n';
+        if (!explicitly.contains(name)) {
+            installation.dependencies += name + '\n';
+        }
+    }
+    return installation;
+}
+
+bool OfflineBundle::isValid() const {
+    return !path.isEmpty();
+}
+
+bool OfflineBundle::isOlderThan(const QString &syncDirectory) const {
+    const QHash<QString, qint64> current = databaseTimes(syncDirectory);
+    for (auto it = databases.constBegin(); it != databases.constEnd(); ++it) {
+        if (current.value(it.key(), it.value()) > it.value()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QString OfflineBundle::directory() const {
+    return path;
+}
+
+QString OfflineBundle::profileFile() const {
+    return QDir(path).filePath("profile.json");
+}
+
+QString OfflineBundle::databaseFile() const {
+    return QDir(path).filePath(QString(REPOSITORY) + ".db");
+}
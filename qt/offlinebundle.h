@@ -0,0 +1,73 @@
+#ifndef OFFLINEBUNDLE_H // Start of include guard to prevent multiple inclusions of this header file.
+#define OFFLINEBUNDLE_H // Define the include guard macro.
+
+#include "localdatabase.h" // Installed packages, left out of an installation.
+#include "syncdatabase.h" // Packages put into the bundle.
+
+#include <QHash> // Modification times of the source databases.
+#include <QString> // Paths.
+
+// A local package repository holding everything a profile installs, so machines can be provisioned
+// from disk instead of the mirrors:
+//   snigdhaos-blackbox --export-bundle <directory> --profile <file>   writes or updates a bundle
+//   snigdhaos-blackbox --bundle <directory> [--yes]                    applies it without the internet
+//   SNIGDHAOS_BLACKBOX_BUNDLE=<directory> snigdhaos-blackbox           selects from it in the window
+//
+// The directory holds the package files of the whole dependency closure, the repository database
+// "snigdhaos-bundle.db", the profile and a manifest, "bundle.json". The database is a copy of the entries
+// of the sync databases the packages came from, checksums included. Snigdha OS Blackbox reads it to offer and
+// resolve the packages, and apply.sh installs the package files of the closure with `pacman -U` under the
+// system's own database and lock, after checking them against those checksums. pacman never registers the
+// bundle as a repository, so the system's sync databases stay untouched and the bundle may be read-only.
+class OfflineBundle
+{
+public:
+    static constexpr int VERSION = 1; // Version of the manifest.
+
+    // What installing packages from the bundle takes, in the files apply.sh reads.
+    struct Installation {
+        QByteArray files;        // "<sha256>  <path>" of every package file to install, the format of `sha256sum --check`.
+        QByteArray dependencies; // Names of the packages among them that are only installed as dependencies, one per line.
+    };
+
+    // Name of the repository in the pacman configuration and of its database.
+    static constexpr const char *REPOSITORY = "snigdhaos-bundle";
+
+    // Reads the manifest of a bundle. On failure, returns an invalid bundle and describes the problem in error.
+    static OfflineBundle open(const QString &directory, QString *error = nullptr);
+
+    // Creates the manifest of a new bundle in directory, recording the sync databases it is taken from.
+    static OfflineBundle create(const QString &directory, const QString &syncDirectory);
+
+    // Writes the repository database of the bundle from the entries of the packages in their sync databases.
+    // Returns false and describes the problem in error on failure.
+    bool writeDatabase(const QVector<SyncDatabase::Package> &packages, const QString &syncDirectory, QString *error = nullptr) const;
+
+    // Writes the manifest, replacing it atomically. Returns false on failure.
+    bool save() const;
+
+    // Resolves packages against the database of the bundle, read into sync, and the installed packages: the files
+    // of the packages and of their dependencies that are not installed yet. Groups stand for their members.
+    Installation installation(const QStringList &packages, const SyncDatabase &sync, const LocalDatabase &local) const;
+
+    // Whether the manifest could be read.
+    bool isValid() const;
+
+    // Whether one of the sync databases changed since the bundle was written, so its packages may be outdated.
+    bool isOlderThan(const QString &syncDirectory) const;
+
+    // Paths inside the bundle.
+    QString directory() const;
+    QString profileFile() const;
+    QString databaseFile() const;
+
+private:
+    // Modification times of the databases of the pacman.conf repositories in a sync directory in milliseconds, by repository.
+    static QHash<QString, qint64> databaseTimes(const QString &syncDirectory);
+
+    QString path;                     // Directory of the bundle.
+    qint64 created = -1;              // When the bundle was written, in milliseconds since the epoch.
+    QHash<QString, qint64> databases; // Modification times of the sync databases it was taken from, by repository.
+};
+
+#endif // OFFLINEBUNDLE_H // End of the include guard.
@@ -0,0 +1,327 @@
+#include "packageprefetcher.h" // Includes the header file for the PackagePrefetcher class.
+#include "pacmanconfig.h" // Servers of the repositories.
+
+#include <QCryptographicHash> // Verifies the checksums of the package files.
+#include <QDir> // Creates and empties the download directory.
+#include <QFile> // Writes the downloaded files.
+#include <QFileInfo> // Checks for files that are already present.
+
+#include <QtConcurrent/QtConcurrentRun> // Reads the files already on disk on the global thread pool.
+#include <QtNetwork/QNetworkAccessManager> // Runs the downloads.
+#include <QtNetwork/QNetworkReply> // Running downloads.
+
+#include <algorithm> // Looks for a verified file among the candidates.
+
+const char* PACMAN_CACHE_DIRECTORY = "/var/cache/pacman/pkg";  // System package cache, checked for files pacman already has.
+
+PackagePrefetcher::PackagePrefetcher(const QString &directory, QObject *parent)
+    : QObject(parent) // Initializes the base object with the given parent.
+    , path(directory) // Directory holding the downloaded files.
+    , network(new QNetworkAccessManager(this)) // Runs the downloads.
+{
+    QDir().mkpath(path);
+}
+
+PackagePrefetcher::~PackagePrefetcher() {
+    stop();
+}
+
+QString PackagePrefetcher::directory() const {
+    return path;
+}
+
+int PackagePrefetcher::packageCount() const {
+    return total;
+}
+
+int PackagePrefetcher::downloadedCount() const {
+    return present;
+}
+
+bool PackagePrefetcher::isIdle() const {
+    return downloads.isEmpty();
+}
+
+bool PackagePrefetcher::isComplete(const QString &file, qint64 size, const QByteArray &sha256) {
+    QFile input(file);
+    if (!input.exists() || input.size() != size) {
+        return false;
+    }
+    if (sha256.isEmpty()) {
+        return true;
+    }
+    if (!input.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(&input);
+    return hash.result().toHex() == sha256;
+}
+
+void PackagePrefetcher::setPackages(const QVector<SyncDatabase::Package> &packages) {
+    QHash<QString, Download> wanted;
+    QStringList added;
+    QHash<QString, QStringList> unverified;
+    total = 0;
+    present = 0;
+
+    for (const SyncDatabase::Package &package : packages) {
+        QString filename = QString::fromUtf8(package.repository->filename(package.index));
+        qint64 size = qint64(package.repository->downloadSize(package.index));
+        QByteArray sha256 = package.repository->sha256(package.index);
+        total++;
+
+        // Keep downloads that are still wanted, running or queued.
+        auto it = downloads.find(filename);
+        if (it != downloads.end()) {
+            wanted.insert(filename, it.value());
+            downloads.erase(it);
+            continue;
+        }
+
+        // Nothing to do for files pacman will find on disk anyway, once they were verified.
+        QStringList files = candidates(filename, size);
+        if (std::any_of(files.begin(), files.end(), [this](const QString &file) { return verified.contains(file); })) {
+            present++;
+            continue;
+        }
+
+        Download download;
+        download.filename = filename;
+        download.urls = mirrors(package.repository->repository(), filename);
+        download.size = size;
+        download.sha256 = sha256;
+        wanted.insert(filename, download);
+        if (files.isEmpty()) {
+            added += filename;
+        }
+        else {
+            unverified.insert(filename, files);
+        }
+    }
+
+    // Whatever is left was unchecked: abort it.
+    for (const QString &filename : downloads.keys()) {
+        abort(filename);
+    }
+    downloads = wanted;
+
+    // Drop unwanted files from the queue and append the new ones.
+    QStringList pending;
+    for (const QString &filename : queue) {
+        if (downloads.contains(filename)) {
+            pending += filename;
+        }
+    }
+    queue = pending + added;
+
+    // Files of the right size are only downloaded again if their checksum turns out wrong.
+    for (auto it = unverified.constBegin(); it != unverified.constEnd(); ++it) {
+        verify(it.key(), it.value());
+    }
+
+    startNext();
+    emit progressChanged();
+}
+
+void PackagePrefetcher::stop() {
+    queue.clear();
+    for (const QString &filename : downloads.keys()) {
+        abort(filename);
+    }
+}
+
+void PackagePrefetcher::clear() {
+    stop();
+    total = 0;
+    present = 0;
+    verified.clear();
+    QDir(path).removeRecursively();
+    QDir().mkpath(path);
+    emit progressChanged();
+}
+
+void PackagePrefetcher::startNext() {
+    while (running < MAX_RUNNING && !queue.isEmpty()) {
+        QString filename = queue.takeFirst();
+        if (downloads.contains(filename)) {
+            request(filename);
+        }
+    }
+}
+
+void PackagePrefetcher::request(const QString &filename) {
+    Download &download = downloads[filename];
+
+    // Leave the file to pacman if no mirror could provide it.
+    if (download.urls.isEmpty()) {
+        downloads.remove(filename);
+        emit progressChanged();
+        return;
+    }
+
+    // Write to a partial file, renamed once the download is complete.
+    QFile *file = new QFile(path + "/" + filename + ".part");
+    if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        delete file;
+        downloads.remove(filename);
+        emit progressChanged();
+        return;
+    }
+
+    // Yield to any other traffic, since nobody is waiting for this yet.
+    QNetworkRequest request(QUrl(download.urls.takeFirst()));
+    request.setPriority(QNetworkRequest::LowPriority);
+    request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+
+    QNetworkReply *reply = network->get(request);
+    QCryptographicHash *hash = new QCryptographicHash(QCryptographicHash::Sha256);
+    download.reply = reply;
+    download.file = file;
+    download.hash = hash;
+    running++;
+
+    // Stream the body to disk instead of buffering whole packages in memory, checksumming it on the way.
+    connect(reply, &QNetworkReply::readyRead, this, [reply, file, hash]() {
+        QByteArray data = reply->readAll();
+        file->write(data);
+        hash->addData(data);
+    });
+    connect(reply, &QNetworkReply::finished, this, [this, filename]() {
+        finished(filename);
+    });
+}
+
+void PackagePrefetcher::finished(const QString &filename) {
+    auto it = downloads.find(filename);
+    if (it == downloads.end()) {
+        return;
+    }
+
+    QNetworkReply *reply = it->reply;
+    QFile *file = it->file;
+    QCryptographicHash *hash = it->hash;
+    it->reply = nullptr;
+    it->file = nullptr;
+    it->hash = nullptr;
+    running--;
+
+    QByteArray data = reply->readAll();
+    file->write(data);
+    file->close();
+    hash->addData(data);
+
+    // A mirror may serve a truncated, outdated or tampered file of the right size, so the checksum decides.
+    bool complete = reply->error() == QNetworkReply::NoError && file->size() == it->size
+                    && (it->sha256.isEmpty() || hash->result().toHex() == it->sha256);
+    reply->deleteLater();
+    delete hash;
+
+    if (complete) {
+        // Publish the file under its final name, where pacman looks for it.
+        QString target = path + "/" + filename;
+        QFile::remove(target);
+        file->rename(target);
+        verified.insert(target);
+        downloads.erase(it);
+        present++;
+        emit progressChanged();
+    }
+    else {
+        // Try the next mirror.
+        file->remove();
+        request(filename);
+    }
+    delete file;
+
+    startNext();
+}
+
+void PackagePrefetcher::abort(const QString &filename) {
+    auto it = downloads.find(filename);
+    if (it == downloads.end()) {
+        return;
+    }
+
+    if (it->reply) {
+        // Aborting emits finished() right away, which must not be handled as a failed download.
+        it->reply->disconnect(this);
+        it->reply->abort();
+        it->reply->deleteLater();
+        running--;
+    }
+    if (it->file) {
+        it->file->remove();
+        delete it->file;
+    }
+    delete it->hash;
+    if (it->check) {
+        // The check keeps running on its worker, but its result is no longer wanted.
+        it->check->disconnect(this);
+        it->check->deleteLater();
+    }
+    downloads.erase(it);
+}
+
+QStringList PackagePrefetcher::candidates(const QString &filename, qint64 size) const {
+    QStringList files;
+    for (const QString &file : { path + "/" + filename, QString(PACMAN_CACHE_DIRECTORY) + "/" + filename }) {
+        QFileInfo info(file);
+        if (info.exists() && info.size() == size) {
+            files += file;
+        }
+    }
+    return files;
+}
+
+void PackagePrefetcher::verify(const QString &filename, const QStringList &files) {
+    Download &download = downloads[filename];
+    auto watcher = new QFutureWatcher<QString>(this);
+    download.check = watcher;
+
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, filename, watcher]() {
+        watcher->deleteLater();
+        auto it = downloads.find(filename);
+        if (it == downloads.end() || it->check != watcher) {
+            return;
+        }
+        it->check = nullptr;
+
+        if (!watcher->result().isEmpty()) {
+            verified.insert(watcher->result());
+            downloads.erase(it);
+            present++;
+            emit progressChanged();
+        }
+        else {
+            // None of them is usable: download the file, which replaces our own copy once it is verified.
+            queue += filename;
+            startNext();
+        }
+    });
+
+    // Reading whole packages takes a while, so the window does not wait for it.
+    qint64 size = download.size;
+    QByteArray sha256 = download.sha256;
+    watcher->setFuture(QtConcurrent::run([files, size, sha256]() {
+        for (const QString &file : files) {
+            if (isComplete(file, size, sha256)) {
+                return file;
+            }
+        }
+        return QString();
+    }));
+}
+
+QStringList PackagePrefetcher::mirrors(const QString &repository, const QString &filename) {
+    auto it = servers.find(repository);
+    if (it == servers.end()) {
+        it = servers.insert(repository, PacmanConfig::load().servers(repository));
+    }
+
+    QStringList urls;
+    for (const QString &server : it.value()) {
+        urls += server + "/" + filename;
+    }
+    return urls;
+}
@@ -0,0 +1,116 @@
+#ifndef PACKAGEPREFETCHER_H // Start of include guard to prevent multiple inclusions of this header file.
+#define PACKAGEPREFETCHER_H // Define the include guard macro.
+
+#include "syncdatabase.h" // Package file names, sizes and repositories.
+
+#include <QFutureWatcher> // Checks the files already on disk in the background.
+#include <QHash> // Tracks the running downloads.
+#include <QObject> // Base class providing signals and slots.
+#include <QSet> // Files whose checksum was verified.
+#include <QStringList> // Mirror lists and the download queue.
+
+class QCryptographicHash; // Forward declaration of the checksum computed while downloading.
+class QFile; // Forward declaration of the file a download is written to.
+class QNetworkAccessManager; // Forward declaration of the manager running the downloads.
+class QNetworkReply; // Forward declaration of a running download.
+
+// Downloads the package files of the current selection in the background while the user is still
+// choosing, so that installing them afterwards mostly reads from disk.
+//
+// Files are stored in a directory of their own, which apply.sh passes to pacman as an additional
+// cache directory. Downloads run at low network priority and only a few at a time; packages that are
+// no longer wanted are aborted. A file only appears under its final name once it is complete and has
+// the size and SHA-256 checksum recorded in the sync database, so pacman never sees a partial or corrupted
+// download. Files already on disk are only reused once their checksum was verified on a worker thread.
+class PackagePrefetcher : public QObject
+{
+    Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
+
+public:
+    // Constructor for the PackagePrefetcher class.
+    // Parameters:
+    // - directory: Where the downloaded package files are stored.
+    // - parent: Pointer to the parent object that owns the prefetcher.
+    explicit PackagePrefetcher(const QString &directory, QObject *parent = nullptr);
+
+    // Aborts the running downloads.
+    ~PackagePrefetcher();
+
+    // Directory holding the downloaded package files.
+    QString directory() const;
+
+    // Replaces the packages to download. Packages already present are skipped, new ones are queued,
+    // and downloads of packages that are no longer listed are aborted.
+    void setPackages(const QVector<SyncDatabase::Package> &packages);
+
+    // Aborts every download and forgets the queue.
+    void stop();
+
+    // Deletes the downloaded files, e.g. after they were installed.
+    void clear();
+
+    // Number of wanted package files.
+    int packageCount() const;
+
+    // Number of wanted package files that are already on disk.
+    int downloadedCount() const;
+
+    // Whether no download is queued or running, because every wanted file is on disk or no mirror had it.
+    bool isIdle() const;
+
+    // Whether a package file has the expected size and checksum. Without a checksum, e.g. from a database
+    // that does not record one, the size is all that is checked. Reads the whole file, so it may be slow.
+    static bool isComplete(const QString &file, qint64 size, const QByteArray &sha256);
+
+signals:
+    // Emitted when the wanted packages changed or a download completed or gave up.
+    void progressChanged();
+
+private:
+    // A package file to download.
+    struct Download {
+        QString filename;                         // File name on the mirrors.
+        QStringList urls;                         // Remaining mirror URLs, tried in order.
+        qint64 size = 0;                          // Expected size in bytes.
+        QByteArray sha256;                        // Expected checksum as lowercase hex, empty if unknown.
+        QNetworkReply *reply = nullptr;           // Running request, null while queued.
+        QFile *file = nullptr;                    // Partial file being written.
+        QCryptographicHash *hash = nullptr;       // Checksum of what was written so far.
+        QFutureWatcher<QString> *check = nullptr; // Running check of the files already on disk, null otherwise.
+    };
+
+    // Starts queued downloads up to the concurrency limit.
+    void startNext();
+
+    // Starts the next mirror of a download, or gives up when none is left.
+    void request(const QString &filename);
+
+    // Handles the end of a request.
+    void finished(const QString &filename);
+
+    // Aborts a download and removes its partial file.
+    void abort(const QString &filename);
+
+    // Returns the files of the expected size under the name, in our directory or in the system package cache.
+    QStringList candidates(const QString &filename, qint64 size) const;
+
+    // Verifies the candidates of a download in the background. The download is queued if none of them is complete.
+    void verify(const QString &filename, const QStringList &files);
+
+    // Returns the download URLs of a file, one per server configured for the repository in pacman.conf.
+    QStringList mirrors(const QString &repository, const QString &filename);
+
+    QString path;                        // Directory holding the downloaded files.
+    QNetworkAccessManager *network;      // Runs the downloads.
+    QHash<QString, Download> downloads;  // Wanted files that are not present yet, by file name.
+    QHash<QString, QStringList> servers; // Servers of every repository, read on first use.
+    QStringList queue;                   // Wanted files that were not started yet, in order.
+    QSet<QString> verified;              // Files whose checksum matched, so they are not read again.
+    int running = 0;                     // Number of requests in flight.
+    int total = 0;                       // Number of wanted files.
+    int present = 0;                     // Number of wanted files that are present.
+
+    static constexpr int MAX_RUNNING = 2; // Downloads running at the same time.
+};
+
+#endif // PACKAGEPREFETCHER_H // End of the include guard.
@@ -0,0 +1,126 @@
+#include "pacmanconfig.h" // Includes the header file for the PacmanConfig class.
+
+#include <QFile> // Used to read pacman.conf and the mirror lists.
+#include <QSysInfo> // Architecture substituted into the server URLs.
+#include <QTextStream> // Reads the files line by line.
+
+namespace {
+
+// Splits a "Key = Value" line.
+void splitLine(const QString &line, QString &key, QString &value) {
+    key = line.section('=', 0, 0).trimmed();
+    value = line.section('=', 1).trimmed();
+}
+
+}
+
+PacmanConfig PacmanConfig::load(const QString &filename) {
+    PacmanConfig config;
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return config;
+    }
+
+    // Every "[section]" except "[options]" is a repository.
+    QTextStream in(&file);
+    Repository *current = nullptr;
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        if (line.startsWith('[') && line.endsWith(']')) {
+            current = nullptr;
+            if (line != "[options]") {
+                config.repos.append({ line.mid(1, line.size() - 2), QStringList(), QStringList() });
+                current = &config.repos.last();
+            }
+            continue;
+        }
+        if (!current) {
+            continue;
+        }
+
+        QString key, value;
+        splitLine(line, key, value);
+        if (key == "Server") {
+            current->servers += value;
+        }
+        else if (key == "Include") {
+            current->includes += value;
+        }
+    }
+    return config;
+}
+
+QStringList PacmanConfig::readMirrorlist(const QString &filename) {
+    QStringList servers;
+
+    QFile file(filename);
+    if (file.open(QIODevice::ReadOnly)) {
+        QTextStream in(&file);
+        while (!in.atEnd()) {
+            QString line = in.readLine().trimmed();
+            if (line.startsWith('#')) {
+                continue;
+            }
+            QString key, value;
+            splitLine(line, key, value);
+            if (key == "Server") {
+                servers += value;
+            }
+        }
+    }
+    return servers;
+}
+
+QString PacmanConfig::expand(QString server, const QString &repository) {
+    return server.replace("$repo", repository).replace("$arch", QSysInfo::currentCpuArchitecture());
+}
+
+QStringList PacmanConfig::repositories() const {
+    QStringList names;
+    for (const Repository &repository : repos) {
+        names += repository.name;
+    }
+    return names;
+}
+
+QStringList PacmanConfig::mirrorlists() const {
+    QStringList files;
+    for (const Repository &repository : repos) {
+        files += repository.includes;
+    }
+    files.removeDuplicates();
+    return files;
+}
+
+QString PacmanConfig::includingRepository(const QString &mirrorlist) const {
+    for (const Repository &repository : repos) {
+        if (repository.includes.contains(mirrorlist)) {
+            return repository.name;
+        }
+    }
+    return QString();
+}
+
+QStringList PacmanConfig::servers(const QString &repository) const {
+    QStringList result;
+    for (const Repository &entry : repos) {
+        if (entry.name != repository) {
+            continue;
+        }
+
+        // Servers listed in the section come first, then the included mirror lists; sections rarely mix both.
+        for (const QString &server : entry.servers) {
+            result += expand(server, repository);
+        }
+        for (const QString &include : entry.includes) {
+            for (const QString &server : readMirrorlist(include)) {
+                result += expand(server, repository);
+            }
+        }
+    }
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef PACMANCONFIG_H // Start of include guard to prevent multiple inclusions of this header file.
+#define PACMANCONFIG_H // Define the include guard macro.
+
+#include <QStringList> // Repository names, servers and mirror list files.
+#include <QVector> // Holds the repositories in configuration order.
+
+// The repositories configured in pacman.conf, with their servers and the mirror lists they include
+// (e.g. "Include = /etc/pacman.d/mirrorlist").
+class PacmanConfig
+{
+public:
+    // A "[section]" of pacman.conf other than "[options]".
+    struct Repository {
+        QString name;         // Repository name, e.g. "core".
+        QStringList servers;  // "Server = ..." lines of the section, unexpanded.
+        QStringList includes; // Files of the "Include = ..." lines of the section.
+    };
+
+    // Reads a pacman.conf file. A missing file has no repositories.
+    static PacmanConfig load(const QString &filename = "/etc/pacman.conf");
+
+    // Reads the "Server = ..." lines of a mirror list, unexpanded.
+    static QStringList readMirrorlist(const QString &filename);
+
+    // Replaces "$repo" and "$arch" in a server URL.
+    static QString expand(QString server, const QString &repository);
+
+    // Names of the repositories, in the order pacman searches them.
+    QStringList repositories() const;
+
+    // Mirror list files included by the repositories, without duplicates.
+    QStringList mirrorlists() const;
+
+    // Returns the first repository including the given mirror list, or an empty string.
+    QString includingRepository(const QString &mirrorlist) const;
+
+    // Expanded server URLs of a repository, in the order pacman tries them.
+    QStringList servers(const QString &repository) const;
+
+private:
+    QVector<Repository> repos; // Repositories, in pacman.conf order.
+};
+
+#endif // PACMANCONFIG_H // End of the include guard.
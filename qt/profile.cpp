@@ -0,0 +1,132 @@
+#include "profile.h" // Includes the header file for the Profile class.
+
+#include <QFile> // Reads the profile.
+#include <QJsonDocument> // Parses and writes the profile.
+#include <QJsonObject> // Fields of the profile.
+#include <QSaveFile> // Replaces the profile atomically.
+
+#include <algorithm> // Looks for steps that were already added and drops installed packages.
+
+Profile Profile::load(const QString &file, QString *error) {
+    QFile input(file);
+    if (!input.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = input.errorString();
+        }
+        return Profile();
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(input.readAll(), &parseError);
+    if (!document.isObject()) {
+        if (error) {
+            *error = parseError.error != QJsonParseError::NoError ? parseError.errorString() : "not a profile";
+        }
+        return Profile();
+    }
+    QJsonObject object = document.object();
+    if (object.value("version").toInt() != VERSION) {
+        if (error) {
+            *error = QString("unsupported profile version %1").arg(object.value("version").toInt());
+        }
+        return Profile();
+    }
+
+    Profile profile;
+    for (const QJsonValue &name : object.value("packages").toArray()) {
+        profile.packageList += name.toString();
+    }
+    for (const QJsonValue &name : object.value("prepared").toArray()) {
+        profile.prepared += name.toString();
+    }
+    profile.prepare = CommandGraph::fromJson(object.value("prepare").toArray());
+    profile.setup = CommandGraph::fromJson(object.value("setup").toArray());
+    return profile;
+}
+
+bool Profile::save(const QString &file) const {
+    // The entries and the selection may name the same packages; resolve() has not necessarily run yet.
+    QStringList packages = packageList;
+    packages.removeDuplicates();
+    QJsonObject object = {
+        { "version", VERSION },
+        { "packages", QJsonArray::fromStringList(packages) },
+        { "prepare", CommandGraph::toJson(prepare) },
+        { "setup", CommandGraph::toJson(setup) },
+        { "prepared", QJsonArray::fromStringList(prepared) },
+    };
+    QSaveFile output(file);
+    if (!output.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    output.write(QJsonDocument(object).toJson());
+    return output.commit();
+}
+
+void Profile::addEntry(const QString &name, const QStringList &packages, const QStringList &prepareCommands,
+                       const QStringList &setupCommands, const QStringList &after) {
+    packageList += packages;
+    if (!prepareCommands.isEmpty()) {
+        prepared += packages;
+    }
+    addSteps(prepare, name, prepareCommands, after);
+    addSteps(setup, name, setupCommands, after);
+}
+
+void Profile::addPackages(const QStringList &packages) {
+    packageList += packages;
+}
+
+void Profile::resolve(const SyncDatabase &sync, const LocalDatabase &local) {
+    // Drop packages that do not exist in the enabled repositories, so apply.sh can install the list as is.
+    // The packages of entries with prepare commands stay: their repository may only exist once the commands ran.
+    if (!sync.isEmpty()) {
+        packageList.erase(std::remove_if(packageList.begin(), packageList.end(), [this, &sync](const QString &package) {
+            return !sync.contains(package) && !prepared.contains(package);
+        }), packageList.end());
+    }
+    packageList.removeDuplicates();
+
+    // Enable the sockets of the container engines, independent of the other steps.
+    for (const QString &engine : { QString("podman"), QString("docker") }) {
+        QString socket = engine + ".socket";
+        bool added = std::any_of(setup.begin(), setup.end(), [&socket](const CommandGraph::Step &step) {
+            return step.id == socket;
+        });
+        if (packageList.contains(engine) && !added) {
+            addSteps(setup, socket, { "systemctl enable --now " + socket }, QStringList());
+        }
+    }
+
+    // Leave out what is already installed, so a second run or a retry only installs what is new.
+    packageList.erase(std::remove_if(packageList.begin(), packageList.end(), [&sync, &local](const QString &package) {
+        return local.isFullyInstalled(package.toUtf8(), sync);
+    }), packageList.end());
+}
+
+bool Profile::isEmpty() const {
+    return packageList.isEmpty() && prepare.isEmpty() && setup.isEmpty();
+}
+
+QStringList Profile::packages() const {
+    return packageList;
+}
+
+QStringList Profile::preparedPackages() const {
+    return prepared;
+}
+
+QVector<CommandGraph::Step> Profile::prepareSteps() const {
+    return prepare;
+}
+
+QVector<CommandGraph::Step> Profile::setupSteps() const {
+    return setup;
+}
+
+void Profile::addSteps(QVector<CommandGraph::Step> &steps, const QString &entry, const QStringList &commands, const QStringList &after) {
+    for (int i = 0; i < commands.size(); i++) {
+        QString id = commands.size() > 1 ? QString("%1#%2").arg(entry).arg(i + 1) : entry;
+        steps.append({ id, entry, commands[i], i == 0 ? after : QStringList { steps.last().id } });
+    }
+}
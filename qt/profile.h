@@ -0,0 +1,62 @@
+#ifndef PROFILE_H // Start of include guard to prevent multiple inclusions of this header file.
+#define PROFILE_H // Define the include guard macro.
+
+#include "commandgraph.h" // Steps run before and after installing.
+#include "localdatabase.h" // Used to drop packages that are already installed.
+#include "syncdatabase.h" // Used to drop packages that cannot be installed.
+
+#include <QStringList> // Selected packages.
+#include <QVector> // Holds the steps.
+
+// A selection of packages and commands, as the select widget collects it and as apply.sh installs it.
+// A profile can be exported from the select widget and applied on other machines without a window
+// ("snigdhaos-blackbox --profile <file> --yes"). On disk it is JSON:
+//   {"version":1,"packages":["nmap"],"prepare":[<steps>],"setup":[<steps>],"prepared":["blackarch-keyring"]}
+// with the steps in the form of CommandGraph::toJson(). "prepared" lists the packages of entries with prepare
+// commands, which may come from a repository those commands add, e.g. BlackArch's strap.sh.
+class Profile
+{
+public:
+    static constexpr int VERSION = 1;
+
+    // Reads a profile. On failure, returns an empty profile and describes the problem in error.
+    static Profile load(const QString &file, QString *error = nullptr);
+
+    // Writes the profile, replacing the file atomically. Returns false on failure.
+    bool save(const QString &file) const;
+
+    // Adds a selected entry. The commands of one entry run in order, after the entries named in after,
+    // while the commands of different entries run at the same time. If the entry has prepare commands,
+    // its packages are kept by resolve() even if the sync databases do not know them yet.
+    void addEntry(const QString &name, const QStringList &packages, const QStringList &prepareCommands,
+                  const QStringList &setupCommands, const QStringList &after = QStringList());
+
+    // Adds selected packages that come without commands, such as catalog entries.
+    void addPackages(const QStringList &packages);
+
+    // Prepares the profile for this machine: drops the packages the sync databases do not have (unless
+    // nothing is known about them, or the prepare steps may add their repository) and the ones already
+    // installed, removes duplicates and adds the services the packages need enabled, installed or not.
+    // apply.sh checks the prepared packages again once the prepare steps ran.
+    void resolve(const SyncDatabase &sync, const LocalDatabase &local = LocalDatabase());
+
+    // Whether nothing is selected.
+    bool isEmpty() const;
+
+    // Accessors for the selection.
+    QStringList packages() const;
+    QStringList preparedPackages() const;
+    QVector<CommandGraph::Step> prepareSteps() const;
+    QVector<CommandGraph::Step> setupSteps() const;
+
+private:
+    // Appends commands to the steps of one stage.
+    static void addSteps(QVector<CommandGraph::Step> &steps, const QString &entry, const QStringList &commands, const QStringList &after);
+
+    QStringList packageList;                // Selected packages.
+    QStringList prepared;                   // Packages of entries with prepare commands.
+    QVector<CommandGraph::Step> prepare;    // Steps run before installing.
+    QVector<CommandGraph::Step> setup;      // Steps run after installing.
+};
+
+#endif // PROFILE_H // End of the include guard.
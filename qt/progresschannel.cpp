@@ -0,0 +1,130 @@
+#include "progresschannel.h" // Includes the header file for the ProgressChannel class.
+
+#include <QDateTime> // Timestamps of the log.
+#include <QDir> // Creates the log directory.
+#include <QFile> // Writes the log.
+#include <QFileInfo> // Used to find the log directory.
+#include <QJsonDocument> // Parses and writes the messages.
+#include <QSocketNotifier> // Watches the pipe.
+
+#include <cerrno> // Checks for interrupted reads.
+#include <fcntl.h> // Opens the pipe without blocking.
+#include <sys/stat.h> // Creates the pipe.
+#include <unistd.h> // Reads and closes the pipe.
+
+ProgressChannel::ProgressChannel(const QString &logFile, QObject *parent)
+    : QObject(parent) // Initializes the base object with the given parent.
+    , logPath(logFile) // Log of the current run.
+{
+    if (!directory.isValid()) {
+        return;
+    }
+    QByteArray pipe = QFile::encodeName(path());
+    if (mkfifo(pipe.constData(), 0600) != 0) {
+        return;
+    }
+
+    // Opening both ends keeps the pipe from ever reporting end of file when a script closes it,
+    // and lets the scripts open it for writing without waiting for a reader.
+    fd = open(pipe.constData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier, &QSocketNotifier::activated, this, &ProgressChannel::readAvailable);
+}
+
+ProgressChannel::~ProgressChannel() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool ProgressChannel::isValid() const {
+    return fd >= 0;
+}
+
+QString ProgressChannel::path() const {
+    return directory.filePath("progress");
+}
+
+int ProgressChannel::status() const {
+    return result;
+}
+
+void ProgressChannel::drain() {
+    if (fd >= 0) {
+        readAvailable();
+    }
+}
+
+void ProgressChannel::reset() {
+    result = -1;
+    buffer.clear();
+    previous.clear();
+    started.clear();
+
+    QDir().mkpath(QFileInfo(logPath).absolutePath());
+    QFile log(logPath);
+    log.open(QIODevice::WriteOnly | QIODevice::Truncate);
+}
+
+void ProgressChannel::readAvailable() {
+    char chunk[4096];
+    for (;;) {
+        ssize_t count = read(fd, chunk, sizeof(chunk));
+        if (count > 0) {
+            buffer.append(chunk, int(count));
+        }
+        else if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        else {
+            break; // EAGAIN: everything was read.
+        }
+    }
+
+    int newline;
+    while ((newline = buffer.indexOf('\n')) >= 0) {
+        QByteArray line = buffer.left(newline);
+        buffer.remove(0, newline + 1);
+        handleLine(line);
+    }
+}
+
+void ProgressChannel::handleLine(const QByteArray &line) {
+    QJsonObject object = QJsonDocument::fromJson(line).object();
+    if (object.isEmpty()) {
+        return;
+    }
+
+    QString stage = object.value("stage").toString();
+    QString event = object.value("event").toString();
+    qint64 elapsed = qint64(object.value("elapsed").toDouble());
+
+    // Attach how long the step took.
+    if (event == "start") {
+        started.insert(stage, elapsed);
+    }
+    else if (event == "end") {
+        object.insert("duration", double(elapsed - started.value(stage, elapsed)));
+    }
+    else {
+        object.insert("duration", double(elapsed - previous.value(stage, started.value(stage, elapsed))));
+    }
+    previous.insert(stage, elapsed);
+
+    if (stage == "done") {
+        result = object.value("status").toInt();
+    }
+
+    // Record the message with the time it arrived.
+    QJsonObject record = object;
+    record.insert("time", QDateTime::currentDateTime().toString(Qt::ISODateWithMs));
+    QFile log(logPath);
+    if (log.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        log.write(QJsonDocument(record).toJson(QJsonDocument::Compact) + "\n");
+    }
+
+    emit message(object);
+}
@@ -0,0 +1,70 @@
+#ifndef PROGRESSCHANNEL_H // Start of include guard to prevent multiple inclusions of this header file.
+#define PROGRESSCHANNEL_H // Define the include guard macro.
+
+#include <QHash> // Time of the previous message of every stage.
+#include <QJsonObject> // Decoded progress messages.
+#include <QObject> // Base class providing signals and slots.
+#include <QTemporaryDir> // Holds the named pipe.
+
+class QSocketNotifier; // Forward declaration of the notifier watching the pipe.
+
+// Receives progress messages from apply.sh and update.sh over a named pipe, whose path the scripts get
+// in SNIGDHAOS_BLACKBOX_PROGRESS. Every message is one line of JSON, e.g.
+//   {"stage":"install","event":"package","package":"nmap","bytes":0,"rate":0,"elapsed":5120,"status":0}
+// (see usr/lib/snigdhaos-blackbox/progress.sh for the fields). The pipe is read as data arrives, without
+// blocking the event loop. Every message gets a "duration" in milliseconds: for a package, the time since
+// the previous message of its stage, and for the end of a stage, the time since its start. The messages
+// of the current run are also recorded to a log file, so slow steps can be looked at afterwards.
+class ProgressChannel : public QObject
+{
+    Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
+
+public:
+    // Constructor for the ProgressChannel class.
+    // Parameters:
+    // - logFile: Where the messages of the current run are recorded.
+    // - parent: Pointer to the parent object that owns the channel.
+    explicit ProgressChannel(const QString &logFile, QObject *parent = nullptr);
+
+    // Closes the pipe.
+    ~ProgressChannel();
+
+    // Whether the pipe could be created.
+    bool isValid() const;
+
+    // Path of the pipe, to be passed to the scripts in SNIGDHAOS_BLACKBOX_PROGRESS.
+    QString path() const;
+
+    // Exit status reported by the final "done" message of the current run, or -1 if there was none yet.
+    // Only covers what was read so far; call drain() first when the script has just exited.
+    int status() const;
+
+    // Reads and handles whatever is still in the pipe. QProcess::finished may be delivered before the
+    // notifier reports the last lines, so the outcome of a script is only decided after this.
+    void drain();
+
+    // Starts a new run: forgets the status and truncates the log.
+    void reset();
+
+signals:
+    // Emitted for every message received.
+    void message(const QJsonObject &message);
+
+private:
+    // Reads whatever the scripts wrote and handles the complete lines.
+    void readAvailable();
+
+    // Handles one line.
+    void handleLine(const QByteArray &line);
+
+    QTemporaryDir directory;          // Private directory holding the pipe.
+    int fd = -1;                      // Read end of the pipe.
+    QSocketNotifier *notifier = nullptr; // Reports data on the pipe.
+    QByteArray buffer;                // Data after the last complete line.
+    QString logPath;                  // Log of the current run.
+    int result = -1;                  // Status of the "done" message.
+    QHash<QString, qint64> previous;  // Elapsed time of the previous message of every stage.
+    QHash<QString, qint64> started;   // Elapsed time of the start of every stage.
+};
+
+#endif // PROGRESSCHANNEL_H // End of the include guard.
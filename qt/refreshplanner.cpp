@@ -0,0 +1,272 @@
+#include "refreshplanner.h" // Includes the header file for the RefreshPlanner class.
+#include "pacmanconfig.h" // Repositories and their servers.
+
+#include <QFileInfo> // Modification time and size of the local databases.
+#include <QTimer> // Timeout of the probes.
+#include <QUrl> // Probe URLs.
+#include <QtNetwork/QNetworkAccessManager> // Sends the probes.
+#include <QtNetwork/QNetworkReply> // Running probes.
+
+#include <cctype> // Character classes used by the version comparison.
+#include <cstring> // String functions used by the version comparison.
+
+namespace {
+
+// Compares two version segments the way pacman (and rpm) do: alternating runs of digits and letters,
+// numbers compared numerically, letters alphabetically, and a number newer than letters.
+int rpmvercmp(const QByteArray &a, const QByteArray &b) {
+    if (a == b) {
+        return 0;
+    }
+
+    // Work on copies, since runs are terminated in place.
+    QByteArray first = a, second = b;
+    char *one = first.data(), *two = second.data();
+    char *ptr1 = one, *ptr2 = two;
+
+    while (*one && *two) {
+        // Skip separators.
+        while (*one && !isalnum(uchar(*one))) {
+            one++;
+        }
+        while (*two && !isalnum(uchar(*two))) {
+            two++;
+        }
+        if (!(*one && *two)) {
+            break;
+        }
+
+        // Different separator lengths decide on their own.
+        if ((one - ptr1) != (two - ptr2)) {
+            return (one - ptr1) < (two - ptr2) ? -1 : 1;
+        }
+        ptr1 = one;
+        ptr2 = two;
+
+        // Take the next run of digits or letters of both strings.
+        bool isnum = isdigit(uchar(*ptr1));
+        if (isnum) {
+            while (*ptr1 && isdigit(uchar(*ptr1))) {
+                ptr1++;
+            }
+            while (*ptr2 && isdigit(uchar(*ptr2))) {
+                ptr2++;
+            }
+        }
+        else {
+            while (*ptr1 && isalpha(uchar(*ptr1))) {
+                ptr1++;
+            }
+            while (*ptr2 && isalpha(uchar(*ptr2))) {
+                ptr2++;
+            }
+        }
+        char oldch1 = *ptr1;
+        char oldch2 = *ptr2;
+        *ptr1 = '\0';
+        *ptr2 = '\0';
+
+        // The runs are of different types: a number is newer.
+        if (two == ptr2) {
+            return isnum ? 1 : -1;
+        }
+
+        // Numbers: ignore leading zeros, then the longer one is larger.
+        if (isnum) {
+            while (*one == '0') {
+                one++;
+            }
+            while (*two == '0') {
+                two++;
+            }
+            size_t length1 = strlen(one), length2 = strlen(two);
+            if (length1 != length2) {
+                return length1 > length2 ? 1 : -1;
+            }
+        }
+
+        int rc = strcmp(one, two);
+        if (rc) {
+            return rc < 1 ? -1 : 1;
+        }
+
+        *ptr1 = oldch1;
+        one = ptr1;
+        *ptr2 = oldch2;
+        two = ptr2;
+    }
+
+    // Whatever has runs left over is newer, unless that is a letter run ("1.0" is newer than "1.0alpha").
+    if (!*one && !*two) {
+        return 0;
+    }
+    return (!*one && !isalpha(uchar(*two))) || isalpha(uchar(*one)) ? -1 : 1;
+}
+
+// Splits "epoch:version-release". The epoch defaults to "0"; the release may be missing.
+void parseVersion(const QByteArray &value, QByteArray &epoch, QByteArray &version, QByteArray &release) {
+    int digits = 0;
+    while (digits < value.size() && isdigit(uchar(value.at(digits)))) {
+        digits++;
+    }
+    QByteArray rest = value;
+    epoch = "0";
+    if (digits < value.size() && value.at(digits) == ':') {
+        if (digits > 0) {
+            epoch = value.left(digits);
+        }
+        rest = value.mid(digits + 1);
+    }
+
+    int dash = rest.lastIndexOf('-');
+    version = dash < 0 ? rest : rest.left(dash);
+    release = dash < 0 ? QByteArray() : rest.mid(dash + 1);
+}
+
+}
+
+RefreshPlanner::RefreshPlanner(const QString &syncDirectory, QObject *parent)
+    : QObject(parent) // Initializes the base object with the given parent.
+    , directory(syncDirectory) // Directory of the local sync databases.
+    , network(new QNetworkAccessManager(this)) // Sends the probes.
+    , timeout(new QTimer(this)) // Gives up on the probes.
+{
+    timeout->setSingleShot(true);
+    timeout->setInterval(TIMEOUT);
+    connect(timeout, &QTimer::timeout, this, &RefreshPlanner::finish);
+}
+
+RefreshPlanner::~RefreshPlanner() {
+    for (QNetworkReply *reply : probes.keys()) {
+        reply->disconnect(this);
+        reply->abort();
+    }
+}
+
+void RefreshPlanner::start() {
+    // Already running.
+    if (!probes.isEmpty()) {
+        return;
+    }
+    stale.clear();
+
+    PacmanConfig config = PacmanConfig::load();
+    for (const QString &repository : config.repositories()) {
+        QStringList servers = config.servers(repository);
+        if (servers.isEmpty()) {
+            continue;
+        }
+        QUrl url(servers.first() + "/" + repository + ".db");
+
+        // Local servers are compared directly.
+        if (url.isLocalFile()) {
+            QFileInfo remote(url.toLocalFile());
+            if (!isCurrent(repository, remote.lastModified(), remote.size())) {
+                stale += repository;
+            }
+            continue;
+        }
+
+        // Remote servers report the time and size of the database in response to a HEAD request.
+        QNetworkRequest request(url);
+        request.setAttribute(QNetworkRequest::RedirectPolicyAttribute, QNetworkRequest::NoLessSafeRedirectPolicy);
+        QNetworkReply *reply = network->head(request);
+        probes.insert(reply, repository);
+        connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+            probeFinished(reply);
+        });
+    }
+
+    if (!probes.isEmpty()) {
+        timeout->start();
+    }
+    else {
+        // Keep the signal asynchronous, like when probing.
+        QTimer::singleShot(0, this, &RefreshPlanner::finish);
+    }
+}
+
+void RefreshPlanner::probeFinished(QNetworkReply *reply) {
+    QString repository = probes.take(reply);
+    reply->deleteLater();
+
+    // A repository that cannot be checked is refreshed, to be safe.
+    QDateTime modified = reply->header(QNetworkRequest::LastModifiedHeader).toDateTime();
+    qint64 size = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong();
+    if (reply->error() != QNetworkReply::NoError || !modified.isValid() || !isCurrent(repository, modified, size)) {
+        stale += repository;
+    }
+
+    if (probes.isEmpty()) {
+        finish();
+    }
+}
+
+void RefreshPlanner::finish() {
+    timeout->stop();
+
+    // Repositories that did not answer in time are refreshed.
+    for (auto it = probes.constBegin(); it != probes.constEnd(); ++it) {
+        it.key()->disconnect(this);
+        it.key()->abort();
+        it.key()->deleteLater();
+        stale += it.value();
+    }
+    probes.clear();
+
+    emit finished();
+}
+
+bool RefreshPlanner::isCurrent(const QString &repository, const QDateTime &modified, qint64 size) const {
+    // pacman sets the modification time of a downloaded database to the one reported by the server.
+    // An older copy on the mirror does not make the local one stale.
+    QFileInfo local(directory + "/" + repository + ".db");
+    if (!local.exists() || !modified.isValid()) {
+        return false;
+    }
+    qint64 localTime = local.lastModified().toSecsSinceEpoch();
+    qint64 remoteTime = modified.toSecsSinceEpoch();
+    return remoteTime < localTime || (remoteTime == localTime && (size <= 0 || size == local.size()));
+}
+
+QStringList RefreshPlanner::staleRepositories() const {
+    return stale;
+}
+
+RefreshPlanner::Plan RefreshPlanner::plan(const SyncDatabase &sync, const LocalDatabase &local) const {
+    if (!stale.isEmpty() || sync.isEmpty() || local.isEmpty()) {
+        return Plan::REFRESH_AND_UPGRADE;
+    }
+    return hasPendingUpgrades(sync, local) ? Plan::UPGRADE : Plan::UP_TO_DATE;
+}
+
+bool RefreshPlanner::hasPendingUpgrades(const SyncDatabase &sync, const LocalDatabase &local) {
+    // Packages that are not in any repository (e.g. built locally) are never upgraded by pacman -Su.
+    for (const QByteArray &name : local.packages()) {
+        SyncDatabase::Package package = sync.find(name);
+        if (package.isValid() && compareVersions(package.repository->version(package.index), local.version(name)) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int RefreshPlanner::compareVersions(const QByteArray &a, const QByteArray &b) {
+    if (a == b) {
+        return 0;
+    }
+
+    QByteArray epoch1, version1, release1, epoch2, version2, release2;
+    parseVersion(a, epoch1, version1, release1);
+    parseVersion(b, epoch2, version2, release2);
+
+    // The epoch decides first, then the version, then the release if both have one.
+    int result = rpmvercmp(epoch1, epoch2);
+    if (result == 0) {
+        result = rpmvercmp(version1, version2);
+        if (result == 0 && !release1.isEmpty() && !release2.isEmpty()) {
+            result = rpmvercmp(release1, release2);
+        }
+    }
+    return result;
+}
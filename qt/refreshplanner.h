@@ -0,0 +1,82 @@
+#ifndef REFRESHPLANNER_H // Start of include guard to prevent multiple inclusions of this header file.
+#define REFRESHPLANNER_H // Define the include guard macro.
+
+#include "localdatabase.h" // Installed package versions.
+#include "syncdatabase.h" // Available package versions.
+
+#include <QDateTime> // Modification times of the databases.
+#include <QHash> // Maps the probes to their repositories.
+#include <QObject> // Base class providing signals and slots.
+#include <QStringList> // Names of the stale repositories.
+
+class QNetworkAccessManager; // Forward declaration of the manager sending the probes.
+class QNetworkReply; // Forward declaration of a running probe.
+class QTimer; // Forward declaration of the timeout.
+
+// Decides how much of the system update is needed, instead of always force-refreshing every database.
+//
+// The local copy of each sync database is compared with the one on the first server of its repository:
+// a HEAD request returns its Last-Modified time and size, which pacman also stores on the local file.
+// If no database changed, the packages can only be upgraded if the current databases already list
+// newer versions than the installed ones, which is checked in-process.
+class RefreshPlanner : public QObject
+{
+    Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
+
+public:
+    // What the update has to do.
+    enum class Plan {
+        UP_TO_DATE,          // Nothing to refresh and nothing to upgrade.
+        UPGRADE,             // The databases are current but list newer packages ("pacman -Su").
+        REFRESH_AND_UPGRADE  // At least one database changed on the mirrors ("pacman -Syu").
+    };
+
+    // Constructor for the RefreshPlanner class.
+    // Parameters:
+    // - syncDirectory: Directory of the local sync databases, e.g. "/var/lib/pacman/sync".
+    // - parent: Pointer to the parent object that owns the planner.
+    explicit RefreshPlanner(const QString &syncDirectory, QObject *parent = nullptr);
+
+    // Aborts the running probes.
+    ~RefreshPlanner();
+
+    // Starts comparing the databases with the mirrors. Emits finished() when done.
+    void start();
+
+    // Repositories whose database changed on the mirror, or could not be checked. Valid after finished().
+    QStringList staleRepositories() const;
+
+    // Returns the plan for the given databases, which should have been read from the sync directory.
+    Plan plan(const SyncDatabase &sync, const LocalDatabase &local) const;
+
+    // Whether the sync databases list a newer version of any installed package.
+    static bool hasPendingUpgrades(const SyncDatabase &sync, const LocalDatabase &local);
+
+    // Compares two package versions ("epoch:version-release") like pacman's vercmp:
+    // negative if a is older, zero if equal, positive if a is newer.
+    static int compareVersions(const QByteArray &a, const QByteArray &b);
+
+signals:
+    // Emitted once every repository was checked or the timeout expired.
+    void finished();
+
+private:
+    // Compares the response of a probe with the local database.
+    void probeFinished(QNetworkReply *reply);
+
+    // Marks the unchecked repositories as stale and reports the result.
+    void finish();
+
+    // Whether the local database matches a remote modification time and size.
+    bool isCurrent(const QString &repository, const QDateTime &modified, qint64 size) const;
+
+    QString directory;                         // Directory of the local sync databases.
+    QNetworkAccessManager *network;            // Sends the probes.
+    QTimer *timeout;                           // Gives up on the probes.
+    QHash<QNetworkReply *, QString> probes;    // Running probes and their repositories.
+    QStringList stale;                         // Repositories that need a refresh.
+
+    static constexpr int TIMEOUT = 5000; // Time all probes together may take, in milliseconds.
+};
+
+#endif // REFRESHPLANNER_H // End of the include guard.
@@ -0,0 +1,464 @@
+#include "repocache.h" // Includes the header file for the RepoCache class.
+
+#include <QDateTime> // Used to read the modification time of the database.
+#include <QDir> // Used to create the cache directory.
+#include <QFileInfo> // Allows access to file metadata, such as modification times and sizes.
+#include <QHash> // Interns strings and merges desc/depends entries while parsing.
+#include <QSaveFile> // Replaces the cache file atomically, so a running instance never maps a partial file.
+
+#include <algorithm> // Used to sort packages and to binary search the image.
+#include <cstring> // Used to find the end of a package name.
+
+#include <archive.h> // libarchive, reads the compressed tar archives pacman uses for its databases.
+#include <archive_entry.h> // Access to the entries of an archive.
+
+namespace {
+
+// A package while the database is being parsed.
+struct ParsedPackage {
+    QByteArray name;
+    QByteArray version;
+    QByteArray filename;
+    QByteArray sha256;
+    quint64 downloadSize = 0;
+    quint64 installedSize = 0;
+    QList<QByteArray> depends;
+    QList<QByteArray> provides;
+    QList<QByteArray> groups;
+};
+
+// Strips a version constraint or description, e.g. "glibc>=2.38" or "python: for scripts" becomes the bare name.
+QByteArray bareName(const QByteArray &value) {
+    int end = 0;
+    while (end < value.size() && !strchr("<>=:", value.at(end))) {
+        end++;
+    }
+    return value.left(end).trimmed();
+}
+
+// Applies the fields of a desc or depends file to a package.
+void parseFields(const QByteArray &content, ParsedPackage &package) {
+    // The file is a list of "%FIELD%" headers, each followed by its values and a blank line.
+    QByteArray field;
+    for (const QByteArray &line : content.split('\n')) {
+        if (line.startsWith('%') && line.endsWith('%')) {
+            field = line;
+        }
+        else if (line.isEmpty()) {
+            field.clear();
+        }
+        else if (field == "%NAME%") {
+            package.name = line;
+        }
+        else if (field == "%VERSION%") {
+            package.version = line;
+        }
+        else if (field == "%FILENAME%") {
+            package.filename = line;
+        }
+        else if (field == "%SHA256SUM%") {
+            package.sha256 = line.toLower();
+        }
+        else if (field == "%CSIZE%") {
+            package.downloadSize = line.toULongLong();
+        }
+        else if (field == "%ISIZE%") {
+            package.installedSize = line.toULongLong();
+        }
+        else if (field == "%DEPENDS%") {
+            package.depends += bareName(line);
+        }
+        else if (field == "%PROVIDES%") {
+            package.provides += bareName(line);
+        }
+        else if (field == "%GROUPS%") {
+            package.groups += line;
+        }
+    }
+}
+
+// Appends the raw bytes of a vector of records to the image.
+template<typename T>
+void appendRecords(QByteArray &image, const QVector<T> &records) {
+    image.append(reinterpret_cast<const char *>(records.constData()), records.size() * int(sizeof(T)));
+}
+
+}
+
+QSharedPointer<const RepoCache> RepoCache::open(const QString &database, const QString &cacheDirectory) {
+    QFileInfo info(database);
+    if (!info.exists()) {
+        return QSharedPointer<const RepoCache>();
+    }
+    qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+    QString cachePath = cacheDirectory + "/" + info.completeBaseName() + ".cache";
+
+    // Use the cache as long as it was built from the same version of the database.
+    auto cached = fromFile(cachePath);
+    if (cached && cached->header().databaseMtime == mtime && cached->header().databaseSize == info.size()) {
+        cached->repositoryName = info.completeBaseName();
+        return cached;
+    }
+
+    // Otherwise parse the database and replace the cache.
+    QByteArray image = build(database, mtime, info.size());
+    auto built = fromBuffer(image);
+    if (!built) {
+        return QSharedPointer<const RepoCache>();
+    }
+    built->repositoryName = info.completeBaseName();
+
+    // Failing to write the cache only costs another parse on the next launch.
+    QDir().mkpath(cacheDirectory);
+    QSaveFile file(cachePath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(image);
+        file.commit();
+    }
+    return built;
+}
+
+QByteArray RepoCache::build(const QString &database, qint64 mtime, qint64 size) {
+    QVector<ParsedPackage> parsed;
+    QHash<QByteArray, int> byDirectory; // Maps "<name>-<version>" directories to their package.
+
+    // Open the database with any compression pacman may have used (gzip, zstd, ...).
+    struct archive *archive = archive_read_new();
+    archive_read_support_filter_all(archive);
+    archive_read_support_format_all(archive);
+    if (archive_read_open_filename(archive, QFile::encodeName(database).constData(), 64 * 1024) != ARCHIVE_OK) {
+        archive_read_free(archive);
+        return QByteArray();
+    }
+
+    // Every package has a "<name>-<version>/desc" entry, and older databases a separate "depends" entry.
+    struct archive_entry *entry;
+    while (archive_read_next_header(archive, &entry) == ARCHIVE_OK) {
+        QByteArray path(archive_entry_pathname(entry));
+        int slash = path.lastIndexOf('/');
+        QByteArray file = path.mid(slash + 1);
+        if (slash < 0 || (file != "desc" && file != "depends")) {
+            archive_read_data_skip(archive);
+            continue;
+        }
+
+        // Read the whole file.
+        QByteArray content;
+        char chunk[16 * 1024];
+        la_ssize_t length;
+        while ((length = archive_read_data(archive, chunk, sizeof(chunk))) > 0) {
+            content.append(chunk, int(length));
+        }
+
+        // Merge the fields into the package of the directory.
+        QByteArray directory = path.left(slash);
+        auto it = byDirectory.constFind(directory);
+        if (it == byDirectory.constEnd()) {
+            it = byDirectory.insert(directory, parsed.size());
+            parsed.append(ParsedPackage());
+        }
+        parseFields(content, parsed[it.value()]);
+    }
+    archive_read_free(archive);
+
+    // Sort by name, so lookups can binary search the records in place.
+    std::sort(parsed.begin(), parsed.end(), [](const ParsedPackage &a, const ParsedPackage &b) {
+        return a.name < b.name;
+    });
+
+    QVector<PackageRecord> packages;                  // One record per package.
+    QVector<StringRef> lists;                         // Dependency and provision lists.
+    QHash<QByteArray, QVector<quint32>> groupMembers; // Package indexes of every group.
+    QByteArray strings;                               // String table.
+    QHash<QByteArray, StringRef> interned;            // Strings already stored in the table.
+
+    // Appends a string to the string table once and returns its reference.
+    auto addString = [&strings, &interned](const QByteArray &value) {
+        auto it = interned.constFind(value);
+        if (it != interned.constEnd()) {
+            return it.value();
+        }
+        StringRef ref = { quint32(strings.size()), quint32(value.size()) };
+        strings += value;
+        interned.insert(value, ref);
+        return ref;
+    };
+
+    for (const ParsedPackage &package : parsed) {
+        PackageRecord record = {};
+        record.name = addString(package.name);
+        record.version = addString(package.version);
+        record.filename = addString(package.filename);
+        record.downloadSize = package.downloadSize;
+        record.installedSize = package.installedSize;
+
+        // Checksums are unique, so they are stored without interning them.
+        record.sha256 = { quint32(strings.size()), quint32(package.sha256.size()) };
+        strings += package.sha256;
+
+        record.firstDepend = quint32(lists.size());
+        for (const QByteArray &depend : package.depends) {
+            lists.append(addString(depend));
+        }
+        record.dependCount = quint32(lists.size()) - record.firstDepend;
+
+        record.firstProvide = quint32(lists.size());
+        for (const QByteArray &provide : package.provides) {
+            lists.append(addString(provide));
+        }
+        record.provideCount = quint32(lists.size()) - record.firstProvide;
+
+        for (const QByteArray &group : package.groups) {
+            groupMembers[group].append(quint32(packages.size()));
+        }
+        packages.append(record);
+    }
+
+    // Sort the groups by name as well, and list their members.
+    QList<QByteArray> sortedGroups = groupMembers.keys();
+    std::sort(sortedGroups.begin(), sortedGroups.end());
+    QVector<GroupRecord> groups;
+    QVector<quint32> members;
+    for (const QByteArray &group : sortedGroups) {
+        GroupRecord record = {};
+        record.name = addString(group);
+        record.firstMember = quint32(members.size());
+        members += groupMembers.value(group);
+        record.memberCount = quint32(members.size()) - record.firstMember;
+        groups.append(record);
+    }
+
+    Header header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.databaseMtime = mtime;
+    header.databaseSize = size;
+    header.packageCount = quint32(packages.size());
+    header.groupCount = quint32(groups.size());
+    header.listCount = quint32(lists.size());
+    header.memberCount = quint32(members.size());
+    header.stringsSize = quint32(strings.size());
+
+    // Lay out the sections in the order documented in repocache.h.
+    QByteArray image(reinterpret_cast<const char *>(&header), int(sizeof(header)));
+    appendRecords(image, packages);
+    appendRecords(image, groups);
+    appendRecords(image, lists);
+    appendRecords(image, members);
+    image += strings;
+    return image;
+}
+
+QSharedPointer<RepoCache> RepoCache::fromBuffer(const QByteArray &buffer) {
+    QSharedPointer<RepoCache> cache(new RepoCache);
+    cache->buffer = buffer;
+    cache->data = reinterpret_cast<const uchar *>(cache->buffer.constData());
+    cache->size = cache->buffer.size();
+
+    // Reject anything that is not a complete image of the current version.
+    return cache->validate() ? cache : QSharedPointer<RepoCache>();
+}
+
+QSharedPointer<RepoCache> RepoCache::fromFile(const QString &filename) {
+    QSharedPointer<RepoCache> cache(new RepoCache);
+    cache->file.setFileName(filename);
+
+    // Map the whole file read-only; the records are used in place without copying.
+    if (!cache->file.open(QIODevice::ReadOnly)) {
+        return QSharedPointer<RepoCache>();
+    }
+    cache->size = cache->file.size();
+    cache->data = cache->file.map(0, cache->size);
+
+    // Reject missing mappings and stale or truncated files.
+    return cache->data && cache->validate() ? cache : QSharedPointer<RepoCache>();
+}
+
+RepoCache::~RepoCache() {
+    // Release the mapping before the file is closed.
+    if (file.isOpen() && data) {
+        file.unmap(const_cast<uchar *>(data));
+    }
+}
+
+bool RepoCache::validate() const {
+    // The header has to be present before any of its fields can be read.
+    if (size < qint64(sizeof(Header))) {
+        return false;
+    }
+
+    const Header &h = header();
+    if (h.magic != MAGIC || h.version != VERSION) {
+        return false;
+    }
+
+    // The sections have to add up to exactly the size of the image.
+    qint64 expected = qint64(sizeof(Header))
+                      + qint64(h.packageCount) * qint64(sizeof(PackageRecord))
+                      + qint64(h.groupCount) * qint64(sizeof(GroupRecord))
+                      + qint64(h.listCount) * qint64(sizeof(StringRef))
+                      + qint64(h.memberCount) * qint64(sizeof(quint32))
+                      + qint64(h.stringsSize);
+    if (expected != size) {
+        return false;
+    }
+
+    // Every reference has to stay inside its section, so a corrupted cache is rebuilt instead of read out of bounds.
+    // This runs once when the cache is mapped; the accessors trust the image afterwards.
+    auto fits = [&h](const StringRef &ref) {
+        return quint64(ref.offset) + ref.length <= h.stringsSize;
+    };
+
+    for (quint32 i = 0; i < h.packageCount; i++) {
+        const PackageRecord &record = package(int(i));
+        if (!fits(record.name) || !fits(record.version) || !fits(record.filename) || !fits(record.sha256)
+            || quint64(record.firstDepend) + record.dependCount > h.listCount
+            || quint64(record.firstProvide) + record.provideCount > h.listCount) {
+            return false;
+        }
+    }
+
+    const GroupRecord *groupRecords = groups();
+    for (quint32 i = 0; i < h.groupCount; i++) {
+        if (!fits(groupRecords[i].name) || quint64(groupRecords[i].firstMember) + groupRecords[i].memberCount > h.memberCount) {
+            return false;
+        }
+    }
+
+    const StringRef *refs = lists();
+    for (quint32 i = 0; i < h.listCount; i++) {
+        if (!fits(refs[i])) {
+            return false;
+        }
+    }
+
+    // Every group member has to be a package of the repository.
+    const quint32 *indexes = members();
+    for (quint32 i = 0; i < h.memberCount; i++) {
+        if (indexes[i] >= h.packageCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const RepoCache::Header &RepoCache::header() const {
+    return *reinterpret_cast<const Header *>(data);
+}
+
+const RepoCache::PackageRecord &RepoCache::package(int index) const {
+    return reinterpret_cast<const PackageRecord *>(data + sizeof(Header))[index];
+}
+
+const RepoCache::GroupRecord *RepoCache::groups() const {
+    return reinterpret_cast<const GroupRecord *>(data + sizeof(Header) + header().packageCount * sizeof(PackageRecord));
+}
+
+const RepoCache::StringRef *RepoCache::lists() const {
+    return reinterpret_cast<const StringRef *>(groups() + header().groupCount);
+}
+
+const quint32 *RepoCache::members() const {
+    return reinterpret_cast<const quint32 *>(lists() + header().listCount);
+}
+
+QByteArray RepoCache::string(const StringRef &ref) const {
+    const char *strings = reinterpret_cast<const char *>(members() + header().memberCount);
+
+    // Refers to the image directly, without copying it.
+    return QByteArray::fromRawData(strings + ref.offset, int(ref.length));
+}
+
+QString RepoCache::repository() const {
+    return repositoryName;
+}
+
+int RepoCache::packageCount() const {
+    return int(header().packageCount);
+}
+
+int RepoCache::find(const QByteArray &name) const {
+    // Binary search the records, which are sorted by name.
+    int low = 0;
+    int high = packageCount() - 1;
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        QByteArray candidate = string(package(middle).name);
+        if (candidate < name) {
+            low = middle + 1;
+        }
+        else if (name < candidate) {
+            high = middle - 1;
+        }
+        else {
+            return middle;
+        }
+    }
+    return -1;
+}
+
+const RepoCache::GroupRecord *RepoCache::findGroup(const QByteArray &name) const {
+    // Binary search the groups, which are sorted by name.
+    const GroupRecord *begin = groups();
+    const GroupRecord *end = begin + header().groupCount;
+    auto it = std::lower_bound(begin, end, name, [this](const GroupRecord &group, const QByteArray &value) {
+        return string(group.name) < value;
+    });
+    return it != end && string(it->name) == name ? it : nullptr;
+}
+
+bool RepoCache::hasGroup(const QByteArray &name) const {
+    return findGroup(name) != nullptr;
+}
+
+QVector<int> RepoCache::groupMembers(const QByteArray &name) const {
+    QVector<int> result;
+    if (const GroupRecord *group = findGroup(name)) {
+        for (quint32 i = 0; i < group->memberCount; i++) {
+            result.append(int(members()[group->firstMember + i]));
+        }
+    }
+    return result;
+}
+
+QByteArray RepoCache::name(int package) const {
+    return string(this->package(package).name);
+}
+
+QByteArray RepoCache::version(int package) const {
+    return string(this->package(package).version);
+}
+
+QByteArray RepoCache::filename(int package) const {
+    return string(this->package(package).filename);
+}
+
+QByteArray RepoCache::sha256(int package) const {
+    return string(this->package(package).sha256);
+}
+
+quint64 RepoCache::downloadSize(int package) const {
+    return this->package(package).downloadSize;
+}
+
+quint64 RepoCache::installedSize(int package) const {
+    return this->package(package).installedSize;
+}
+
+QList<QByteArray> RepoCache::depends(int package) const {
+    const PackageRecord &record = this->package(package);
+    QList<QByteArray> names;
+    for (quint32 i = 0; i < record.dependCount; i++) {
+        names.append(string(lists()[record.firstDepend + i]));
+    }
+    return names;
+}
+
+QList<QByteArray> RepoCache::provides(int package) const {
+    const PackageRecord &record = this->package(package);
+    QList<QByteArray> names;
+    for (quint32 i = 0; i < record.provideCount; i++) {
+        names.append(string(lists()[record.firstProvide + i]));
+    }
+    return names;
+}
@@ -0,0 +1,134 @@
+#ifndef REPOCACHE_H // Start of include guard to prevent multiple inclusions of this header file.
+#define REPOCACHE_H // Define the include guard macro.
+
+#include <QByteArray> // Holds a cache image that was built in memory.
+#include <QFile> // Keeps the memory-mapped cache file open.
+#include <QList> // Used to return dependency lists.
+#include <QSharedPointer> // Shares a cache between the threads that read it.
+#include <QVector> // Used to return group members.
+
+// Package metadata of one pacman sync database (e.g. "/var/lib/pacman/sync/extra.db"),
+// compiled into a flat image that is cached on disk and memory-mapped on the next launch.
+// The cache is keyed by the modification time and size of the database, so only repositories
+// that were refreshed since the last run have to be decompressed and parsed again.
+//
+// Layout (native byte order, the cache is never shared between machines):
+//   Header
+//   PackageRecord[packageCount]    sorted by package name, so lookups are a binary search in place
+//   GroupRecord[groupCount]        sorted by group name
+//   StringRef[listCount]           dependency and provision lists referenced by the packages
+//   quint32[memberCount]           package indexes of the group members
+//   char[stringsSize]              UTF-8 string table, every distinct string is stored once
+class RepoCache
+{
+public:
+    // Reference to a UTF-8 string inside the string table.
+    struct StringRef {
+        quint32 offset; // Byte offset into the string table.
+        quint32 length; // Length in bytes.
+    };
+
+    // Fixed-size header at the start of the image.
+    struct Header {
+        quint32 magic;        // Always RepoCache::MAGIC.
+        quint32 version;      // Always RepoCache::VERSION.
+        qint64 databaseMtime; // Modification time of the database in milliseconds since the epoch.
+        qint64 databaseSize;  // Size of the database in bytes.
+        quint32 packageCount; // Number of PackageRecords.
+        quint32 groupCount;   // Number of group names.
+        quint32 listCount;    // Number of list items.
+        quint32 memberCount;  // Number of group member indexes.
+        quint32 stringsSize;  // Size of the string table in bytes.
+        quint32 reserved;     // Padding, keeps the following records 8-byte aligned.
+    };
+
+    // Metadata of one package.
+    struct PackageRecord {
+        StringRef name;         // Package name.
+        StringRef version;      // Full version, including epoch and release.
+        StringRef filename;     // File name of the package on the mirrors.
+        StringRef sha256;       // Checksum of the package file as lowercase hex (%SHA256SUM%), may be empty.
+        quint64 downloadSize;   // Compressed size (%CSIZE%).
+        quint64 installedSize;  // Installed size (%ISIZE%).
+        quint32 firstDepend;    // First list item holding the names of the dependencies.
+        quint32 dependCount;    // Number of dependencies.
+        quint32 firstProvide;   // First list item holding the names this package provides.
+        quint32 provideCount;   // Number of provided names.
+    };
+
+    // A package group, e.g. "blackarch-webapp".
+    struct GroupRecord {
+        StringRef name;      // Group name.
+        quint32 firstMember; // First member index of the group.
+        quint32 memberCount; // Number of packages in the group.
+    };
+
+    static constexpr quint32 MAGIC = 0x43524f53; // "SORC"
+    static constexpr quint32 VERSION = 3;
+
+    // Returns the metadata of a database, mapping the cache in the given directory if it is still
+    // up to date and otherwise parsing the database and replacing the cache. Returns null if the
+    // database cannot be read.
+    static QSharedPointer<const RepoCache> open(const QString &database, const QString &cacheDirectory);
+
+    // Parses a database into a cache image carrying the given key.
+    static QByteArray build(const QString &database, qint64 mtime, qint64 size);
+
+    ~RepoCache();
+
+    // Name of the repository, e.g. "extra".
+    QString repository() const;
+
+    // Number of packages in the repository.
+    int packageCount() const;
+
+    // Returns the index of the package with the given name, or -1.
+    int find(const QByteArray &name) const;
+
+    // Whether the repository contains a group with the given name.
+    bool hasGroup(const QByteArray &name) const;
+
+    // Returns the indexes of the packages in the group, or an empty list if there is no such group.
+    QVector<int> groupMembers(const QByteArray &name) const;
+
+    // Per-package accessors. Strings refer to the image without copying it.
+    QByteArray name(int package) const;
+    QByteArray version(int package) const;
+    QByteArray filename(int package) const;
+    QByteArray sha256(int package) const;
+    quint64 downloadSize(int package) const;
+    quint64 installedSize(int package) const;
+    QList<QByteArray> depends(int package) const;
+    QList<QByteArray> provides(int package) const;
+
+private:
+    RepoCache() = default;
+
+    // Wraps an image, returning null if it is not valid.
+    static QSharedPointer<RepoCache> fromBuffer(const QByteArray &buffer);
+    static QSharedPointer<RepoCache> fromFile(const QString &filename);
+
+    // Checks the header and section sizes against the size of the data, and every reference against its section.
+    bool validate() const;
+
+    // Accessors for the sections of the image.
+    const Header &header() const;
+    const PackageRecord &package(int index) const;
+    const GroupRecord *groups() const;
+    const StringRef *lists() const;
+    const quint32 *members() const;
+
+    // Returns the group with the given name, or nullptr.
+    const GroupRecord *findGroup(const QByteArray &name) const;
+
+    // Returns a string of the string table.
+    QByteArray string(const StringRef &ref) const;
+
+    QString repositoryName;      // Name of the repository.
+    const uchar *data = nullptr; // Start of the image.
+    qint64 size = 0;             // Size of the image in bytes.
+    QByteArray buffer;           // Owns the data when the image was built in memory.
+    QFile file;                  // Owns the mapping when the image was loaded from the cache.
+};
+
+#endif // REPOCACHE_H // End of the include guard.
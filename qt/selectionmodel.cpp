@@ -0,0 +1,71 @@
+#include "selectionmodel.h" // Includes the header file for the SelectionModel class.
+
+int SelectionModel::intern(const QString &package) {
+    auto it = ids.constFind(package);
+    if (it != ids.constEnd()) {
+        return it.value();
+    }
+
+    int id = names.size();
+    ids.insert(package, id);
+    names += package;
+    references += 0;
+    positions += -1;
+    return id;
+}
+
+QStringList SelectionModel::add(const QStringList &packages) {
+    QStringList added;
+    for (const QString &package : packages) {
+        int id = intern(package);
+
+        // Only the first entry selecting a package adds it.
+        if (references[id]++ == 0) {
+            positions[id] = selected.size();
+            selected += id;
+            added += package;
+        }
+    }
+    return added;
+}
+
+QStringList SelectionModel::remove(const QStringList &packages) {
+    QStringList removed;
+    for (const QString &package : packages) {
+        auto it = ids.constFind(package);
+        if (it == ids.constEnd() || references[it.value()] == 0) {
+            continue;
+        }
+
+        // Only the last entry selecting a package removes it. The last selected id takes its place.
+        int id = it.value();
+        if (--references[id] == 0) {
+            int last = selected.takeLast();
+            if (last != id) {
+                selected[positions[id]] = last;
+                positions[last] = positions[id];
+            }
+            positions[id] = -1;
+            removed += package;
+        }
+    }
+    return removed;
+}
+
+bool SelectionModel::contains(const QString &package) const {
+    auto it = ids.constFind(package);
+    return it != ids.constEnd() && references[it.value()] > 0;
+}
+
+int SelectionModel::count() const {
+    return selected.size();
+}
+
+QStringList SelectionModel::packages() const {
+    QStringList result;
+    result.reserve(selected.size());
+    for (int id : selected) {
+        result += names[id];
+    }
+    return result;
+}
@@ -0,0 +1,44 @@
+#ifndef SELECTIONMODEL_H // Start of include guard to prevent multiple inclusions of this header file.
+#define SELECTIONMODEL_H // Define the include guard macro.
+
+#include <QHash> // Maps package names to their ids.
+#include <QStringList> // Used to pass and return package names.
+#include <QVector> // Reference counts and the selected ids.
+
+// The set of packages selected in the select widget, kept up to date as entries are checked and unchecked.
+//
+// Package names are interned to small integer ids, and every id counts how many checked entries select it,
+// so entries that share packages (e.g. two tools pulling in the same library) select them only once.
+// Checking or unchecking an entry costs as much as the entry has packages, and listing the selection
+// costs as much as is selected, however many entries the catalogs have.
+class SelectionModel
+{
+public:
+    // Selects the packages of a checked entry. Returns the packages that were not selected before.
+    QStringList add(const QStringList &packages);
+
+    // Deselects the packages of an unchecked entry that was added before. Returns the packages that are
+    // no longer selected by any entry.
+    QStringList remove(const QStringList &packages);
+
+    // Whether a package is selected by at least one entry.
+    bool contains(const QString &package) const;
+
+    // Number of distinct selected packages.
+    int count() const;
+
+    // The distinct selected packages, in no particular order.
+    QStringList packages() const;
+
+private:
+    // Returns the id of a package name, assigning the next one on first use.
+    int intern(const QString &package);
+
+    QHash<QString, int> ids; // Id of every package name seen so far.
+    QStringList names;       // Package name of every id.
+    QVector<int> references; // How many selected entries select every id.
+    QVector<int> selected;   // Ids with at least one reference, in no particular order.
+    QVector<int> positions;  // Position of every id in `selected`, or -1.
+};
+
+#endif // SELECTIONMODEL_H // End of the include guard.
@@ -1,21 +1,82 @@
 #include "snigdhaosblackbox.h"  // Includes the header file for the SnigdhaOSBlackbox class to use its declarations and functionality.
 #include "./ui_snigdhaosblackbox.h"  // Includes the auto-generated header file for the UI created using Qt Designer.
+#include "applyjournal.h"  // Includes the journal that lets a retried apply skip what already succeeded.
+#include "catalogloader.h"  // Includes the background loader for the catalog files.
+#include "catalogmodel.h"  // Includes the list model used to display catalog files in the select widget.
+#include "commandgraph.h"  // Includes the steps apply.sh runs before and after installing.
+#include "connectivitymonitor.h"  // Includes the service waiting for internet connectivity.
+#include "mirrorranker.h"  // Includes the mirror ranking done before the update.
+#include "offlinebundle.h"  // Includes the offline bundles the selection can be installed from.
+#include "refreshplanner.h"  // Includes the check deciding how much of the update is needed.
+#include "packageprefetcher.h"  // Includes the background downloader for the selected packages.
+#include "progresschannel.h"  // Includes the channel the scripts report their progress on.
+#include "statesnapshot.h"  // Includes the state handed across a relaunch.
+#include "tracer.h"  // Includes the spans recorded when SNIGDHAOS_BLACKBOX_TRACE is set.
 
 #include <QCheckBox>  // Used to manage checkbox UI components.
 #include <QDebug>  // Provides tools for debugging, logging information, and printing messages to the console.
+#include <QDir>  // Locates the home directory, where profiles are exported by default.
+#include <QFileDialog>  // Asks where to export the selection as a profile.
 #include <QFileInfo>  // Allows access to file metadata, such as checking file modification times.
+#include <QLineEdit>  // Search box filtering the catalog tabs.
+#include <QLocale>  // Formats the estimated download and installed sizes.
+#include <QListView>  // Virtualized view used to display the entries of a catalog tab.
+#include <QMessageBox>  // Reports a profile that could not be exported.
+#include <QStandardPaths>  // Locates the per-user cache directory for the compiled catalogs.
+#include <QProgressBar>  // Shows a busy indicator in catalog tabs that are still loading.
 #include <QProcess>  // Used to manage and interact with external processes (such as running commands in the terminal).
-#include <QScrollArea>  // Provides a scrollable area in the UI to allow navigation through large widgets.
 #include <QTemporaryFile>  // Creates temporary files that are automatically deleted after use.
+#include <QVBoxLayout>  // Arranges the list view inside a catalog tab.
 #include <QTimer>  // Provides functionality for scheduling tasks with delays or intervals.
-#include <QtNetwork/QNetworkReply>  // Handles responses from network requests (used to check internet connectivity).
+#include <QtConcurrent/QtConcurrentRun>  // Runs the sync database read on the thread pool.
 #include <unistd.h>  // Provides POSIX functions, used here for process management (e.g., restarting the application).
 
-const char* INTERNET_CHECK_URL = "https://snigdha-os.github.io/";  // URL used to verify internet connectivity by sending a network request.
+// Directory of the catalogs shown in the select widget.
+// SNIGDHAOS_BLACKBOX_CATALOGS points to another directory, e.g. the synthetic catalogs of the benchmarks.
+static QString catalogDirectory() {
+    return qEnvironmentVariable("SNIGDHAOS_BLACKBOX_CATALOGS", "/usr/lib/snigdhaos-blackbox");
+}
+
+// Directory of the pacman databases the window reads, with "sync" and "local" below it.
+// SNIGDHAOS_BLACKBOX_DBPATH points to another directory, e.g. the empty databases of the benchmarks.
+static QString databaseDirectory() {
+    return qEnvironmentVariable("SNIGDHAOS_BLACKBOX_DBPATH", "/var/lib/pacman");
+}
+
+// Name of a state in the trace.
+static QString stateName(SnigdhaOSBlackbox::State state) {
+    switch (state) {
+    case SnigdhaOSBlackbox::State::QUIT: return "QUIT";
+    case SnigdhaOSBlackbox::State::WELCOME: return "WELCOME";
+    case SnigdhaOSBlackbox::State::INTERNET: return "INTERNET";
+    case SnigdhaOSBlackbox::State::UPDATE: return "UPDATE";
+    case SnigdhaOSBlackbox::State::UPDATE_RETRY: return "UPDATE_RETRY";
+    case SnigdhaOSBlackbox::State::NVIDIA: return "NVIDIA";
+    case SnigdhaOSBlackbox::State::SELECT: return "SELECT";
+    case SnigdhaOSBlackbox::State::APPLY: return "APPLY";
+    case SnigdhaOSBlackbox::State::APPLY_RETRY: return "APPLY_RETRY";
+    case SnigdhaOSBlackbox::State::SUCCESS: return "SUCCESS";
+    }
+    return QString();
+}
 
 SnigdhaOSBlackbox::SnigdhaOSBlackbox(QWidget *parent, QString state)
     : QMainWindow(parent)  // Calls the constructor of the QMainWindow base class to initialize the main window with the parent widget.
     , ui(new Ui::SnigdhaOSBlackbox)  // Initializes the user interface (UI) for the SnigdhaOSBlackbox window, using the UI class auto-generated by Qt Designer.
+    , catalogLoader(new CatalogLoader(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/catalogs.bin", this))  // Compiled catalogs are cached per user.
+    , syncDatabaseWatcher(new QFutureWatcher<SyncDatabase>(this))  // Notifies the window once the sync databases were read.
+    , localDatabaseWatcher(new QFutureWatcher<LocalDatabase>(this))  // Notifies the window once the installed packages were read.
+    , hardwareWatcher(new QFutureWatcher<HardwareProbe>(this))  // Holds the hardware once it was probed.
+    , hardwareRules(HardwareRules::load(catalogDirectory() + "/hardware.rules"))  // Shipped next to the catalogs.
+    , packagePrefetcher(new PackagePrefetcher(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/packages", this))  // Prefetched packages are kept per user.
+    , prefetchTimer(new QTimer(this))  // Delays the prefetch while the user is still clicking.
+    , pipelined(qEnvironmentVariableIsSet("SNIGDHAOS_BLACKBOX_PIPELINE"))  // Opt-in, inherited by relaunched instances.
+    , connectivityMonitor(new ConnectivityMonitor(ConnectivityMonitor::defaultEndpoints(), this))  // Reused for every connectivity check.
+    , mirrorRanker(new MirrorRanker(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/mirrors",  // Rankings are cached per user,
+                                    qEnvironmentVariableIsSet("SNIGDHAOS_BLACKBOX_MIRROR_TTL") ? qEnvironmentVariableIntValue("SNIGDHAOS_BLACKBOX_MIRROR_TTL") : 6 * 60 * 60,  // for six hours unless configured,
+                                    this))
+    , refreshPlanner(new RefreshPlanner(databaseDirectory() + "/sync", this))  // Compares the sync databases with the mirrors.
+    , progressChannel(new ProgressChannel(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/progress.log", this))  // Timings of the last run are kept per user.
 {
     // Sets the window icon to the specified file path, ensuring that the application window will display the given icon (SVG format).
     this->setWindowIcon(QIcon("/usr/share/pixmaps/snigdhaos-blackbox.svg"));
@@ -23,6 +84,126 @@ SnigdhaOSBlackbox::SnigdhaOSBlackbox(QWidget *parent, QString state)
     // Initializes the user interface, setting up the UI components (buttons, labels, etc.) in the SnigdhaOSBlackbox window.
     ui->setupUi(this);
 
+    // With an offline bundle, everything is selected from and installed from its directory, without the internet.
+    if (qEnvironmentVariableIsSet("SNIGDHAOS_BLACKBOX_BUNDLE")) {
+        QString error;
+        bundle = OfflineBundle::open(qEnvironmentVariable("SNIGDHAOS_BLACKBOX_BUNDLE"), &error);
+        if (!bundle.isValid()) {
+            qWarning() << "Ignoring the bundle" << qEnvironmentVariable("SNIGDHAOS_BLACKBOX_BUNDLE") << ":" << error;
+        }
+    }
+
+    // After a relaunch, pick up the selection where the previous executable left it. The gap between
+    // taking the snapshot and adopting it is the cost of the relaunch.
+    bool adopted = StateSnapshot::adopt(adoptedSnapshot);
+    if (adopted) {
+        Tracer::complete("relaunch", "process", adoptedSnapshot.created, Tracer::now());
+        ui->selectWidget_search->setText(adoptedSnapshot.search);
+    }
+
+    // Adds a tab for every catalog as soon as the loader discovers it, and fills it in once the catalog is loaded.
+    connect(catalogLoader, &CatalogLoader::catalogsFound, this, [this](const QStringList& sources) {
+        for (const QString& source : sources) {
+            populateSelectWidget(source, QFileInfo(source).baseName().toUpper());
+        }
+    });
+    connect(catalogLoader, &CatalogLoader::catalogLoaded, this, &SnigdhaOSBlackbox::catalogLoaded);
+
+    // Offers to export the selection as a profile next to OK and Cancel, and handles the buttons of the select widget.
+    exportProfileButton = ui->selectWidget_buttonBox->addButton("Export Profile...", QDialogButtonBox::ActionRole);
+    connect(ui->selectWidget_buttonBox, &QDialogButtonBox::clicked, this, &SnigdhaOSBlackbox::on_selectWidget_buttonBox_Clicked);
+
+    // Filters the catalog tabs as the user types.
+    connect(ui->selectWidget_search, &QLineEdit::textChanged, this, &SnigdhaOSBlackbox::filterCatalogs);
+
+    // Builds the content of a catalog tab only when the user first switches to it.
+    connect(ui->selectWidget_tabs, &QTabWidget::currentChanged, this, &SnigdhaOSBlackbox::populateCatalogTab);
+
+    // Marks catalog entries that cannot be installed once the sync databases were read.
+    connect(syncDatabaseWatcher, &QFutureWatcher<SyncDatabase>::finished, this, [this]() {
+        syncDatabase.reset(new SyncDatabase(syncDatabaseWatcher->result()));
+        for (auto model : ui->selectWidget_tabs->findChildren<CatalogModel*>()) {
+            model->setSyncDatabase(syncDatabase);
+        }
+        resetEstimate();
+    });
+    // Marks the catalog entries that are already installed once the local database was read.
+    connect(localDatabaseWatcher, &QFutureWatcher<LocalDatabase>::finished, this, [this]() {
+        localDatabase.reset(new LocalDatabase(localDatabaseWatcher->result()));
+        for (auto model : ui->selectWidget_tabs->findChildren<CatalogModel*>()) {
+            model->setLocalDatabase(localDatabase);
+        }
+        resetEstimate();
+    });
+
+    // Continues what waited for both reads, e.g. an apply the user started while they were still running.
+    connect(syncDatabaseWatcher, &QFutureWatcher<SyncDatabase>::finished, this, &SnigdhaOSBlackbox::databasesRead);
+    connect(localDatabaseWatcher, &QFutureWatcher<LocalDatabase>::finished, this, &SnigdhaOSBlackbox::databasesRead);
+    loadSyncDatabase();
+
+    // Probes the hardware while the user reads the welcome screen and the connectivity check runs, so the
+    // select widget knows right away what to offer. SNIGDHAOS_BLACKBOX_SYSROOT points the probe at a fake tree.
+    QString hardwareCache = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/hardware.json";
+    hardwareWatcher->setFuture(QtConcurrent::run([hardwareCache]() {
+        Tracer::Span span("probeHardware");
+        return HardwareProbe::load(qEnvironmentVariable("SNIGDHAOS_BLACKBOX_SYSROOT", "/"), hardwareCache);
+    }));
+
+    // Applies the rules and offers the drivers if the select widget was shown before the probe, or the installed
+    // packages the offer depends on, were known.
+    connect(hardwareWatcher, &QFutureWatcher<HardwareProbe>::finished, this, &SnigdhaOSBlackbox::hardwareRead);
+    connect(localDatabaseWatcher, &QFutureWatcher<LocalDatabase>::finished, this, &SnigdhaOSBlackbox::hardwareRead);
+
+    // Continues with the update as soon as the internet is reachable.
+    connect(connectivityMonitor, &ConnectivityMonitor::online, this, [this]() {
+        Tracer::end("waitForInternet");
+        if (currentState == State::INTERNET) {
+            updateState(State::UPDATE);
+        }
+    });
+
+    // Once the mirrors are ranked, checks which databases changed, then starts the update.
+    connect(mirrorRanker, &MirrorRanker::finished, this, [this]() {
+        Tracer::end("rankMirrors");
+        if (currentState == State::UPDATE) {
+            ui->waitingWidget_text->setText("Checking For Updates...");
+            Tracer::begin("checkForUpdates", "network");
+            refreshPlanner->start();
+        }
+    });
+    connect(refreshPlanner, &RefreshPlanner::finished, this, [this]() {
+        Tracer::end("checkForUpdates");
+        if (currentState == State::UPDATE) {
+            runUpdate();
+        }
+    });
+
+    // Shows what the update and apply scripts report while they run.
+    connect(progressChannel, &ProgressChannel::message, this, &SnigdhaOSBlackbox::progressReceived);
+
+    // Follows the selection with the prefetch once it did not change for a second,
+    // so quickly toggling entries does not start and abort downloads.
+    prefetchTimer->setSingleShot(true);
+    prefetchTimer->setInterval(1000);
+    connect(prefetchTimer, &QTimer::timeout, this, &SnigdhaOSBlackbox::updatePrefetch);
+    connect(packagePrefetcher, &PackagePrefetcher::progressChanged, this, &SnigdhaOSBlackbox::updateEstimate);
+
+    // Keeps the selection and the estimate up to date as the built-in options are checked and unchecked,
+    // starting from the options the form checks by default.
+    optionCheckBoxes = ui->selectWidget_tabs->findChildren<QCheckBox*>();
+    for (auto checkbox : optionCheckBoxes) {
+        if (adopted) {
+            checkbox->setChecked(adoptedSnapshot.options.contains(checkbox->objectName()));
+        }
+        if (checkbox->isChecked()) {
+            selection.add(checkbox->property("packages").toStringList());
+        }
+        connect(checkbox, &QCheckBox::toggled, this, [this, checkbox](bool checked) {
+            selectionChanged(checkbox->property("packages").toStringList(), checked);
+        });
+    }
+    updateEstimate();
+
     // Modifies the window flags to disable the close button on the window (i.e., the application cannot be closed directly via the window).
     this->setWindowFlags(this->windowFlags() & -Qt::WindowCloseButtonHint);
 
@@ -41,148 +222,264 @@ SnigdhaOSBlackbox::~SnigdhaOSBlackbox()
     delete ui;
 }
 
-void SnigdhaOSBlackbox::doInternetUpRequest() {
-    // Create a new QNetworkAccessManager instance for managing the network request.
-    // The 'this' pointer ensures the manager is associated with the current object (SnigdhaOSBlackbox).
-    QNetworkAccessManager* network_manager = new QNetworkAccessManager(this);
-
-    // Send a HEAD request to the specified URL to check if the internet connection is up.
-    // The HEAD request is used to check the server status without downloading the full content.
-    QNetworkReply* network_reply = network_manager->head(QNetworkRequest(QString(INTERNET_CHECK_URL)));
-
-    // Create a new QTimer instance that will be used to implement a timeout for the network request.
-    QTimer* timer = new QTimer(this);
-    
-    // Set the timer to single-shot mode, so it will only trigger once after the specified interval (5 seconds).
-    timer->setSingleShot(true);
-
-    // Start the timer with a 5-second interval (5000 milliseconds).
-    timer->start(5000); // 5 sec
-
-    // Connect the timer's timeout signal to a lambda function.
-    // This function will execute if the timer expires (i.e., after 5 seconds), aborting the network request.
-    connect(timer, &QTimer::timeout, this, [this, timer, network_reply, network_manager]() {
-        // Clean up the resources associated with the timer, network reply, and network manager.
-        // Deleting them to prevent memory leaks.
-        timer->deleteLater();
-        network_reply->abort();  // Abort the network request as the timeout occurred.
-        network_reply->deleteLater();  // Delete the network reply object to free resources.
-        network_manager->deleteLater();  // Delete the network manager object to free resources.
-
-        // Retry the internet check by calling this function recursively.
-        doInternetUpRequest();
-    });
+void SnigdhaOSBlackbox::loadSyncDatabase() {
+    // Replaces any read that is still running; only the latest result is used.
+    // Repositories that did not change since the last run are only mapped from the metadata cache.
+    // With a bundle, only what the bundle holds can be installed.
+    QString directory = bundle.isValid() ? bundle.directory() : databaseDirectory() + "/sync";
+    QString cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + (bundle.isValid() ? "/bundle" : "/sync");
+    QStringList repositories = bundle.isValid() ? QStringList { OfflineBundle::REPOSITORY } : QStringList();
+    syncDatabaseWatcher->setFuture(QtConcurrent::run([directory, cacheDirectory, repositories]() {
+        return SyncDatabase::load(directory, cacheDirectory, repositories);
+    }));
+    loadLocalDatabase();
+}
 
-    // Connect the network reply's finished signal to a lambda function that handles the network reply.
-    connect(network_reply, &QNetworkReply::finished, this, [this, timer, network_reply, network_manager]() {
-        // Stop the timer once the network reply is finished, as we no longer need to wait for the timeout.
-        timer->stop();
+void SnigdhaOSBlackbox::loadLocalDatabase() {
+    // Only the packages installed or removed since the last read are read again.
+    QString cacheFile = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/local.bin";
+    QString directory = databaseDirectory() + "/local";
+    localDatabaseWatcher->setFuture(QtConcurrent::run([directory, cacheFile]() {
+        return LocalDatabase::load(directory, cacheFile);
+    }));
+
+    // The estimate is rebuilt once both reads finished, and the prefetch waits for it.
+    dependencyResolver.reset();
+    packagePrefetcher->stop();
+    updateEstimate();
+}
 
-        // Clean up the resources associated with the timer, network reply, and network manager after the request finishes.
-        timer->deleteLater();
-        network_reply->deleteLater();
-        network_manager->deleteLater();
+bool SnigdhaOSBlackbox::databasesReady() const {
+    return syncDatabaseWatcher->isFinished() && localDatabaseWatcher->isFinished();
+}
 
-        // Check if there was no error with the network reply (i.e., the internet is up).
-        if (network_reply->error() == network_reply->NoError) {
-            // If there was no error, update the state to indicate that the update process can begin.
-            updateState(State::UPDATE);
-        } else {
-            // If there was an error, retry the internet check by calling this function recursively.
-            doInternetUpRequest();
+void SnigdhaOSBlackbox::databasesRead() {
+    // Both reads have to be done; the other one reports again when it finishes.
+    if (!databasesReady()) {
+        return;
+    }
+    if (updateWaiting) {
+        updateWaiting = false;
+        if (currentState == State::UPDATE) {
+            runUpdate();
         }
-    });
+    }
+    if (applyWaiting) {
+        applyWaiting = false;
+        doApply();
+    }
 }
 
 void SnigdhaOSBlackbox::doUpdate() {
+    Tracer::Span span("doUpdate");
+
     // Check if the environment variable "SNIGDHAOS_BLACKBOX_SELFUPDATE" is set. 
     // This is typically used to determine if the application is running in an update process.
     if (qEnvironmentVariableIsSet("SNIGDHAOS_BLACKBOX_SELFUPDATE")) {
         // If the environment variable is set, update the state to "SELECT" (presumably to indicate a state where the user can select an option).
+        updateStatus = StageStatus::SUCCEEDED;
         updateState(State::SELECT);
         return;  // Exit the function if the self-update process is active.
     }
 
+    // Put the fastest mirrors first before pacman downloads anything; runUpdate() continues once they are ranked
+    // and the databases were compared with the mirrors.
+    ui->waitingWidget_text->setText("Ranking Mirrors...");
+    Tracer::begin("rankMirrors", "network");
+    mirrorRanker->start();
+}
+
+void SnigdhaOSBlackbox::runUpdate() {
+    Tracer::Span span("runUpdate");
+
+    // Compare the plan with the databases read at startup, which are the ones the planner looked at.
+    // If they are still being read, databasesRead() continues here instead of blocking the window.
+    if (!databasesReady()) {
+        ui->waitingWidget_text->setText("Reading The Package Databases...");
+        updateWaiting = true;
+        return;
+    }
+    RefreshPlanner::Plan plan = refreshPlanner->plan(syncDatabaseWatcher->result(), localDatabaseWatcher->result());
+
+    // Nothing changed on the mirrors and nothing is left to upgrade, e.g. on a retry or a second run:
+    // skip the terminal altogether.
+    if (plan == RefreshPlanner::Plan::UP_TO_DATE) {
+        updateStatus = StageStatus::SUCCEEDED;
+        updateState(State::SELECT);
+        return;
+    }
+
+    ui->waitingWidget_text->setText("Please Wait! Till We Finish The Update...");
+
+    // Load the catalogs while pacman runs: the compiled cache is then up to date for the relaunched
+    // executable, and the defaults are part of the selection it takes over.
+    catalogLoader->start(catalogDirectory());
+
+    // Refresh the databases only if one of them changed. A plain -y still lets pacman skip the ones
+    // that did not change, instead of forcing every database to download again like -yy did.
+    QString command = progressCommand() + "/usr/lib/snigdhaos-blackbox/update.sh ";
+    command += plan == RefreshPlanner::Plan::UPGRADE ? "-Su" : "-Syu";
+
+    // Install the ranked mirror lists as part of the update, which already runs with sudo.
+    const QHash<QString, QString> mirrorlists = mirrorRanker->rankedMirrorlists();
+    for (auto it = mirrorlists.constBegin(); it != mirrorlists.constEnd(); ++it) {
+        command += " \"" + it.value() + "\" \"" + it.key() + "\"";
+    }
+
     // Create a new QProcess object. This will be used to run external processes (such as the terminal command to update the system).
     auto process = new QProcess(this);
 
-    // Create a temporary file that will be used during the update process.
-    QTemporaryFile* file = new QTemporaryFile(this);
-    file->open();  // Open the temporary file for writing.
-    file->setAutoRemove(true);  // Set the temporary file to be automatically removed when it is closed.
-
-    // Start a new process to launch the terminal and execute the system update command.
-    // The command runs "sudo pacman -Syyu" to update the system and then deletes the temporary file after the update is done.
+    // Start a new process to launch the terminal and execute the system update script,
+    // which reports its progress and outcome over the progress channel.
     // It also asks the user to press Enter before closing the terminal.
-    process->start("/usr/lib/snigdhaos/launch-terminal", 
-                    QStringList() << QString("sudo pacman -Syyu 2>&1 && rm \"" + file->fileName() + "\"; read -p 'Press Enter↵ to Exit'"));
+    process->start("/usr/lib/snigdhaos/launch-terminal", QStringList() << command);
+    updateStatus = StageStatus::RUNNING;
+    Tracer::begin("update.sh", "script", command);
 
     // Connect the finished signal of the QProcess to a lambda function, which will be executed when the process finishes.
     connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), 
-            this, [this, process, file](int exitcode, QProcess::ExitStatus status) {
-        // Delete the QProcess and temporary file objects after the process finishes.
+            this, [this, process](int exitcode, QProcess::ExitStatus status) {
+        // Delete the QProcess object after the process finishes.
         process->deleteLater();
-        file->deleteLater();
+        Tracer::end("update.sh");
+        bool success = progressSucceeded(exitcode);
+
+        // In pipelined mode the user is selecting meanwhile, so continue from there instead of relaunching.
+        if (pipelined) {
+            updateFinished(success);
+            return;
+        }
+        updateStatus = success ? StageStatus::SUCCEEDED : StageStatus::FAILED;
 
-        // Check the exit code of the process:
-        // If the exit code is 0 (successful), and the temporary file no longer exists, 
-        // it indicates that the update process was successful, so relaunch the app with the state "POST_UPDATE".
-        if (exitcode == 0 && !file->exists()) {
+        // Check the outcome reported by the update script:
+        // If it was successful, relaunch the app with the state "POST_UPDATE".
+        if (success) {
+            // The update refreshed the sync databases, so read them again.
+            loadSyncDatabase();
             relaunchSelf("POST_UPDATE");
         } else {
-            // If the update failed (either the exit code is non-zero or the temporary file still exists),
-            // relaunch the app with the state "UPDATE_RETRY", indicating that the update should be retried.
+            // If the update failed, relaunch the app with the state "UPDATE_RETRY", indicating that the update should be retried.
             relaunchSelf("UPDATE_RETRY");
         }
     });
+
+    // In pipelined mode, let the user select right away; applying waits for the update (see State::APPLY).
+    if (pipelined) {
+        updateState(State::SELECT);
+    }
 }
 
+void SnigdhaOSBlackbox::updateFinished(bool success) {
+    if (!success) {
+        // Ask whether to retry. A queued apply stays queued and runs once a retry succeeds.
+        updateStatus = StageStatus::FAILED;
+        updateState(State::UPDATE_RETRY);
+        return;
+    }
+    updateStatus = StageStatus::SUCCEEDED;
 
-void SnigdhaOSBlackbox::doApply() {
-    // Declare three QStringLists to hold the packages, setup commands, and prepare commands
-    QStringList packages;
-    QStringList setup_commands;
-    QStringList prepare_commands;
+    // The update refreshed the sync databases and upgraded installed packages, so read both again.
+    // The window keeps running even if the update replaced its executable, so the selection is not lost;
+    // the new version is used on the next launch.
+    loadSyncDatabase();
+
+    // Run the apply that was waiting for the update, or resume prefetching now that the databases are final.
+    if (applyQueued) {
+        applyQueued = false;
+        updateState(State::APPLY);
+    }
+    else {
+        prefetchTimer->start();
+    }
+}
 
-    // Find all QCheckBox widgets within the selectWidget_tabs widget
-    auto checkBoxList = ui->selectWidget_tabs->findChildren<QCheckBox*>();
 
-    // Iterate through each checkbox and check if it's checked
-    for (auto checkbox : checkBoxList) {
+Profile SnigdhaOSBlackbox::selectedProfile() {
+    Profile profile;
+
+    // Add the commands of the checked built-in options. Their steps are named after the checkbox
+    // without the "checkBox_" prefix, and wait for the entries named in its "after" property.
+    // The packages are passed along, so the profile knows which ones depend on prepare commands.
+    for (auto checkbox : optionCheckBoxes) {
         if (checkbox->isChecked()) {
-            // If the checkbox is checked, retrieve its associated properties and add them to the lists
-            packages += checkbox->property("packages").toStringList();  // Add selected package names to 'packages'
-            setup_commands += checkbox->property("setup_commands").toStringList();  // Add setup commands to 'setup_commands'
-            prepare_commands += checkbox->property("prepare_commands").toStringList();  // Add preparation commands to 'prepare_commands'
+            profile.addEntry(checkbox->objectName().remove("checkBox_"),
+                             checkbox->property("packages").toStringList(),
+                             checkbox->property("prepare_commands").toStringList(),
+                             checkbox->property("setup_commands").toStringList(),
+                             checkbox->property("after").toStringList());
         }
     }
 
-    // If no packages were selected, mark the state as 'SUCCESS' and exit early
-    if (packages.isEmpty()) {
-        updateState(State::SUCCESS);
-        return;
+    // Add the commands of the checked catalog entries the same way, named after the entry id.
+    for (int i = 0; i < ui->selectWidget_tabs->count(); i++) {
+        QWidget* tab = ui->selectWidget_tabs->widget(i);
+        auto model = tab->findChild<CatalogModel*>(QString(), Qt::FindDirectChildrenOnly);
+        if (!model) {
+            continue;
+        }
+        Catalog catalog = catalogs.value(tab->property("catalog").toString());
+        for (int entry : model->checkedEntries()) {
+            if (catalog.hasCommands(entry)) {
+                profile.addEntry(catalog.id(entry), catalog.packages(entry), catalog.prepareCommands(entry),
+                                 catalog.setupCommands(entry), catalog.after(entry));
+            }
+        }
     }
 
-    // If 'podman' is selected in packages, add a system setup command for it
-    if (packages.contains("podman")) {
-        setup_commands += "systemctl enable --now podman.socket";
+    // The packages of the options and of the checked catalog entries are already collected, without duplicates.
+    // Catalogs that are still loading have nothing selected yet.
+    profile.addPackages(selection.packages());
+    return profile;
+}
+
+void SnigdhaOSBlackbox::exportProfile() {
+    // Ask where to save the current selection, so it can be applied on other machines with --profile.
+    QString file = QFileDialog::getSaveFileName(this, "Export Selection As Profile", QDir::homePath() + "/snigdhaos-blackbox.json", "Profiles (*.json)");
+    if (file.isEmpty()) {
+        return;
     }
-    // If 'docker' is selected in packages, add a system setup command for it
-    if (packages.contains("docker")) {
-        setup_commands += "systemctl enable --now docker.socket";
+    if (!selectedProfile().save(file)) {
+        QMessageBox::warning(this, "Export Selection As Profile", "The profile could not be written to " + file + ".");
     }
+}
 
-    // Remove duplicate entries in the 'packages' list to avoid redundant installations
-    packages.removeDuplicates();
+void SnigdhaOSBlackbox::doApply() {
+    Tracer::Span span("doApply");
+
+    // The databases are read long before the user can click OK, so this rarely has to wait.
+    // If it does, databasesRead() continues here instead of blocking the window.
+    if (!databasesReady()) {
+        ui->waitingWidget_text->setText("Reading The Package Databases...");
+        applyWaiting = true;
+        return;
+    }
+
+    // Collect the selection and prepare it for this machine: drop packages the enabled repositories do not have
+    // and the ones already installed, and add the services the packages need.
+    Profile profile = selectedProfile();
+    const QStringList selected = profile.packages();
+    profile.resolve(syncDatabaseWatcher->result(), localDatabaseWatcher->result());
+    QStringList packages = profile.packages();
+
+    // Stop prefetching, pacman takes over from here and downloads whatever is still missing.
+    packagePrefetcher->stop();
+
+    // If nothing is left to install or run, mark the state as 'SUCCESS' and exit early.
+    // On a retry, the steps still run even if every package got installed the first time.
+    if (packages.isEmpty() && profile.prepareSteps().isEmpty() && profile.setupSteps().isEmpty()) {
+        updateState(State::SUCCESS);
+        return;
+    }
 
     // Create a temporary file to store the preparation commands and automatically delete it when no longer needed
     QTemporaryFile* prepareFile = new QTemporaryFile(this);
     prepareFile->setAutoRemove(true);  // Ensure this file is removed automatically when it goes out of scope
     prepareFile->open();  // Open the file for writing
 
-    // Create a QTextStream to write the prepare commands to the temporary file
-    QTextStream prepareStream(prepareFile);
-    prepareStream << prepare_commands.join('\n');  // Join the list of prepare commands with newlines and write to the file
+    // Write the prepare steps to the temporary file, leaving it empty if there are none
+    if (!profile.prepareSteps().isEmpty()) {
+        prepareFile->write(CommandGraph::write(profile.prepareSteps()));
+    }
     prepareFile->close();  // Close the file after writing
 
     // Create another temporary file to store the selected packages
@@ -200,48 +497,177 @@ void SnigdhaOSBlackbox::doApply() {
     setupFile->setAutoRemove(true);
     setupFile->open();  // Open the file for writing
 
-    // Create a QTextStream to write the setup commands to the temporary file
-    QTextStream setupStream(setupFile);
-    setupStream << setup_commands.join('\n');  // Join the setup commands with newlines and write to the file
+    // Write the setup steps to the temporary file, leaving it empty if there are none
+    if (!profile.setupSteps().isEmpty()) {
+        setupFile->write(CommandGraph::write(profile.setupSteps()));
+    }
     setupFile->close();  // Close the file after writing
 
-    // Create a QProcess to execute the shell script and pass the temporary file paths as arguments
+    // Expect a progress message for every package that gets installed, including dependencies.
+    int expected = dependencyResolver ? dependencyResolver->packageCount() : packages.size();
+
+    // The journal of a failed attempt is kept, so a retry of the same selection skips the steps and downloads
+    // that already succeeded. It is keyed to the selection before the installed packages were left out, since
+    // those are exactly what an earlier attempt of it may have installed.
+    QString journal = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/apply.journal";
+    ApplyJournal::create(journal, { CommandGraph::write(profile.prepareSteps()), selected.join(' ').toUtf8(), CommandGraph::write(profile.setupSteps()) });
+
+    // Create a QProcess to execute the shell script
     auto process = new QProcess(this);
+
+    // With a bundle, pacman installs its package files of the whole closure under the system's database, so nothing
+    // comes from the mirrors. The lists belong to the process and are removed with it.
+    QString bundleVariables;
+    if (bundle.isValid()) {
+        OfflineBundle::Installation installation = bundle.installation(packages, syncDatabaseWatcher->result(), localDatabaseWatcher->result());
+        QTemporaryFile* filesFile = new QTemporaryFile(process);
+        filesFile->open();
+        filesFile->write(installation.files);
+        filesFile->close();
+        QTemporaryFile* dependenciesFile = new QTemporaryFile(process);
+        dependenciesFile->open();
+        dependenciesFile->write(installation.dependencies);
+        dependenciesFile->close();
+        bundleVariables = "SNIGDHAOS_BLACKBOX_BUNDLE_FILES=\"" + filesFile->fileName() + "\" " +
+                          "SNIGDHAOS_BLACKBOX_BUNDLE_DEPENDENCIES=\"" + dependenciesFile->fileName() + "\" ";
+    }
+
+    // Pass the temporary file paths as arguments
     process->start("/usr/lib/snigdhaos/launch-terminal", 
-                    QStringList() << QString("/usr/lib/snigdhaos-blackbox/apply.sh \"") + 
+                    QStringList() << progressCommand(expected) +
+                    "SNIGDHAOS_BLACKBOX=\"" + QCoreApplication::applicationFilePath() + "\" " +  // apply.sh runs the steps through this binary
+                    "SNIGDHAOS_BLACKBOX_JOURNAL=\"" + journal + "\" " +  // and records what succeeded here
+                    bundleVariables +  // and installs from the bundle, if any
+                    "/usr/lib/snigdhaos-blackbox/apply.sh \"" + 
                     prepareFile->fileName() + "\" \"" + 
                     packagesFile->fileName() + "\" \"" + 
-                    setupFile->fileName() + "\"");
+                    setupFile->fileName() + "\" \"" +
+                    packagePrefetcher->directory() + "\"");
+    Tracer::begin("apply.sh", "script", QString("%1 packages").arg(packages.size()));
 
     // When the process finishes, the following lambda function is triggered
     connect(process, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), 
-            this, [this, process, prepareFile, packagesFile, setupFile](int exitcode, QProcess::ExitStatus status) {
+            this, [this, process, prepareFile, packagesFile, setupFile, journal](int exitcode, QProcess::ExitStatus status) {
         
         // Clean up: delete the QProcess and the temporary files after the process finishes
         process->deleteLater();
         prepareFile->deleteLater();
         packagesFile->deleteLater();
         setupFile->deleteLater();
+        Tracer::end("apply.sh");
+
+        // Whatever got installed is marked and left out of the next apply, whether this one succeeded or not.
+        loadLocalDatabase();
+
+        // If apply.sh reported success
+        if (progressSucceeded(exitcode)) {
+            // The prefetched packages are installed now and pacman keeps its own copies, so drop ours.
+            packagePrefetcher->clear();
+
+            // The next apply starts from scratch.
+            ApplyJournal::remove(journal);
 
-        // If the process was successful (exit code 0) and the temporary packages file no longer exists
-        if (exitcode == 0 && !packagesFile->exists()) {
             // Mark the state as 'SELECT' to indicate the operation was successful
             updateState(State::SELECT);
         }
         else {
-            // If there was an error (non-zero exit code or file exists), mark the state as 'APPLY_RETRY'
+            // If there was an error, mark the state as 'APPLY_RETRY'
             updateState(State::APPLY_RETRY);
         }
     });
 }
 
-void SnigdhaOSBlackbox::populateSelectWidget() {
-    // Check if the select widget already has more than one tab.
-    // If so, there's no need to populate it again, so exit early.
-    if (ui->selectWidget_tabs->count() > 1) {
+QString SnigdhaOSBlackbox::progressCommand(int expectedPackages) {
+    // Start a new run of the progress display.
+    progressChannel->reset();
+    progressDisplay = ProgressDisplay();
+    progressDisplay.expectedPackages = expectedPackages;
+    ui->progressBar->setRange(0, 0);
+    ui->waitingWidget_detail->clear();
+
+    // Without a channel, the scripts run as before and only the exit code tells the outcome.
+    if (!progressChannel->isValid()) {
+        return QString();
+    }
+    return "SNIGDHAOS_BLACKBOX_PROGRESS=\"" + progressChannel->path() + "\" ";
+}
+
+bool SnigdhaOSBlackbox::progressSucceeded(int exitcode) {
+    // The terminal may not pass the exit code of the script on, so prefer the status the script reported.
+    // Its final message may still be in the pipe, since the process can finish before the notifier fires.
+    progressChannel->drain();
+    return progressChannel->status() >= 0 ? progressChannel->status() == 0 : exitcode == 0;
+}
+
+void SnigdhaOSBlackbox::progressReceived(const QJsonObject& message) {
+    // Readable names of the stages of apply.sh and update.sh.
+    static const QHash<QString, QString> names = {
+        { "prepare", "Preparing" },
+        { "download", "Downloading packages" },
+        { "install", "Installing packages" },
+        { "setup", "Enabling services" },
+        { "mirrors", "Installing mirror lists" },
+        { "update", "Updating the system" },
+    };
+
+    QString stage = message.value("stage").toString();
+    QString event = message.value("event").toString();
+    QString name = names.value(stage, stage);
+    double duration = message.value("duration").toDouble() / 1000.0;
+    QString current;
+
+    if (event == "start") {
+        // Packages are counted for the download and install stages; the others only show activity.
+        progressDisplay.stage = name;
+        progressDisplay.completedPackages = 0;
+        bool counted = (stage == "download" || stage == "install") && progressDisplay.expectedPackages > 0;
+        ui->progressBar->setRange(0, counted ? progressDisplay.expectedPackages : 0);
+        ui->progressBar->setValue(0);
+        current = name + "...";
+    }
+    else if (event == "package") {
+        progressDisplay.completedPackages++;
+        if (ui->progressBar->maximum() > 0) {
+            ui->progressBar->setValue(qMin(progressDisplay.completedPackages, ui->progressBar->maximum()));
+        }
+
+        // Keep track of the slowest step, so it stands out.
+        if (duration > progressDisplay.slowestDuration) {
+            progressDisplay.slowestDuration = duration;
+            progressDisplay.slowestPackage = message.value("package").toString();
+        }
+
+        current = QString("%1: %2 (%3)").arg(progressDisplay.stage, message.value("package").toString()).arg(progressDisplay.completedPackages);
+        if (message.value("rate").toDouble() > 0) {
+            current += " at " + QLocale().formattedDataSize(qint64(message.value("rate").toDouble())) + "/s";
+        }
+    }
+    else if (event == "end" && stage != "done") {
+        // Show the stage inside the span of its script, as measured by the script.
+        qint64 now = Tracer::now();
+        Tracer::complete(name, "stage", now - qint64(duration * 1000000), now);
+
+        progressDisplay.timings += QString("%1: %2 s").arg(name).arg(duration, 0, 'f', 1);
+        current = name + " finished";
+    }
+    else {
         return;
     }
 
+    // Show the current step, the time every finished stage took, and the slowest package so far.
+    QStringList lines = { current };
+    if (!progressDisplay.timings.isEmpty()) {
+        lines += progressDisplay.timings.join("  ·  ");
+    }
+    if (!progressDisplay.slowestPackage.isEmpty()) {
+        lines += QString("Slowest: %1 (%2 s)").arg(progressDisplay.slowestPackage).arg(progressDisplay.slowestDuration, 0, 'f', 1);
+    }
+    ui->waitingWidget_detail->setText(lines.join('\n'));
+}
+
+void SnigdhaOSBlackbox::populateSelectWidget() {
+    Tracer::Span span("populateSelectWidget");
+
     // Retrieve the current desktop session environment variable.
     auto desktop = qEnvironmentVariable("XDG_DESKTOP_SESSION");
 
@@ -249,88 +675,341 @@ void SnigdhaOSBlackbox::populateSelectWidget() {
     // The checkbox is visible only if the current session is GNOME.
     ui->checkBox_GNOME->setVisible(desktop == "gnome");
 
-    // Variable to track whether the current device is a desktop.
-    bool isDesktop = false;
+    // Offer only what suits the hardware, e.g. the performance tweaks on desktops (see hardware.rules).
+    applyHardware();
+
+    // Discover and load every catalog in the background. The built-in "OS preferences" tab stays usable
+    // meanwhile, and each catalog gets its own tab as soon as it is ready. Only the first call starts the loader.
+    catalogLoader->start(catalogDirectory());
+}
 
-    // Attempt to read the chassis type from the system's DMI data.
-    auto chassis = QFile("/sys/class/dmi/id/chassis_type");
-    if (chassis.open(QFile::ReadOnly)) { // Open the file in read-only mode.
-        // List of chassis types that correspond to desktop systems.
-        QStringList list = { "3", "4", "6", "7", "23", "24" };
+void SnigdhaOSBlackbox::applyHardware() {
+    // Only the first time; later visits of the select widget keep what the user changed. The probe usually
+    // finished long ago, while the user was reading the welcome screen; if not, hardwareRead() calls this again.
+    if (hardware || !hardwareWatcher->isFinished()) {
+        return;
+    }
+    hardware.reset(new HardwareProbe(hardwareWatcher->result()));
+
+    // Options the rules do not offer are hidden and unchecked; other visibility, such as GNOME's, is left alone.
+    for (auto checkbox : optionCheckBoxes) {
+        QStringList packages = checkbox->property("packages").toStringList();
+        if (!hardwareRules.isShown(packages, *hardware)) {
+            checkbox->setVisible(false);
+            checkbox->setChecked(false);
+        }
+        else if (hardwareRules.isChecked(packages, *hardware)) {
+            checkbox->setChecked(true);
+        }
+    }
 
-        // Create a text stream to read data from the file.
-        QTextStream in(&chassis);
+    // Catalogs loaded before, e.g. during the update, get the rules now; later ones when their model is created.
+    for (auto model : ui->selectWidget_tabs->findChildren<CatalogModel*>()) {
+        model->setHardware(*hardware, hardwareRules);
+    }
+    filterCatalogs();
+}
 
-        // Check if the read chassis type matches any in the list.
-        isDesktop = list.contains(in.readLine());
+bool SnigdhaOSBlackbox::offerNvidiaDriver() {
+    // Decided once both the probe and the installed packages are known. Until then the select widget is shown
+    // without the offer, and hardwareRead() asks again.
+    if (nvidiaOffered || !hardwareWatcher->isFinished() || !localDatabaseWatcher->isFinished()) {
+        return false;
     }
+    nvidiaOffered = true;
 
-    // Set the visibility of the Performance checkbox based on whether
-    // the system is identified as a desktop.
-    ui->checkBox_Performance->setVisible(isDesktop);
+    applyHardware();
+    if (!hardware->hasGpu(HardwareProbe::VENDOR_NVIDIA) || ui->checkBox_NVIDIA->isChecked()) {
+        return false;
+    }
 
-    // Populate the select widget with entries from the specified file.
-    // In this case, it's populating from "webapp.txt" with the label "WEBAPP".
-    populateSelectWidget("/usr/lib/snigdhaos-blackbox/webapp.txt", "WEBAPP");
+    // Nothing to offer if the drivers are already installed.
+    LocalDatabase installed = localDatabaseWatcher->result();
+    for (const QString& package : ui->checkBox_NVIDIA->property("packages").toStringList()) {
+        if (!installed.isFullyInstalled(package.toUtf8(), SyncDatabase())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SnigdhaOSBlackbox::hardwareRead() {
+    // Only the select widget uses the hardware; if it is shown later, it applies the rules itself.
+    if (currentState != State::SELECT) {
+        return;
+    }
+    applyHardware();
+
+    // The user already sees the select widget, so the drivers are offered on top of it.
+    if (offerNvidiaDriver()) {
+        updateState(State::NVIDIA);
+    }
 }
 
 void SnigdhaOSBlackbox::populateSelectWidget(QString filename, QString label) {
-    // Create a QFile object for the provided filename.
-    QFile file(filename);
+    // Create a placeholder tab. Its list view is only built when the tab is first shown,
+    // so opening the select widget does not depend on the size of the catalog.
+    QWidget* tab = new QWidget(ui->selectWidget_tabs);
+    QVBoxLayout* layout = new QVBoxLayout(tab);
+
+    // Show a busy indicator until the catalog is loaded, unless it already is.
+    if (!catalogs.contains(filename)) {
+        QProgressBar* loading = new QProgressBar(tab);
+        loading->setRange(0, 0);
+        layout->addWidget(loading);
+    }
+
+    // Remember which catalog file belongs to this tab, and its plain title for the match counts.
+    tab->setProperty("catalog", filename);
+    tab->setProperty("label", label);
+
+    // Add the placeholder as a new tab to the selectWidget_tabs,
+    // using the provided label for the tab name.
+    ui->selectWidget_tabs->addTab(tab, label);
+
+    // Show the tab the user was looking at before a relaunch.
+    if (label == adoptedSnapshot.currentTab) {
+        ui->selectWidget_tabs->setCurrentWidget(tab);
+        adoptedSnapshot.currentTab.clear();
+    }
+}
+
+void SnigdhaOSBlackbox::catalogLoaded(const QString& filename, const Catalog& catalog, const QSharedPointer<const CatalogIndex>& index) {
+    Tracer::Span span("catalogLoaded", filename);
+
+    // Every catalog has its own index, so the search can use the catalogs that are loaded while others still load.
+    catalogs.insert(filename, catalog);
+    catalogIndexes.insert(filename, index);
+
+    // Find the tab of the catalog.
+    for (int i = 0; i < ui->selectWidget_tabs->count(); i++) {
+        QWidget* tab = ui->selectWidget_tabs->widget(i);
+        if (tab->property("catalog").toString() == filename) {
+            // Remove the busy indicator.
+            delete tab->findChild<QProgressBar*>();
+
+            // Create the model right away so the catalog defaults count towards the estimate;
+            // only the list view waits until the tab is shown.
+            catalogModel(tab);
+
+            // Apply a search the user may already have typed.
+            filterCatalogTab(i);
+
+            // Build the list right away if the user is already looking at this tab.
+            if (i == ui->selectWidget_tabs->currentIndex()) {
+                populateCatalogTab(i);
+            }
+        }
+    }
+}
+
+void SnigdhaOSBlackbox::populateCatalogTab(int index) {
+    QWidget* tab = ui->selectWidget_tabs->widget(index);
+
+    // Only catalog tabs that have not been built yet need any work.
+    if (!tab || !tab->property("catalog").isValid() || tab->findChild<QListView*>()) {
+        return;
+    }
+
+    // The list is built by catalogLoaded() if the catalog is still loading.
+    CatalogModel* model = catalogModel(tab);
+    if (!model) {
+        return;
+    }
+
+    // Create a list view that only materializes the rows that are currently visible.
+    QListView* view = new QListView(tab);
+    view->setUniformItemSizes(true);  // All rows have the same height, so the view can skip measuring them.
+    view->setModel(model);
+
+    // Add the view to the tab's layout.
+    tab->layout()->addWidget(view);
+}
+
+CatalogModel* SnigdhaOSBlackbox::catalogModel(QWidget* tab) {
+    // Reuse the model if it was already created.
+    auto model = tab->findChild<CatalogModel*>(QString(), Qt::FindDirectChildrenOnly);
+    if (!model) {
+        // Otherwise create it from the catalog associated with the tab, if it finished loading.
+        auto catalog = catalogs.constFind(tab->property("catalog").toString());
+        if (catalog == catalogs.constEnd()) {
+            return nullptr;
+        }
+        model = new CatalogModel(tab);
+        model->setCatalog(catalog.value());
+        model->setSyncDatabase(syncDatabase);
+        model->setLocalDatabase(localDatabase);
+        if (hardware) {
+            model->setHardware(*hardware, hardwareRules);
+        }
 
-    // Check if the file can be opened in read-only mode.
-    if (file.open(QIODevice::ReadOnly)) {
-        // Create a QScrollArea to hold the new tab content.
-        QScrollArea* scroll = new QScrollArea(ui->selectWidget_tabs);
+        // Check what the user had checked before a relaunch, unless the update changed the catalog.
+        for (int i = 0; i < adoptedSnapshot.catalogs.size(); i++) {
+            if (adoptedSnapshot.catalogs[i].source == catalog.key()) {
+                StateSnapshot::CatalogSelection selected = adoptedSnapshot.catalogs.takeAt(i);
+                if (StateSnapshot::isCurrent(selected)) {
+                    model->setCheckedEntries(selected.entries);
+                }
+                break;
+            }
+        }
 
-        // Create a QWidget as the container for the scroll area.
-        QWidget* tab = new QWidget(scroll);
+        // Count the catalog defaults, then follow the entries the user toggles.
+        selectionChanged(model->checkedPackages(), true);
+        connect(model, &CatalogModel::entryToggled, this, [this, catalog = catalog.value()](int entry, bool checked) {
+            selectionChanged(catalog.packages(entry), checked);
+        });
 
-        // Create a vertical layout for the container widget.
-        QVBoxLayout* layout = new QVBoxLayout(tab);
+        // Start out with the current search applied.
+        QString query = ui->selectWidget_search->text();
+        if (!query.trimmed().isEmpty()) {
+            model->setFilter(catalogIndexes.value(catalog.key())->search(query));
+        }
+    }
+    return model;
+}
 
-        // Create a QTextStream to read from the file.
-        QTextStream in(&file);
+StateSnapshot SnigdhaOSBlackbox::snapshot() const {
+    StateSnapshot snapshot;
+    for (auto checkbox : optionCheckBoxes) {
+        if (checkbox->isChecked()) {
+            snapshot.options += checkbox->objectName();
+        }
+    }
 
-        // Loop through the file, reading three lines at a time.
-        // Each set of lines corresponds to a checkbox definition.
-        while (!in.atEnd()) {
-            QString def = in.readLine();        // Line 1: Checkbox default state ("true" or "false").
-            QString packages = in.readLine();  // Line 2: Associated package names (space-separated).
-            QString display = in.readLine();   // Line 3: Display text for the checkbox.
+    // Catalogs that are still loading keep what an earlier snapshot had for them.
+    snapshot.catalogs = adoptedSnapshot.catalogs;
+    for (int i = 0; i < ui->selectWidget_tabs->count(); i++) {
+        QWidget* tab = ui->selectWidget_tabs->widget(i);
+        auto model = tab->findChild<CatalogModel*>(QString(), Qt::FindDirectChildrenOnly);
+        if (model) {
+            snapshot.catalogs += StateSnapshot::catalogSelection(tab->property("catalog").toString(), model->checkedEntries());
+        }
+    }
 
-            // Create a new QCheckBox and set its parent to the container widget.
-            auto checkbox = new QCheckBox(tab);
+    snapshot.search = ui->selectWidget_search->text();
+    if (QWidget* tab = ui->selectWidget_tabs->currentWidget()) {
+        snapshot.currentTab = tab->property("label").isValid() ? tab->property("label").toString() : ui->selectWidget_tabs->tabText(ui->selectWidget_tabs->currentIndex());
+    }
+    snapshot.created = Tracer::now();
+    return snapshot;
+}
 
-            // Set the checkbox state based on the value in `def`.
-            checkbox->setChecked(def == "true");
+void SnigdhaOSBlackbox::resetEstimate() {
+    // Both the installable and the installed packages are needed.
+    if (!syncDatabaseWatcher->isFinished() || !localDatabaseWatcher->isFinished()) {
+        return;
+    }
+    dependencyResolver.reset(new DependencyResolver(syncDatabaseWatcher->result(), localDatabaseWatcher->result()));
+
+    // Add everything that is selected so far: the checked built-in options and the checked catalog entries.
+    for (const QString& package : selection.packages()) {
+        dependencyResolver->add(package);
+    }
+    updateEstimate();
+    prefetchTimer->start();
+}
 
-            // Set the display text for the checkbox.
-            checkbox->setText(display);
+void SnigdhaOSBlackbox::selectionChanged(const QStringList& packages, bool checked) {
+    // Packages that other checked entries already select do not change anything.
+    QStringList changed = checked ? selection.add(packages) : selection.remove(packages);
 
-            // Attach the package list as a custom property to the checkbox.
-            // Splits the space-separated package string into a QStringList.
-            checkbox->setProperty("packages", packages.split(" "));
+    // Before the databases were read, resetEstimate() picks up the whole selection later.
+    if (!dependencyResolver) {
+        updateEstimate();
+        return;
+    }
 
-            // Add the checkbox to the vertical layout.
-            layout->addWidget(checkbox);
+    // Only the closures of the toggled packages are walked; the rest of the selection is reused.
+    for (const QString& package : changed) {
+        if (checked) {
+            dependencyResolver->add(package);
+        }
+        else {
+            dependencyResolver->remove(package);
         }
+    }
+    updateEstimate();
+    prefetchTimer->start();
+}
 
-        // Set the QWidget as the main content of the QScrollArea.
-        scroll->setWidget(tab);
+void SnigdhaOSBlackbox::updateEstimate() {
+    // The number of selected packages is known right away, the rest once the databases were read.
+    QString selected = QString("%1 packages selected").arg(selection.count());
+    if (!dependencyResolver) {
+        ui->selectWidget_estimate->setText(selected + ", calculating download size...");
+        return;
+    }
 
-        // Add the QScrollArea as a new tab to the selectWidget_tabs,
-        // using the provided label for the tab name.
-        ui->selectWidget_tabs->addTab(scroll, label);
+    QLocale locale;
+    ui->selectWidget_estimate->setText(selected + QString(": %1 packages to install, %2 to download, %3 installed size")
+                                           .arg(dependencyResolver->packageCount())
+                                           .arg(locale.formattedDataSize(qint64(dependencyResolver->downloadSize())))
+                                           .arg(locale.formattedDataSize(qint64(dependencyResolver->installedSize())))
+                                       + (packagePrefetcher->packageCount() > 0
+                                              ? QString(" (%1 of %2 already downloaded)").arg(packagePrefetcher->downloadedCount()).arg(packagePrefetcher->packageCount())
+                                              : QString()));
+}
 
-        // Close the file after reading its content.
-        file.close();
+void SnigdhaOSBlackbox::updatePrefetch() {
+    // Only prefetch while the user is selecting and the system update is not running,
+    // so the sync databases and the package files on the mirrors match. A bundle has the files on disk already.
+    if (!dependencyResolver || bundle.isValid() || currentState != State::SELECT || updateStatus == StageStatus::RUNNING) {
+        return;
     }
+    packagePrefetcher->setPackages(dependencyResolver->packages());
+}
+
+void SnigdhaOSBlackbox::filterCatalogs() {
+    for (int i = 0; i < ui->selectWidget_tabs->count(); i++) {
+        filterCatalogTab(i);
+    }
+}
+
+void SnigdhaOSBlackbox::filterCatalogTab(int index) {
+    QWidget* tab = ui->selectWidget_tabs->widget(index);
+
+    // Only catalog tabs whose catalog finished loading can be searched.
+    auto catalogIndex = catalogIndexes.value(tab->property("catalog").toString());
+    if (!catalogIndex) {
+        return;
+    }
+
+    QString query = ui->selectWidget_search->text();
+    QString label = tab->property("label").toString();
+    auto model = tab->findChild<CatalogModel*>(QString(), Qt::FindDirectChildrenOnly);
+
+    // Without a search, show every entry and the plain title.
+    if (query.trimmed().isEmpty()) {
+        if (model) {
+            model->clearFilter();
+        }
+        ui->selectWidget_tabs->setTabText(index, label);
+        return;
+    }
+
+    // Look the query up in the index and show the number of matches next to the title.
+    // Entries the hardware rules hide are not counted.
+    QVector<int> matches = catalogIndex->search(query);
+    if (model) {
+        model->setFilter(matches);
+    }
+    ui->selectWidget_tabs->setTabText(index, QString("%1 (%2)").arg(label).arg(model ? model->rowCount() : matches.size()));
 }
 
 void SnigdhaOSBlackbox::updateState(State state) {
+    // Before the select widget is first shown, offer the NVIDIA drivers if the machine needs them.
+    if (state == State::SELECT && offerNvidiaDriver()) {
+        state = State::NVIDIA;
+    }
+
     // Only update the UI if the state has changed.
     if (currentState != state) {
+        // Each state is one span in the trace, from entering it until the next transition.
+        Tracer::Span span("updateState", stateName(state));
+        Tracer::end(stateName(currentState));
+        Tracer::begin(stateName(state), "state");
+
         currentState = state;  // Update the current state.
 
         // Ensure the application window is visible and in focus.
@@ -349,9 +1028,10 @@ void SnigdhaOSBlackbox::updateState(State state) {
 
         case State::INTERNET:
             // Show the internet connection status screen.
-            ui->mainStackedWidget->setCurrentWidget(ui->mainStackedWidget); // Switch to the main stack.
+            ui->mainStackedWidget->setCurrentWidget(ui->waitingWidget); // Switch to the waiting widget.
             ui->waitingWidget_text->setText("Waiting For Internet Connection..."); // Display waiting message.
-            doInternetUpRequest(); // Trigger an internet connection check.
+            Tracer::begin("waitForInternet", "network"); // Ended once an endpoint answered.
+            connectivityMonitor->start(); // Probe until the internet is reachable.
             break;
 
         case State::UPDATE:
@@ -368,6 +1048,13 @@ void SnigdhaOSBlackbox::updateState(State state) {
             ui->textWidget_buttonBox->setStandardButtons(QDialogButtonBox::Yes | QDialogButtonBox::No); // Set retry buttons.
             break;
 
+        case State::NVIDIA:
+            // Ask whether to install the NVIDIA drivers.
+            ui->mainStackedWidget->setCurrentWidget(ui->textWidget); // Switch to the text widget.
+            ui->textStackedWidget->setCurrentWidget(ui->textWidget_nvidia); // Show the driver offer.
+            ui->textWidget_buttonBox->setStandardButtons(QDialogButtonBox::Yes | QDialogButtonBox::No); // Set the answer buttons.
+            break;
+
         case State::QUIT:
             // Show the quit confirmation screen.
             ui->mainStackedWidget->setCurrentWidget(ui->textWidget); // Switch to the text widget.
@@ -376,14 +1063,23 @@ void SnigdhaOSBlackbox::updateState(State state) {
             break;
 
         case State::SELECT:
-            // Show the selection screen.
-            ui->mainStackedWidget->setCurrentWidget(ui->waitingWidget); // Switch to the waiting widget.
+            // Show the selection screen right away; catalog tabs are added while their catalogs load.
+            ui->mainStackedWidget->setCurrentWidget(ui->selectWidget); // Switch to the select widget.
             populateSelectWidget(); // Populate the selection UI dynamically.
+            prefetchTimer->start(); // Resume prefetching a selection made before.
             break;
 
         case State::APPLY:
             // Show the apply changes screen.
             ui->mainStackedWidget->setCurrentWidget(ui->waitingWidget); // Switch to the waiting widget.
+
+            // Applying depends on the update: in pipelined mode it may still be running, so queue the apply behind it.
+            if (updateStatus == StageStatus::RUNNING) {
+                ui->waitingWidget_text->setText("Waiting For The Update To Finish Before Applying The Changes..."); // Display waiting message.
+                applyQueued = true; // Started by updateFinished().
+                break;
+            }
+
             ui->waitingWidget_text->setText("We are applying the changes..."); // Display applying message.
             doApply(); // Start applying changes.
             break;
@@ -424,6 +1120,9 @@ void SnigdhaOSBlackbox::updateState(QString state) {
 }
 
 void SnigdhaOSBlackbox::relaunchSelf(QString param) {
+    // Ended right away, or by the exec, which also ends the span of the current state.
+    Tracer::begin("relaunchSelf", "function", param);
+
     // Get the current application's binary path and file information.
     auto binary = QFileInfo(QCoreApplication::applicationFilePath());
 
@@ -432,7 +1131,10 @@ void SnigdhaOSBlackbox::relaunchSelf(QString param) {
         // If the modification time has changed, relaunch the application with the given parameter.
         
         // execlp is used to execute the current binary again, passing the parameter 'param'.
-        // It replaces the current process with a new instance of the application.
+        // It replaces the current process with a new instance of the application, which continues the trace
+        // and takes over the selection from the snapshot, if it understands its version.
+        snapshot().publish();
+        Tracer::prepareExec();
         execlp(
             binary.absoluteFilePath().toUtf8().constData(),  // Path to the executable file.
             binary.fileName().toUtf8().constData(),          // Name of the executable (e.g., "SnigdhaOS").
@@ -445,6 +1147,7 @@ void SnigdhaOSBlackbox::relaunchSelf(QString param) {
     }
     else {
         // If the executable has not been modified, just update the application's state using the provided parameter.
+        Tracer::end("relaunchSelf");
         updateState(param);
     }
 }
@@ -453,9 +1156,10 @@ void SnigdhaOSBlackbox::on_textWidget_buttonBox_clicked(QAbstractButton* button)
     // Check the current state of the application.
     switch(currentState) {
     case State::WELCOME:
-        // If the current state is 'WELCOME' and the 'Ok' button is clicked, transition to 'INTERNET' state.
+        // If the current state is 'WELCOME' and the 'Ok' button is clicked, transition to 'INTERNET' state,
+        // or straight to 'SELECT' with a bundle, which needs neither the internet nor the update.
         if (ui->textWidget_buttonBox->standardButton(button) == QDialogButtonBox::Ok) {
-            updateState(State::INTERNET);
+            updateState(bundle.isValid() ? State::SELECT : State::INTERNET);
         }
         break;
 
@@ -466,6 +1170,12 @@ void SnigdhaOSBlackbox::on_textWidget_buttonBox_clicked(QAbstractButton* button)
         }
         break;
 
+    case State::NVIDIA:
+        // Either answer continues to the select widget; 'Yes' checks the drivers there and 'No' does not quit.
+        ui->checkBox_NVIDIA->setChecked(ui->textWidget_buttonBox->standardButton(button) == QDialogButtonBox::Yes);
+        updateState(State::SELECT);
+        return;
+
     case State::APPLY_RETRY:
         // If the current state is 'APPLY_RETRY' and the 'Yes' button is clicked, transition to 'APPLY' state.
         if (ui->textWidget_buttonBox->standardButton(button) == QDialogButtonBox::Yes) {
@@ -508,6 +1218,12 @@ void SnigdhaOSBlackbox::on_textWidget_buttonBox_clicked(QAbstractButton* button)
 
 
 void SnigdhaOSBlackbox::on_selectWidget_buttonBox_Clicked(QAbstractButton* button) {
+    // Exporting the selection keeps the user on the select widget.
+    if (button == exportProfileButton) {
+        exportProfile();
+        return;
+    }
+
     // Check if the 'Ok' button was clicked in the 'selectWidget_buttonBox'.
     if (ui->selectWidget_buttonBox->standardButton(button) == QDialogButtonBox::Ok) {
         // If 'Ok' is clicked, transition to the 'APPLY' state.
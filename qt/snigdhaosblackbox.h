@@ -5,12 +5,39 @@
 #include <QAbstractButton> // Abstract base class for button widgets such as QPushButton, QCheckBox, etc.
 #include <QtNetwork/QNetworkAccessManager> // Used for sending and managing network requests and responses.
 
+#include "catalog.h" // Compiled catalogs displayed in the catalog tabs.
+#include "catalogindex.h" // Search indexes over the catalogs.
+#include "dependencyresolver.h" // Estimates the size of the current selection.
+#include "hardwareprobe.h" // Hardware the options and catalog entries are offered for.
+#include "hardwarerules.h" // Which options and catalog entries the hardware shows and checks.
+#include "localdatabase.h" // Packages already installed on the system.
+#include "offlinebundle.h" // Local repository to install from instead of the mirrors.
+#include "profile.h" // Selection of packages and commands to apply.
+#include "selectionmodel.h" // Distinct packages of the checked entries.
+#include "statesnapshot.h" // Selection handed to the relaunched executable.
+#include "syncdatabase.h" // Packages available in the pacman sync databases.
+
+#include <QFutureWatcher> // Tracks the background read of the sync databases.
+
+#include <QHash> // Maps catalog files to their loaded catalogs.
+#include <QJsonObject> // Progress messages of the scripts.
+
 QT_BEGIN_NAMESPACE // Marks the start of Qt's namespace, for compatibility with C++ namespaces.
 namespace Ui {
 class SnigdhaOSBlackbox; // Forward declaration of the `Ui::SnigdhaOSBlackbox` class, generated from the .ui file.
 }
 QT_END_NAMESPACE // Marks the end of the Qt namespace.
 
+class CatalogModel; // Forward declaration of the model backing the catalog tabs.
+class CatalogLoader; // Forward declaration of the background catalog loader.
+class ConnectivityMonitor; // Forward declaration of the service waiting for internet connectivity.
+class MirrorRanker; // Forward declaration of the mirror ranking done before the update.
+class RefreshPlanner; // Forward declaration of the check deciding how much of the update is needed.
+class PackagePrefetcher; // Forward declaration of the background package downloader.
+class ProgressChannel; // Forward declaration of the channel the scripts report their progress on.
+class QTimer; // Forward declaration of the timer delaying the prefetch.
+class QCheckBox; // Forward declaration of the checkboxes of the built-in options.
+
 class SnigdhaOSBlackbox : public QMainWindow // Inherits from QMainWindow to represent the application's main window.
 {
     Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
@@ -23,12 +50,21 @@ public:
         INTERNET,       // Check internet connectivity.
         UPDATE,         // Perform updates.
         UPDATE_RETRY,   // Retry updating if the previous attempt failed.
+        NVIDIA,         // Offer the NVIDIA drivers before the selection.
         SELECT,         // Allow the user to select options or tools.
         APPLY,          // Apply the selected options or configurations.
         APPLY_RETRY,    // Retry applying changes if the first attempt fails.
         SUCCESS         // Indicate successful completion of operations.
     };
 
+    // Progress of a stage that can run in the background, such as the system update in pipelined mode.
+    enum class StageStatus {
+        NOT_STARTED,    // The stage has not run in this process.
+        RUNNING,        // The stage is running.
+        SUCCEEDED,      // The stage finished successfully.
+        FAILED          // The stage failed.
+    };
+
     // Constructor for the SnigdhaOSBlackbox class.
     // Parameters:
     // - parent: Pointer to the parent widget. Defaults to nullptr, meaning no parent.
@@ -48,21 +84,136 @@ private slots: // Qt slots, which respond to signals (e.g., button clicks).
 private:
     Ui::SnigdhaOSBlackbox *ui; // Pointer to the UI object generated from the .ui file.
 
+    QAbstractButton* exportProfileButton = nullptr; // Exports the selection as a profile, in the select widget.
+
     QDateTime executable_modify_date; // Stores the modification date of the application executable, possibly for update checks.
 
     State currentState; // Keeps track of the current state of the application.
 
+    CatalogLoader* catalogLoader; // Loads the catalogs displayed in the select widget in the background.
+
+    QHash<QString, Catalog> catalogs; // Catalogs that finished loading, keyed by their file name.
+
+    QHash<QString, QSharedPointer<const CatalogIndex>> catalogIndexes; // Search index of every loaded catalog, keyed by file name.
+
+    QFutureWatcher<SyncDatabase>* syncDatabaseWatcher; // Background read of the pacman sync databases.
+    QSharedPointer<const SyncDatabase> syncDatabase; // Installable packages, null until the first read finished.
+
+    QFutureWatcher<LocalDatabase>* localDatabaseWatcher; // Background read of the pacman local database.
+    QSharedPointer<const LocalDatabase> localDatabase; // Installed packages, null until the first read finished.
+
+    QFutureWatcher<HardwareProbe>* hardwareWatcher; // Background probe of the hardware, started with the window.
+    QSharedPointer<const HardwareProbe> hardware; // Probed hardware, null until the select widget first needed it.
+    HardwareRules hardwareRules; // Which options and catalog entries the hardware shows and checks.
+    bool nvidiaOffered = false; // Whether the NVIDIA driver offer was already considered.
+
+    SelectionModel selection; // Packages of the checked options and catalog entries, kept up to date as they are toggled.
+    QList<QCheckBox*> optionCheckBoxes; // Built-in options of the "OS preferences" tab, in the order of the form.
+
+    StateSnapshot adoptedSnapshot; // Selection of the executable that relaunched this one; catalogs are removed once restored.
+
+    QSharedPointer<DependencyResolver> dependencyResolver; // Live estimate of the selection, null until both databases were read.
+
+    PackagePrefetcher* packagePrefetcher; // Downloads the selected packages while the user is still choosing.
+    QTimer* prefetchTimer; // Waits for the selection to settle before the prefetch follows it.
+
+    bool pipelined; // Whether the system update runs in the background while the user selects (SNIGDHAOS_BLACKBOX_PIPELINE).
+
+    OfflineBundle bundle; // Offline bundle to select from and install from (SNIGDHAOS_BLACKBOX_BUNDLE), invalid to use the mirrors.
+
+    StageStatus updateStatus = StageStatus::NOT_STARTED; // Progress of the system update.
+
+    bool applyQueued = false; // Whether the user asked to apply while the update was still running.
+
+    bool applyWaiting = false; // Whether doApply() waits for the databases to be read.
+    bool updateWaiting = false; // Whether runUpdate() waits for the databases to be read.
+
+    ConnectivityMonitor* connectivityMonitor; // Waits for the internet before the update.
+
+    MirrorRanker* mirrorRanker; // Orders the mirrors by speed before the update.
+
+    RefreshPlanner* refreshPlanner; // Skips refreshing or upgrading when nothing changed.
+
+    ProgressChannel* progressChannel; // Progress reported by apply.sh and update.sh.
+
+    // What the waiting widget shows about the running script.
+    struct ProgressDisplay {
+        int expectedPackages = 0;    // Packages the download and install stages are expected to report, 0 if unknown.
+        int completedPackages = 0;   // Packages reported by the current stage.
+        QString stage;               // Readable name of the current stage.
+        QStringList timings;         // Durations of the finished stages.
+        QString slowestPackage;      // Package that took the longest so far.
+        double slowestDuration = 0;  // Its duration in seconds.
+    } progressDisplay;
+
     // Private member functions for internal operations:
-    void doInternetUpRequest(); // Checks for internet connectivity.
+    void loadSyncDatabase(); // Reads the pacman sync and local databases in the background.
+    void loadLocalDatabase(); // Reads the pacman local database again in the background, e.g. after applying.
+    bool databasesReady() const; // Whether the sync and local databases were read.
+    void databasesRead(); // Continues what waited for the sync and local databases to be read.
     void doUpdate(); // Handles the update process.
+    void runUpdate(); // Runs as much of the system update as needed in a terminal, once the mirrors are ranked.
+    void updateFinished(bool success); // Continues after a background system update, in pipelined mode.
     void doApply(); // Applies the selected configuration or changes.
+    Profile selectedProfile(); // Collects the packages and commands the user selected.
+    void exportProfile(); // Saves the selection as a profile for headless runs on other machines.
 
     // Populates the selection widget with options.
     void populateSelectWidget();
+
+    // Hides and checks the options and catalog entries as the hardware rules say, once the probe finished.
+    void applyHardware();
+
+    // Whether to offer the NVIDIA drivers: only once, with an NVIDIA card and without the drivers.
+    bool offerNvidiaDriver();
+
+    // Applies the hardware rules and makes the NVIDIA offer on the select widget once the probe and the
+    // local database finished, if they were not done when it was shown.
+    void hardwareRead();
     
     // Overloaded version to populate the widget with specific files and labels.
     void populateSelectWidget(QString filename, QString label);
 
+    // Replaces the loading indicator of a catalog tab once its catalog is available.
+    void catalogLoaded(const QString& filename, const Catalog& catalog, const QSharedPointer<const CatalogIndex>& index);
+
+    // Filters every catalog tab by the text of the search box.
+    void filterCatalogs();
+
+    // Filters one catalog tab by the text of the search box and shows its match count in the tab title.
+    void filterCatalogTab(int index);
+
+    // Builds the list view of a catalog tab the first time it is shown.
+    void populateCatalogTab(int index);
+
+    // Collects the selection, the search and the open tab for the relaunched executable.
+    StateSnapshot snapshot() const;
+
+    // Returns the model of a catalog tab, or nullptr while its catalog is still loading.
+    CatalogModel* catalogModel(QWidget* tab);
+
+    // Rebuilds the estimate from the whole current selection once both databases were read.
+    void resetEstimate();
+
+    // Adds or removes packages from the selection and the estimate when the user checks or unchecks them.
+    void selectionChanged(const QStringList& packages, bool checked);
+
+    // Shows the current estimate below the catalog tabs.
+    void updateEstimate();
+
+    // Points the prefetcher at the packages of the current selection.
+    void updatePrefetch();
+
+    // Starts a new progress display and returns the environment assignment passing the channel to a script.
+    QString progressCommand(int expectedPackages = 0);
+
+    // Whether the script succeeded, from the status it reported or else from the exit code. Reads what is
+    // left in the progress pipe first.
+    bool progressSucceeded(int exitcode);
+
+    // Shows a progress message of the running script.
+    void progressReceived(const QJsonObject& message);
+
     // Updates the application state using the `State` enum.
     void updateState(State state);
     
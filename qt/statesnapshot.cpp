@@ -0,0 +1,125 @@
+#include "statesnapshot.h" // Includes the header file for the StateSnapshot class.
+
+#include <QFileInfo> // Size and modification time of the catalogs.
+#include <QJsonArray> // Lists of the snapshot.
+#include <QJsonDocument> // Encodes the snapshot.
+#include <QJsonObject> // Fields of the snapshot.
+
+#include <fcntl.h> // Seals the memfd.
+#include <sys/mman.h> // Creates the memfd.
+#include <unistd.h> // Writes, rewinds and closes the memfd.
+
+StateSnapshot::CatalogSelection StateSnapshot::catalogSelection(const QString &source, const QVector<int> &entries) {
+    QFileInfo info(source);
+    return { source, info.size(), info.lastModified().toMSecsSinceEpoch(), entries };
+}
+
+bool StateSnapshot::isCurrent(const CatalogSelection &selection) {
+    QFileInfo info(selection.source);
+    return info.exists() && info.size() == selection.size && info.lastModified().toMSecsSinceEpoch() == selection.modified;
+}
+
+QByteArray StateSnapshot::toJson() const {
+    QJsonArray catalogArray;
+    for (const CatalogSelection &catalog : catalogs) {
+        QJsonArray entries;
+        for (int entry : catalog.entries) {
+            entries.append(entry);
+        }
+        catalogArray.append(QJsonObject {
+            { "source", catalog.source },
+            { "size", catalog.size },
+            { "modified", catalog.modified },
+            { "entries", entries },
+        });
+    }
+    return QJsonDocument(QJsonObject {
+        { "version", VERSION },
+        { "options", QJsonArray::fromStringList(options) },
+        { "catalogs", catalogArray },
+        { "search", search },
+        { "currentTab", currentTab },
+        { "created", created },
+    }).toJson(QJsonDocument::Compact);
+}
+
+bool StateSnapshot::fromJson(const QByteArray &data, StateSnapshot &snapshot) {
+    QJsonObject object = QJsonDocument::fromJson(data).object();
+    if (object.value("version").toInt() != VERSION) {
+        return false;
+    }
+
+    snapshot = StateSnapshot();
+    for (const QJsonValue &option : object.value("options").toArray()) {
+        snapshot.options += option.toString();
+    }
+    for (const QJsonValue &value : object.value("catalogs").toArray()) {
+        QJsonObject catalog = value.toObject();
+        CatalogSelection selection;
+        selection.source = catalog.value("source").toString();
+        selection.size = qint64(catalog.value("size").toDouble(-1));
+        selection.modified = qint64(catalog.value("modified").toDouble(-1));
+        for (const QJsonValue &entry : catalog.value("entries").toArray()) {
+            selection.entries += entry.toInt();
+        }
+        snapshot.catalogs += selection;
+    }
+    snapshot.search = object.value("search").toString();
+    snapshot.currentTab = object.value("currentTab").toString();
+    snapshot.created = qint64(object.value("created").toDouble(-1));
+    return true;
+}
+
+bool StateSnapshot::publish() const {
+    // Without MFD_CLOEXEC, so the descriptor survives the exec.
+    int fd = memfd_create("snigdhaos-blackbox-snapshot", MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        return false;
+    }
+
+    QByteArray data = toJson();
+    qint64 written = 0;
+    while (written < data.size()) {
+        ssize_t result = write(fd, data.constData() + written, size_t(data.size() - written));
+        if (result <= 0) {
+            close(fd);
+            return false;
+        }
+        written += result;
+    }
+
+    // Nothing can change the snapshot anymore, so the new executable can trust what it reads.
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0) {
+        close(fd);
+        return false;
+    }
+    qputenv("SNIGDHAOS_BLACKBOX_SNAPSHOT", QByteArray::number(fd));
+    return true;
+}
+
+bool StateSnapshot::adopt(StateSnapshot &snapshot) {
+    if (!qEnvironmentVariableIsSet("SNIGDHAOS_BLACKBOX_SNAPSHOT")) {
+        return false;
+    }
+    bool valid = false;
+    int fd = qEnvironmentVariableIntValue("SNIGDHAOS_BLACKBOX_SNAPSHOT", &valid);
+    qunsetenv("SNIGDHAOS_BLACKBOX_SNAPSHOT");
+    if (!valid || fd < 0) {
+        return false;
+    }
+
+    // Only read a descriptor that really is a sealed snapshot, and release it either way.
+    QByteArray data;
+    int seals = fcntl(fd, F_GET_SEALS);
+    if (seals >= 0 && (seals & F_SEAL_WRITE)) {
+        char buffer[64 * 1024];
+        ssize_t result;
+        off_t offset = 0;
+        while ((result = pread(fd, buffer, sizeof(buffer), offset)) > 0) {
+            data.append(buffer, int(result));
+            offset += result;
+        }
+    }
+    close(fd);
+    return !data.isEmpty() && fromJson(data, snapshot);
+}
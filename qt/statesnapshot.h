@@ -0,0 +1,58 @@
+#ifndef STATESNAPSHOT_H // Start of include guard to prevent multiple inclusions of this header file.
+#define STATESNAPSHOT_H // Define the include guard macro.
+
+#include <QString> // Names of the options and catalogs.
+#include <QStringList> // Checked options.
+#include <QVector> // Checked catalog entries.
+
+// What the window hands to the executable it relaunches after an update replaced it: the selection, the
+// search and the open tab, so the select widget comes back as the user left it.
+//
+// The snapshot is written as JSON to a sealed memfd, which the exec inherits. Its descriptor is passed in
+// SNIGDHAOS_BLACKBOX_SNAPSHOT. The new executable may be a different version, so the snapshot carries a
+// format version and is ignored unless it matches. The catalogs themselves are not part of it: their
+// compiled image is already cached on disk and mapped by the new executable. Catalog entries are stored
+// by index, together with the size and modification time of their catalog, and are dropped if the
+// update changed the catalog.
+class StateSnapshot
+{
+public:
+    static constexpr int VERSION = 1;
+
+    // Checked entries of one catalog.
+    struct CatalogSelection {
+        QString source;           // Path of the catalog file.
+        qint64 size = -1;         // Size of the file when the snapshot was taken.
+        qint64 modified = -1;     // Its modification time in milliseconds.
+        QVector<int> entries;     // Indexes of the checked entries.
+    };
+
+    QStringList options;                 // Object names of the checked built-in options.
+    QVector<CatalogSelection> catalogs;  // Checked entries of every loaded catalog.
+    QString search;                      // Text of the search box.
+    QString currentTab;                  // Title of the tab that was shown, without the match count.
+    qint64 created = -1;                 // Monotonic time at which the snapshot was taken, in microseconds.
+
+    // Records the file a catalog selection belongs to.
+    static CatalogSelection catalogSelection(const QString &source, const QVector<int> &entries);
+
+    // Whether the catalog file is still the one the selection was made in.
+    static bool isCurrent(const CatalogSelection &selection);
+
+    // Writes the snapshot to a sealed memfd that the next exec inherits, and points
+    // SNIGDHAOS_BLACKBOX_SNAPSHOT at it. Returns false if that is not possible.
+    bool publish() const;
+
+    // Takes the snapshot handed over by the previous executable. Returns false if there is none,
+    // or if it has another format version.
+    static bool adopt(StateSnapshot &snapshot);
+
+private:
+    // Encodes the snapshot.
+    QByteArray toJson() const;
+
+    // Decodes a snapshot. Returns false if the data is not a snapshot of this version.
+    static bool fromJson(const QByteArray &data, StateSnapshot &snapshot);
+};
+
+#endif // STATESNAPSHOT_H // End of the include guard.
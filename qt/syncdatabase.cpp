@@ -0,0 +1,108 @@
+#include "syncdatabase.h" // Includes the header file for the SyncDatabase class.
+#include "pacmanconfig.h" // Repository order of pacman.conf.
+
+#include <QDir> // Used to find the database files.
+#include <QSet> // Tracks the group members already seen.
+#include <QtConcurrent/QtConcurrentMap> // Reads the database files in parallel.
+
+SyncDatabase SyncDatabase::load(const QString &directory, const QString &cacheDirectory, const QStringList &repositories) {
+    // Find the sync database of every enabled repository, in the order pacman.conf lists them,
+    // since the first repository providing a package wins.
+    QStringList order = repositories.isEmpty() ? PacmanConfig::load().repositories() : repositories;
+    QDir dir(directory);
+    QStringList files;
+    for (const QString &repository : order) {
+        if (dir.exists(repository + ".db")) {
+            files += dir.absoluteFilePath(repository + ".db");
+        }
+    }
+
+    // Open them in parallel, keeping their order. Unchanged repositories only map their cache; changed ones are parsed again.
+    auto open = [cacheDirectory](const QString &file) {
+        return RepoCache::open(file, cacheDirectory);
+    };
+    SyncDatabase database;
+    for (const auto &repository : QtConcurrent::blockingMapped<QVector<QSharedPointer<const RepoCache>>>(files, open)) {
+        if (repository) {
+            database.repos.append(repository);
+        }
+    }
+
+    // Index the provided names here, since load() runs in a worker thread and the lookups happen on the GUI thread.
+    for (const auto &repository : database.repos) {
+        for (int index = 0; index < repository->packageCount(); index++) {
+            for (const QByteArray &provide : repository->provides(index)) {
+                if (!database.providers.contains(provide)) {
+                    database.providers.insert(provide, { repository, index });
+                }
+            }
+        }
+    }
+    return database;
+}
+
+bool SyncDatabase::isEmpty() const {
+    return repos.isEmpty();
+}
+
+bool SyncDatabase::contains(const QString &name) const {
+    const QByteArray key = name.toUtf8();
+    for (const auto &repository : repos) {
+        if (repository->find(key) >= 0 || repository->hasGroup(key)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SyncDatabase::Package SyncDatabase::find(const QByteArray &name) const {
+    for (const auto &repository : repos) {
+        int index = repository->find(name);
+        if (index >= 0) {
+            return { repository, index };
+        }
+    }
+    return Package();
+}
+
+SyncDatabase::Package SyncDatabase::provider(const QByteArray &name) const {
+    return providers.value(name);
+}
+
+QVector<SyncDatabase::Package> SyncDatabase::groupMembers(const QByteArray &name) const {
+    QVector<Package> result;
+    QSet<QByteArray> seen;
+    for (const auto &repository : repos) {
+        for (int index : repository->groupMembers(name)) {
+            if (!seen.contains(repository->name(index))) {
+                seen.insert(repository->name(index));
+                result.append({ repository, index });
+            }
+        }
+    }
+    return result;
+}
+
+QStringList SyncDatabase::installable(const QStringList &names) const {
+    QStringList result;
+    for (const QString &name : names) {
+        if (contains(name)) {
+            result += name;
+        }
+    }
+    return result;
+}
+
+QStringList SyncDatabase::missing(const QStringList &names) const {
+    QStringList result;
+    for (const QString &name : names) {
+        if (!contains(name)) {
+            result += name;
+        }
+    }
+    return result;
+}
+
+QVector<QSharedPointer<const RepoCache>> SyncDatabase::repositories() const {
+    return repos;
+}
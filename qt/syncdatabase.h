@@ -0,0 +1,61 @@
+#ifndef SYNCDATABASE_H // Start of include guard to prevent multiple inclusions of this header file.
+#define SYNCDATABASE_H // Define the include guard macro.
+
+#include "repocache.h" // Cached metadata of each repository.
+
+#include <QHash> // Index of the provided names.
+#include <QStringList> // Used to pass package lists.
+#include <QVector> // Holds the repositories in pacman.conf order.
+
+// Packages that can be installed from the pacman sync databases (e.g. "/var/lib/pacman/sync/core.db").
+// The databases are read in-process through the RepoCache of each repository, so resolving a selection
+// does not need to run `pacman -Slq`, and a warm start only maps the caches.
+class SyncDatabase
+{
+public:
+    // A package of one of the repositories.
+    struct Package {
+        QSharedPointer<const RepoCache> repository; // Repository containing the package, null if not found.
+        int index = -1;                             // Index of the package inside the repository.
+
+        // Whether the package was found.
+        bool isValid() const { return repository && index >= 0; }
+    };
+
+    // Reads the "<repository>.db" files of the given directory in parallel, reusing the caches in cacheDirectory
+    // for the repositories that did not change. By default the repositories are the ones pacman.conf enables;
+    // other databases in the directory, e.g. ones another configuration left behind, are ignored.
+    static SyncDatabase load(const QString &directory, const QString &cacheDirectory, const QStringList &repositories = QStringList());
+
+    // True if no database could be read, in which case nothing is known about availability.
+    bool isEmpty() const;
+
+    // Whether the name is a package or a group in one of the sync databases.
+    bool contains(const QString &name) const;
+
+    // Returns the package with the given name from the first repository that has it, like pacman does.
+    Package find(const QByteArray &name) const;
+
+    // Returns the package providing a virtual name such as "sh", null if none does. The first repository,
+    // and within it the first package, providing the name wins.
+    Package provider(const QByteArray &name) const;
+
+    // Returns the members of the group across all repositories. A package of the same name in an
+    // earlier repository hides the later ones, like pacman does.
+    QVector<Package> groupMembers(const QByteArray &name) const;
+
+    // Returns the names of the list that can be installed, in their original order.
+    QStringList installable(const QStringList &names) const;
+
+    // Returns the names of the list that cannot be installed.
+    QStringList missing(const QStringList &names) const;
+
+    // The repositories that could be read.
+    QVector<QSharedPointer<const RepoCache>> repositories() const;
+
+private:
+    QVector<QSharedPointer<const RepoCache>> repos; // Repositories, in pacman.conf order.
+    QHash<QByteArray, Package> providers;           // Provided names, indexed by load() off the GUI thread.
+};
+
+#endif // SYNCDATABASE_H // End of the include guard.
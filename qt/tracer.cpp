@@ -0,0 +1,191 @@
+#include "tracer.h" // Includes the header file for the Tracer class.
+
+#include <QFile> // Writes the trace file.
+#include <QHash> // Spans started by begin().
+#include <QJsonDocument> // Encodes the events.
+#include <QJsonObject> // Fields of an event.
+#include <QMutex> // Events may come from worker threads.
+#include <QStringList> // Names of the open spans.
+
+#include <cstdlib> // Flushes the trace when the process exits.
+#include <sys/syscall.h> // Thread ids of the events.
+#include <time.h> // Reads the monotonic clock.
+#include <unistd.h> // Process ids of the events.
+
+namespace {
+
+// A span started by begin() that did not end yet.
+struct OpenSpan {
+    qint64 start;         // Start in microseconds.
+    const char *category; // Category of the span.
+    QString detail;       // Argument shown with the span.
+};
+
+// Buffered events and where they go.
+struct TraceState {
+    bool enabled = false;          // Whether SNIGDHAOS_BLACKBOX_TRACE named a writable file.
+    QString path;                  // Trace file.
+    QByteArray buffer;             // Events not written yet.
+    QHash<QString, OpenSpan> open; // Spans started by begin(), by name.
+    QMutex mutex;                  // Guards the buffer and the open spans.
+};
+
+constexpr int FLUSH_SIZE = 64 * 1024; // Buffered bytes after which the events are written.
+
+// Opens the trace on first use. The state is never destroyed, so events recorded during exit still work.
+TraceState &traceState() {
+    static TraceState *state = []() {
+        auto state = new TraceState;
+        QString path = qEnvironmentVariable("SNIGDHAOS_BLACKBOX_TRACE");
+        if (path.isEmpty()) {
+            return state;
+        }
+
+        // After a relaunch, continue the trace of the previous executable instead of starting over.
+        bool continuing = qEnvironmentVariableIsSet("SNIGDHAOS_BLACKBOX_TRACE_CONTINUE");
+        qunsetenv("SNIGDHAOS_BLACKBOX_TRACE_CONTINUE");
+        QFile file(path);
+        if (!file.open(continuing ? QIODevice::Append : QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return state;
+        }
+        if (file.size() == 0) {
+            file.write("[\n");
+            file.write(QJsonDocument(QJsonObject {
+                { "name", "process_name" },
+                { "ph", "M" },
+                { "pid", qint64(getpid()) },
+                { "args", QJsonObject { { "name", "snigdhaos-blackbox" } } },
+            }).toJson(QJsonDocument::Compact) + ",\n");
+        }
+        state->enabled = true;
+        state->path = path;
+        std::atexit(Tracer::flush);
+        return state;
+    }();
+    return *state;
+}
+
+// Buffers one event.
+void record(QJsonObject event, const QString &detail) {
+    TraceState &state = traceState();
+    event.insert("pid", qint64(getpid()));
+    event.insert("tid", qint64(syscall(SYS_gettid)));
+    if (!detail.isEmpty()) {
+        event.insert("args", QJsonObject { { "detail", detail } });
+    }
+    QByteArray line = QJsonDocument(event).toJson(QJsonDocument::Compact) + ",\n";
+
+    QMutexLocker locker(&state.mutex);
+    state.buffer += line;
+    if (state.buffer.size() >= FLUSH_SIZE) {
+        locker.unlock();
+        Tracer::flush();
+    }
+}
+
+} // namespace
+
+Tracer::Span::Span(const char *name, const QString &detail)
+    : name(name) // Name of the span.
+    , detail(isEnabled() ? detail : QString()) // Only kept when tracing.
+    , start(isEnabled() ? now() : -1) // Disabled spans do not read the clock.
+{
+}
+
+Tracer::Span::~Span() {
+    if (start >= 0) {
+        complete(name, "function", start, now(), detail);
+    }
+}
+
+bool Tracer::isEnabled() {
+    return traceState().enabled;
+}
+
+qint64 Tracer::now() {
+    timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return qint64(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+}
+
+void Tracer::complete(const QString &name, const char *category, qint64 start, qint64 end, const QString &detail) {
+    if (!isEnabled()) {
+        return;
+    }
+    record(QJsonObject {
+        { "name", name },
+        { "cat", category },
+        { "ph", "X" },
+        { "ts", start },
+        { "dur", qMax<qint64>(end - start, 0) },
+    }, detail);
+}
+
+void Tracer::begin(const QString &name, const char *category, const QString &detail) {
+    if (!isEnabled()) {
+        return;
+    }
+    TraceState &state = traceState();
+    QMutexLocker locker(&state.mutex);
+    state.open.insert(name, { now(), category, detail });
+}
+
+void Tracer::end(const QString &name) {
+    if (!isEnabled()) {
+        return;
+    }
+    TraceState &state = traceState();
+    QMutexLocker locker(&state.mutex);
+    if (!state.open.contains(name)) {
+        return;
+    }
+    OpenSpan span = state.open.take(name);
+    locker.unlock();
+    complete(name, span.category, span.start, now(), span.detail);
+}
+
+void Tracer::instant(const QString &name, const char *category, const QString &detail) {
+    if (!isEnabled()) {
+        return;
+    }
+    record(QJsonObject {
+        { "name", name },
+        { "cat", category },
+        { "ph", "i" },
+        { "s", "p" },
+        { "ts", now() },
+    }, detail);
+}
+
+void Tracer::flush() {
+    TraceState &state = traceState();
+    if (!state.enabled) {
+        return;
+    }
+    QMutexLocker locker(&state.mutex);
+    if (state.buffer.isEmpty()) {
+        return;
+    }
+    QFile file(state.path);
+    if (file.open(QIODevice::Append)) {
+        file.write(state.buffer);
+    }
+    state.buffer.clear();
+}
+
+void Tracer::prepareExec() {
+    if (!isEnabled()) {
+        return;
+    }
+    // The spans do not survive the exec, so end them here; e.g. the current state ends with the relaunch.
+    TraceState &state = traceState();
+    QMutexLocker locker(&state.mutex);
+    QStringList names = state.open.keys();
+    locker.unlock();
+    for (const QString &name : names) {
+        end(name);
+    }
+    instant("exec", "process");
+    flush();
+    qputenv("SNIGDHAOS_BLACKBOX_TRACE_CONTINUE", "1");
+}
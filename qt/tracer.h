@@ -0,0 +1,61 @@
+#ifndef TRACER_H // Start of include guard to prevent multiple inclusions of this header file.
+#define TRACER_H // Define the include guard macro.
+
+#include <QString> // Names and details of the events.
+
+// Records where the time of a run goes, as a trace for chrome://tracing or https://ui.perfetto.dev.
+//
+// Tracing is enabled by setting SNIGDHAOS_BLACKBOX_TRACE to the path of the trace file. Otherwise every
+// call returns after checking one flag. Events are buffered in memory and written in the JSON array format,
+// whose closing bracket is optional, so the file can be appended to. Timestamps come from the monotonic
+// clock, which keeps running across exec(): when the window relaunches itself, it flushes the trace and
+// the new executable, still the same process, appends to it, so a whole run shows up as one timeline.
+class Tracer
+{
+public:
+    // Records the time from its construction to its destruction as one span.
+    class Span
+    {
+    public:
+        // Parameters:
+        // - name: Name of the span, e.g. the function it measures.
+        // - detail: Optional argument shown with the span, e.g. the state being entered.
+        explicit Span(const char *name, const QString &detail = QString());
+        ~Span();
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+    private:
+        const char *name; // Name of the span.
+        QString detail;   // Argument shown with the span.
+        qint64 start;     // Start in microseconds, or -1 if tracing is disabled.
+    };
+
+    // Whether SNIGDHAOS_BLACKBOX_TRACE is set.
+    static bool isEnabled();
+
+    // Current time of the monotonic clock in microseconds.
+    static qint64 now();
+
+    // Records a span whose start and end were measured separately, e.g. a state or a script stage.
+    static void complete(const QString &name, const char *category, qint64 start, qint64 end, const QString &detail = QString());
+
+    // Starts a span that ends somewhere else, e.g. when a signal arrives. Spans are matched by name.
+    static void begin(const QString &name, const char *category, const QString &detail = QString());
+
+    // Ends the span started under the same name. Does nothing if there is none.
+    static void end(const QString &name);
+
+    // Records a point in time, e.g. the exec of a relaunch.
+    static void instant(const QString &name, const char *category, const QString &detail = QString());
+
+    // Writes the buffered events to the trace file.
+    static void flush();
+
+    // Ends the open spans, flushes the trace and tells the executable started next to append to it
+    // instead of starting over.
+    static void prepareExec();
+};
+
+#endif // TRACER_H // End of the include guard.
@@ -0,0 +1,81 @@
+#include "catalog.h" // The parser under test.
+
+#include <QTemporaryDir> // Holds the catalogs of the tests.
+#include <QtTest/QtTest> // Qt's test framework.
+
+// Parses small legacy catalogs and checks which entries survive and which lines are reported.
+class CatalogParserTest : public QObject
+{
+    Q_OBJECT // Qt's macro enabling signals, slots, and other meta-object features.
+
+private slots:
+    // An entry without its package names line is dropped, and the next entry is still read.
+    void missingPackages();
+
+    // An entry without its display text line is dropped, and the next entry is still read.
+    void missingDisplay();
+
+    // Complete entries are read without diagnostics.
+    void complete();
+
+private:
+    // Writes a catalog and parses it.
+    ParsedCatalog parse(const QByteArray &text);
+
+    QTemporaryDir directory; // Directory of the catalogs.
+};
+
+namespace {
+
+// Copies a parsed field, so a failing comparison prints it.
+QByteArray text(std::string_view field) {
+    return QByteArray(field.data(), int(field.size()));
+}
+
+} // namespace
+
+ParsedCatalog CatalogParserTest::parse(const QByteArray &text) {
+    QString path = directory.filePath(QString("catalog-%1.txt").arg(QTest::currentTestFunction()));
+    QFile file(path);
+    file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    file.write(text);
+    file.close();
+    return CatalogCache::parse(path);
+}
+
+void CatalogParserTest::missingPackages() {
+    ParsedCatalog catalog = parse("true\nDisplay A\ntrue\npkgB\nDisplay B\nfalse\npkgC\nDisplay C\n");
+
+    QCOMPARE(catalog.entries.size(), 2);
+    QCOMPARE(text(catalog.entries[0].display), QByteArray("Display B"));
+    QCOMPARE(text(catalog.entries[1].display), QByteArray("Display C"));
+
+    QCOMPARE(catalog.diagnostics.size(), 1);
+    QCOMPARE(catalog.diagnostics[0].line, 3);
+    QVERIFY(catalog.diagnostics[0].error);
+}
+
+void CatalogParserTest::missingDisplay() {
+    ParsedCatalog catalog = parse("false\npkgA\ntrue\npkgB\nDisplay B\n");
+
+    QCOMPARE(catalog.entries.size(), 1);
+    QCOMPARE(text(catalog.entries[0].display), QByteArray("Display B"));
+    QCOMPARE(catalog.entries[0].packages.size(), 1);
+    QCOMPARE(text(catalog.entries[0].packages[0]), QByteArray("pkgB"));
+    QVERIFY(catalog.entries[0].defaultChecked);
+
+    QCOMPARE(catalog.diagnostics.size(), 1);
+    QCOMPARE(catalog.diagnostics[0].line, 3);
+    QVERIFY(catalog.diagnostics[0].error);
+}
+
+void CatalogParserTest::complete() {
+    ParsedCatalog catalog = parse("true\npkgA pkgB\nDisplay A\n\nfalse\npkgC\nDisplay C\n");
+
+    QCOMPARE(catalog.entries.size(), 2);
+    QCOMPARE(catalog.entries[0].packages.size(), 2);
+    QVERIFY(catalog.diagnostics.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(CatalogParserTest)
+#include "catalogparsertest.moc"
@@ -2,12 +2,16 @@
 
 # Function to print usage instructions
 usage() {
-    echo "Usage: $0 [<file1>] <package_list_file> [<service_script_file>]"
+    echo "Usage: $0 [<file1>] <package_list_file> [<service_script_file>] [<package_cache_dir>]"
     echo ""
     echo "Arguments:"
-    echo "  <file1>                Optional. Any file or directory to check before setup."
+    echo "  <file1>                Optional. Preparation steps to run before installing."
     echo "  <package_list_file>    Required. A file containing a list of packages to install."
-    echo "  <service_script_file>  Optional. A script to enable services (if any)."
+    echo "  <service_script_file>  Optional. Steps or a script to enable services (if any)."
+    echo "  <package_cache_dir>    Optional. Extra package cache with files downloaded in advance."
+    echo ""
+    echo "SNIGDHAOS_BLACKBOX_BUNDLE_FILES names a list of package files from an offline bundle to install instead, in the"
+    echo "format of sha256sum --check, and SNIGDHAOS_BLACKBOX_BUNDLE_DEPENDENCIES the names among them installed as dependencies."
     echo ""
     exit 1
 }
@@ -32,6 +36,38 @@ log() {
     echo "$(date) - $1" >> "$LOGFILE"
 }
 
+# Runs a graph of steps written by Snigdha OS Blackbox as root, independent steps in parallel: run_steps <stage> <file>
+# Plain scripts are run as a single step. Steps the apply journal lists as done are skipped.
+run_steps() {
+    sudo "${SNIGDHAOS_BLACKBOX:-snigdhaos-blackbox}" --run-steps "$2" --stage "$1" \
+        ${SNIGDHAOS_BLACKBOX_PROGRESS:+--progress "$SNIGDHAOS_BLACKBOX_PROGRESS"} --since "$PROGRESS_START" \
+        ${SNIGDHAOS_BLACKBOX_JOURNAL:+--journal "$SNIGDHAOS_BLACKBOX_JOURNAL"}
+}
+
+# Records a completed stage in the apply journal of Snigdha OS Blackbox, if there is one: journal <stage> <checksum>
+journal() {
+    [ -n "$SNIGDHAOS_BLACKBOX_JOURNAL" ] || return 0
+    printf '{"stage":"%s","checksum":"%s"}\n' "$1" "$2" >> "$SNIGDHAOS_BLACKBOX_JOURNAL"
+}
+
+# Whether an earlier attempt completed the stage with the same input: journaled <stage> <checksum>
+journaled() {
+    [ -n "$SNIGDHAOS_BLACKBOX_JOURNAL" ] && grep -qF "{\"stage\":\"$1\",\"checksum\":\"$2\"}" "$SNIGDHAOS_BLACKBOX_JOURNAL" 2>/dev/null
+}
+
+# Installs the selected packages from the repositories, or the package files of an offline bundle if there is one.
+# `pacman -U` records every file as explicitly installed, so the dependencies of a bundle are marked as such afterwards.
+install_packages() {
+    if [ -z "$SNIGDHAOS_BLACKBOX_BUNDLE_FILES" ]; then
+        sudo pacman -S --needed $confirm_options $cache_options $installable_packages
+        return
+    fi
+    sudo pacman -U --needed $confirm_options "${bundle_files[@]}" || return 1
+    if [ -s "$SNIGDHAOS_BLACKBOX_BUNDLE_DEPENDENCIES" ]; then
+        xargs -a "$SNIGDHAOS_BLACKBOX_BUNDLE_DEPENDENCIES" sudo pacman -D --asdeps >/dev/null
+    fi
+}
+
 # Log file location
 LOGFILE="/tmp/setup_script.log"
 
@@ -43,6 +79,9 @@ if [ "$1" == "--help" ]; then
     usage
 fi
 
+# Report progress to Snigdha OS Blackbox, if it is listening
+. /usr/lib/snigdhaos-blackbox/progress.sh
+
 # Check if package list file is provided and valid
 if [ -z "$2" ] || [ ! -f "$2" ]; then
     error "Package list file is missing or invalid."
@@ -55,52 +94,121 @@ if [ -n "$3" ] && [ ! -f "$3" ]; then
 fi
 
 # Step 1: Optional Setup Preparation
-if [ -n "$1" ] && [ -e "$1" ]; then
+progress prepare start
+if [ -n "$1" ] && [ -s "$1" ]; then
     echo ""
     echo "Preparing Setup..."
     log "Preparing Setup..."
     echo ""
+
+    if ! run_steps prepare "$1"; then
+        progress prepare end "" 0 0 1
+        error "Setup preparation failed. Please check the output above."
+        log "Setup preparation failed."
+        exit 1
+    fi
 fi
+progress prepare end
 
 # Step 2: Installing Packages
 echo ""
 echo "Installing Packages! Please Wait..."
 log "Starting package installation..."
 
-# Generate the list of installable packages
-installable_packages=$(comm -12 <(pacman -Slq | sort) <(sed 's/\s/\n/g' - <"$2" | sort))
+# The package list was already resolved against the sync databases by Snigdha OS Blackbox
+installable_packages=$(cat "$2")
 
-# Check if any valid packages are available
-if [ -z "$installable_packages" ]; then
-    error "No packages found to install from the provided list."
-    log "No valid packages found."
-    exit 1
+# Without anyone to answer (snigdhaos-blackbox --profile <file> --yes), let pacman confirm by itself
+confirm_options=""
+if [ -n "$SNIGDHAOS_BLACKBOX_NONINTERACTIVE" ]; then
+    confirm_options="--noconfirm"
 fi
 
-# Attempt to install the packages
-echo "Installing the following packages: $installable_packages"
-log "Installing packages: $installable_packages"
+# Let pacman pick up the packages Snigdha OS Blackbox already downloaded, next to its own cache
+cache_options=""
+if [ -n "$4" ] && [ -d "$4" ]; then
+    cache_options="--cachedir /var/cache/pacman/pkg --cachedir $4"
+fi
 
-if ! sudo pacman -S --needed $installable_packages; then
-    error "Package installation failed. Please check the package list and try again."
-    log "Package installation failed."
-    exit 1
+# Install from an offline bundle instead of the mirrors: the package files of the whole closure, which Snigdha OS Blackbox
+# resolved against the bundle's database. They go through `pacman -U` under the system database and its lock.
+bundle_files=()
+if [ -n "$SNIGDHAOS_BLACKBOX_BUNDLE_FILES" ]; then
+    mapfile -t bundle_files < <(sed 's/^[^ ]*  //' "$SNIGDHAOS_BLACKBOX_BUNDLE_FILES")
+    [ ${#bundle_files[@]} -gt 0 ] || installable_packages=""
+fi
+
+# The preparation steps may have added a repository (e.g. BlackArch's strap.sh), whose packages Snigdha OS Blackbox
+# kept without knowing them. Drop what the repositories still do not have, keeping package groups.
+if [ -z "$SNIGDHAOS_BLACKBOX_BUNDLE_FILES" ] && [ -n "$1" ] && [ -s "$1" ] && [ -n "$installable_packages" ]; then
+    installable_packages=$(comm -12 <({ pacman -Slq; pacman -Sg; } | sort -u) \
+        <(printf '%s\n' $installable_packages | sort -u) | xargs)
+fi
+
+# Attempt to install the packages, unless everything selected is already installed
+if [ -z "$installable_packages" ]; then
+    warning "All selected packages are already installed or cannot be installed from the enabled repositories."
+    log "No packages left to install."
 else
-    # Remove the package list file after successful installation
-    rm "$2"
-    success "Packages installed successfully."
-    log "Packages installed successfully."
+    echo "Installing the following packages: $installable_packages"
+    log "Installing packages: $installable_packages"
+
+    # Download everything first, so downloading and installing are reported as separate stages.
+    # A retry with the same packages installs straight from the cache the earlier attempt filled.
+    # A bundle has nothing to download, but its files are checked against the checksums of its database.
+    packages_checksum=$(sha256sum "$2" | cut -d' ' -f1)
+    if [ -n "$SNIGDHAOS_BLACKBOX_BUNDLE_FILES" ]; then
+        if ! sha256sum --check --strict --quiet "$SNIGDHAOS_BLACKBOX_BUNDLE_FILES"; then
+            error "The package files of the offline bundle do not match its database. Please export the bundle again."
+            log "Bundle checksum verification failed."
+            exit 1
+        fi
+    elif journaled download "$packages_checksum"; then
+        echo "The packages were already downloaded in an earlier attempt."
+        log "Skipping the download of the same packages."
+    else
+        progress download start
+        progress_watch_downloads download /var/cache/pacman/pkg
+        if ! sudo pacman -Sw --needed --noconfirm $cache_options $installable_packages; then
+            progress_stop_watch
+            progress download end "" 0 0 1
+            error "Package download failed. Please check your connection and try again."
+            log "Package download failed."
+            exit 1
+        fi
+        progress_stop_watch
+        progress download end
+        journal download "$packages_checksum"
+    fi
+
+    # Install from the cache, or the files of the bundle, reporting every package pacman installs
+    progress install start
+    progress_watch_pacman install
+    if ! install_packages; then
+        progress_stop_watch
+        progress install end "" 0 0 1
+        error "Package installation failed. Please check the package list and try again."
+        log "Package installation failed."
+        exit 1
+    else
+        progress_stop_watch
+        progress install end
+        success "Packages installed successfully."
+        log "Packages installed successfully."
+    fi
 fi
 
 # Step 3: Enabling Services (if any)
+progress setup start
 if [ -n "$3" ] && [ -f "$3" ]; then
     echo ""
     echo "Enabling Services (If Any)..."
     log "Enabling services..."
 
-    # Execute the service script with sudo
-    if ! sudo bash - <"$3"; then
-        error "Failed to enable services from the script. Please check the script."
+    # Run the service steps with sudo, each step printing its own output once done
+    if ! run_steps setup "$3"; then
+        progress setup end "" 0 0 1
+        error "Failed to enable services. Please check the output of the failed steps."
         log "Service enabling failed."
         exit 1
     else
@@ -109,6 +217,10 @@ if [ -n "$3" ] && [ -f "$3" ]; then
     fi
 fi
 
-# Final prompt
-echo ""
-read -p "Press Enter to return to Snigdha OS Blackbox." 
+progress setup end
+
+# Final prompt, unless nobody is there to read it
+if [ -z "$SNIGDHAOS_BLACKBOX_NONINTERACTIVE" ]; then
+    echo ""
+    read -p "Press Enter to return to Snigdha OS Blackbox."
+fi 
@@ -0,0 +1,87 @@
+#!/bin/sh
+
+# Progress channel of Snigdha OS Blackbox, sourced by apply.sh and update.sh.
+#
+# If SNIGDHAOS_BLACKBOX_PROGRESS names a pipe, every call to progress writes one line of JSON to it:
+#   {"stage":"install","event":"package","package":"nmap","bytes":0,"rate":0,"elapsed":5120,"status":0}
+#
+#   stage    prepare, download, install, setup, mirrors or update; "done" once the script exits
+#   event    "start" and "end" of a stage, "package" whenever a package finished downloading or installing
+#   package  name of the package, for "package" events
+#   bytes    size of a downloaded package
+#   rate     download rate of the package in bytes per second (approximate with parallel downloads)
+#   elapsed  milliseconds since the script started
+#   status   exit status, at the end of a stage and for "done"
+#
+# Without the variable, progress does nothing, so the scripts also work on their own.
+
+PROGRESS_START=$(date +%s%3N)
+PROGRESS_WATCHER=""
+
+# Open the pipe once, for reading and writing, so a write never waits for a reader.
+if [ -p "$SNIGDHAOS_BLACKBOX_PROGRESS" ]; then
+    exec 9<>"$SNIGDHAOS_BLACKBOX_PROGRESS"
+fi
+
+# Writes a message: progress <stage> <event> [<package>] [<bytes>] [<rate>] [<status>]
+progress() {
+    [ -p "$SNIGDHAOS_BLACKBOX_PROGRESS" ] || return 0
+    printf '{"stage":"%s","event":"%s","package":"%s","bytes":%s,"rate":%s,"elapsed":%s,"status":%s}\n' \
+        "$1" "$2" "${3:-}" "${4:-0}" "${5:-0}" "$(( $(date +%s%3N) - PROGRESS_START ))" "${6:-0}" >&9
+}
+
+# Reports every package file that appears in the given cache directories: progress_watch_downloads <stage> <dir>...
+progress_watch_downloads() {
+    [ -p "$SNIGDHAOS_BLACKBOX_PROGRESS" ] || return 0
+    stage=$1
+    shift
+    marker=$(mktemp)
+    (
+        # Remove the marker once progress_stop_watch, or anything else, stops the watcher. Its stderr is
+        # dropped, since bash reports the sleep that progress_stop_watch kills as "Terminated".
+        trap 'rm -f "$marker"' EXIT
+        trap 'exit 0' TERM INT HUP
+        last=$(date +%s%3N)
+        seen=""
+        while :; do
+            for file in $(find "$@" -maxdepth 1 -newer "$marker" -name '*.pkg.tar.*' ! -name '*.sig' ! -name '*.part' 2>/dev/null); do
+                case " $seen " in *" $file "*) continue ;; esac
+                seen="$seen $file"
+                now=$(date +%s%3N)
+                bytes=$(stat -c %s "$file")
+                milliseconds=$(( now - last ))
+                [ "$milliseconds" -gt 0 ] || milliseconds=1
+                progress "$stage" package "$(basename "$file" | sed -E 's/-[^-]+-[^-]+-[^-]+\.pkg\.tar.*$//')" "$bytes" "$(( bytes * 1000 / milliseconds ))"
+                last=$now
+            done
+            sleep 0.5
+        done
+    ) 2>/dev/null &
+    PROGRESS_WATCHER=$!
+}
+
+# Reports every package pacman installs, upgrades or removes, from its log: progress_watch_pacman <stage>
+progress_watch_pacman() {
+    [ -p "$SNIGDHAOS_BLACKBOX_PROGRESS" ] || return 0
+    (
+        tail -n0 -F /var/log/pacman.log 2>/dev/null | while read -r _ source action package _; do
+            [ "$source" = "[ALPM]" ] || continue
+            case "$action" in
+                installed|upgraded|reinstalled|downgraded|removed) progress "$1" package "$package" ;;
+            esac
+        done
+    ) &
+    PROGRESS_WATCHER=$!
+}
+
+# Stops the running watcher.
+progress_stop_watch() {
+    if [ -n "$PROGRESS_WATCHER" ]; then
+        pkill -P "$PROGRESS_WATCHER" 2>/dev/null
+        kill "$PROGRESS_WATCHER" 2>/dev/null
+        PROGRESS_WATCHER=""
+    fi
+}
+
+# Reports the exit status of the script and stops a watcher that is still running.
+trap 'status=$?; progress_stop_watch; progress done end "" 0 0 "$status"' EXIT
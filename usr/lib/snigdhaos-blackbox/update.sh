@@ -0,0 +1,54 @@
+#!/bin/sh
+
+# Function to print usage instructions
+usage() {
+    echo "Usage: $0 <pacman_operation> [<ranked_mirrorlist> <installed_mirrorlist>]..."
+    echo ""
+    echo "Arguments:"
+    echo "  <pacman_operation>      Required. The pacman operation to run, e.g. -Syu or -Su."
+    echo "  <ranked_mirrorlist>     Optional. A reordered mirror list to install before updating,"
+    echo "  <installed_mirrorlist>  followed by the mirror list it replaces."
+    echo ""
+    exit 1
+}
+
+# Display help if the user asks for it
+if [ -z "$1" ] || [ "$1" == "--help" ]; then
+    usage
+fi
+
+# Report progress to Snigdha OS Blackbox, if it is listening
+. /usr/lib/snigdhaos-blackbox/progress.sh
+
+operation=$1
+shift
+status=0
+
+# Without anyone to answer (snigdhaos-blackbox --profile <file> --yes), let pacman confirm by itself
+confirm_options=""
+if [ -n "$SNIGDHAOS_BLACKBOX_NONINTERACTIVE" ]; then
+    confirm_options="--noconfirm"
+fi
+
+# Step 1: Install the ranked mirror lists
+progress mirrors start
+while [ $# -ge 2 ] && [ "$status" -eq 0 ]; do
+    sudo cp "$1" "$2" 2>&1 || status=$?
+    shift 2
+done
+progress mirrors end "" 0 0 "$status"
+
+# Step 2: Update the system, reporting every package pacman upgrades
+if [ "$status" -eq 0 ]; then
+    progress update start
+    progress_watch_pacman update
+    sudo pacman $operation $confirm_options 2>&1 || status=$?
+    progress_stop_watch
+    progress update end "" 0 0 "$status"
+fi
+
+if [ -z "$SNIGDHAOS_BLACKBOX_NONINTERACTIVE" ]; then
+    echo ""
+    read -p 'Press Enter↵ to Exit'
+fi
+exit "$status"